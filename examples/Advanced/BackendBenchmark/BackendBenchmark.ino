@@ -0,0 +1,62 @@
+/*
+   TTP229 Read Backend Benchmark
+   Compares the time per frame of the bit-bang and hardware SPI backends.
+   
+   The SPI backend needs SCL on the SPI clock pin and SDO on MISO:
+   - Uno/Nano: SCL=13, SDO=12
+   - ESP32: any pins (GPIO matrix)
+   - Pico: pins must belong to SPI0
+*/
+
+#include <TTP229.h>
+
+#if defined(ESP32)
+  TTP229 keypad(18, 19, true);
+#else
+  TTP229 keypad(13, 12, true);
+#endif
+
+const uint16_t FRAMES = 1000;
+
+void runBenchmark(TTP229::ReadBackend backend, const char* name) {
+  keypad.begin(backend);
+  
+  if (keypad.getReadBackend() != backend) {
+    Serial.print(name);
+    Serial.println(": not available on these pins (fell back to bit-bang)");
+    return;
+  }
+  
+  uint16_t lastMask = 0;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < FRAMES; i++) {
+    lastMask = keypad.readRawMask();
+  }
+  uint32_t elapsed = micros() - start;
+  
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print((float)elapsed / FRAMES, 2);
+  Serial.print(" us/frame (last frame 0x");
+  Serial.print(lastMask, HEX);
+  Serial.println(")");
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  
+  Serial.println("=== TTP229 Read Backend Benchmark ===");
+  Serial.print("GPIO backend: ");
+  keypad.begin();
+  Serial.println(keypad.getGpioBackendName());
+  
+  runBenchmark(TTP229::BACKEND_BITBANG, "Bit-bang");
+  runBenchmark(TTP229::BACKEND_SPI, "Hardware SPI");
+  
+  Serial.println("=== Done ===");
+}
+
+void loop() {
+  delay(1000);
+}
@@ -0,0 +1,473 @@
+/*
+   TTP229 Benchmark Suite
+   Scan cost per backend, touch-to-dequeue latency, event queue
+   throughput and (ESP32 RTOS) snapshot reads and mutex contention.
+
+   Every result is one machine-readable line:
+     BENCH <test> key=value key=value ...
+   e.g.
+     BENCH scan backend=bitbang frames=1000 us_per_frame=342.10 cycles_per_frame=5473
+
+   On the board, touch the keys while the latency test runs. Built with
+   -DTTP229_EVENT_TIMING, latency is measured from the first frame that
+   showed the change (KeyEvent::edgeMicros) to the dequeue; otherwise
+   from the millisecond timestamp.
+
+   On a PC the suite runs against the host simulation, which scripts the
+   touches and knows the exact touch edge:
+     g++ -std=gnu++11 -DTTP229_HOST_SIM -I../../../src -x c++ BenchmarkSuite.ino \
+         -x none ../../../src/TTP229.cpp -o bench && ./bench
+*/
+
+#include <TTP229.h>
+
+#if defined(TTP229_HOST_SIM)
+#include <chrono>
+#endif
+
+#if defined(ESP32)
+const uint8_t SCL_PIN = 18;
+const uint8_t SDO_PIN = 19;
+#else
+const uint8_t SCL_PIN = 2;
+const uint8_t SDO_PIN = 3;
+#endif
+
+TTP229 keypad(SCL_PIN, SDO_PIN, true);
+
+// ==============================================
+// RESULT LINES
+// ==============================================
+
+void benchBegin(const char* test) {
+  Serial.print("BENCH ");
+  Serial.print(test);
+}
+
+void benchText(const char* key, const char* value) {
+  Serial.print(' ');
+  Serial.print(key);
+  Serial.print('=');
+  Serial.print(value);
+}
+
+void benchUint(const char* key, uint32_t value) {
+  Serial.print(' ');
+  Serial.print(key);
+  Serial.print('=');
+  Serial.print((unsigned long)value);
+}
+
+void benchFloat(const char* key, float value) {
+  Serial.print(' ');
+  Serial.print(key);
+  Serial.print('=');
+  Serial.print(value, 2);
+}
+
+void benchEnd() {
+  Serial.println();
+}
+
+uint32_t cyclesPerUs() {
+  #if defined(F_CPU)
+  return F_CPU / 1000000UL;
+  #else
+  return 0;  // Unknown (host simulation)
+  #endif
+}
+
+// ==============================================
+// SCAN COST
+// ==============================================
+
+void benchScan(TTP229::ReadBackend backend, const char* name) {
+  const uint16_t FRAMES = 1000;
+
+  keypad.begin(backend);
+  if (keypad.getReadBackend() != backend) {
+    benchBegin("scan");
+    benchText("backend", name);
+    benchText("status", "unavailable");
+    benchEnd();
+    return;
+  }
+
+  uint32_t minUs = 0xFFFFFFFF;
+  uint32_t maxUs = 0;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < FRAMES; i++) {
+    uint32_t t = micros();
+    keypad.readRawMask();
+    uint32_t us = micros() - t;
+    if (us < minUs) minUs = us;
+    if (us > maxUs) maxUs = us;
+  }
+  uint32_t elapsed = micros() - start;
+  float usPerFrame = (float)elapsed / FRAMES;
+
+  benchBegin("scan");
+  benchText("backend", name);
+  benchText("gpio", keypad.getGpioBackendName());
+  benchUint("frames", FRAMES);
+  benchFloat("us_per_frame", usPerFrame);
+  benchUint("min_us", minUs);
+  benchUint("max_us", maxUs);
+  if (cyclesPerUs() != 0) {
+    benchUint("cycles_per_frame", (uint32_t)(usPerFrame * cyclesPerUs()));
+  }
+  benchEnd();
+}
+
+// ==============================================
+// LATENCY
+// ==============================================
+
+// Power-of-two buckets: bucket i holds [2^i, 2^(i+1)) µs, bucket 0 also 0
+struct LatencyHistogram {
+  static const uint8_t BUCKETS = 24;
+  uint32_t count[BUCKETS];
+  uint32_t samples;
+  uint32_t maxUs;
+  float sumUs;
+
+  void reset() {
+    memset(count, 0, sizeof(count));
+    samples = 0;
+    maxUs = 0;
+    sumUs = 0;
+  }
+
+  void add(uint32_t us) {
+    uint8_t bucket = 0;
+    while (bucket < BUCKETS - 1 && (us >> (bucket + 1)) != 0) bucket++;
+    count[bucket]++;
+    samples++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  // Percentile, interpolated within its bucket and never above the
+  // largest sample
+  uint32_t percentileUs(uint8_t percent) {
+    uint32_t wanted = (samples * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+      if (count[i] == 0 || seen + count[i] < wanted) {
+        seen += count[i];
+        continue;
+      }
+      uint32_t lo = i == 0 ? 0 : (1UL << i);
+      uint32_t hi = (2UL << i) - 1;
+      uint32_t us = lo + (uint32_t)((float)(hi - lo) * (wanted - seen) / count[i]);
+      return us < maxUs ? us : maxUs;
+    }
+    return maxUs;
+  }
+
+  void print(const char* mode) {
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+      if (count[i] == 0) continue;
+      benchBegin("latency_hist");
+      benchText("mode", mode);
+      benchUint("lo_us", i == 0 ? 0 : (1UL << i));
+      benchUint("hi_us", (2UL << i) - 1);
+      benchUint("count", count[i]);
+      benchEnd();
+    }
+    benchBegin("latency");
+    benchText("mode", mode);
+    benchUint("samples", samples);
+    benchFloat("mean_us", samples ? sumUs / samples : 0);
+    benchUint("p50_us", percentileUs(50));
+    benchUint("p99_us", percentileUs(99));
+    benchUint("max_us", maxUs);
+    benchEnd();
+  }
+};
+
+LatencyHistogram histogram;
+
+#if defined(TTP229_HOST_SIM)
+// 100 taps on changing keys: 120ms down, 130ms up
+const uint8_t TAPS = 100;
+TTP229SimStep tapScript[TAPS * 2];
+uint32_t scriptStartUs = 0;
+
+void buildTapScript() {
+  for (uint8_t i = 0; i < TAPS; i++) {
+    tapScript[i * 2].atMs = i * 250UL;
+    tapScript[i * 2].mask = TTP229::keyToMask((i % 16) + 1);
+    tapScript[i * 2 + 1].atMs = i * 250UL + 120;
+    tapScript[i * 2 + 1].mask = 0;
+  }
+}
+
+// Time of the scripted touch edge that produced this event
+uint32_t edgeUs(const TTP229::KeyEvent& event) {
+  uint16_t bit = TTP229::keyToMask(event.key);
+  for (int i = TAPS * 2 - 1; i >= 0; i--) {
+    uint32_t at = scriptStartUs + tapScript[i].atMs * 1000UL;
+    if (at > micros()) continue;
+    bool down = (tapScript[i].mask & bit) != 0;
+    bool wasDown = i > 0 && (tapScript[i - 1].mask & bit) != 0;
+    if (event.eventType == TTP229::EVENT_PRESS ? (down && !wasDown) : (!down && wasDown)) {
+      return at;
+    }
+  }
+  return micros();
+}
+#endif
+
+// Drain the queue and record how old each press/release is
+void drainLatency() {
+  TTP229::KeyEvent event;
+  while (keypad.getKeyEvents(event)) {
+    if (event.eventType != TTP229::EVENT_PRESS && event.eventType != TTP229::EVENT_RELEASE) {
+      continue;
+    }
+    #if defined(TTP229_HOST_SIM)
+    // Exact: time since the simulated touch edge
+    histogram.add(micros() - edgeUs(event));
+    #elif defined(TTP229_EVENT_TIMING)
+    // Time since the first frame that showed the edge
+    histogram.add(micros() - event.edgeMicros);
+    #else
+    histogram.add(micros() - event.timestamp * 1000UL);
+    #endif
+  }
+}
+
+void benchLatency(const char* mode, bool pollRead) {
+  histogram.reset();
+  while (keypad.getQueueCount() > 0) {
+    TTP229::KeyEvent event;
+    keypad.getKeyEvents(event);
+  }
+
+  #if defined(TTP229_HOST_SIM)
+  buildTapScript();
+  scriptStartUs = micros();
+  ttp229HostSim().playScript(tapScript, TAPS * 2);
+  uint32_t runMs = TAPS * 250UL + 300;
+  #else
+  Serial.println("# Touch keys for 10 seconds...");
+  uint32_t runMs = 10000;
+  #endif
+
+  uint32_t start = millis();
+  while (millis() - start < runMs) {
+    if (pollRead) keypad.read();
+    drainLatency();
+    delay(1);
+  }
+  histogram.print(mode);
+
+  #if defined(TTP229_HOST_SIM)
+  // Every scripted edge should have produced one event
+  benchBegin("missed");
+  benchText("mode", mode);
+  benchUint("edges", TAPS * 2);
+  benchUint("events", histogram.samples);
+  benchUint("missed", histogram.samples < TAPS * 2 ? TAPS * 2 - histogram.samples : 0);
+  benchEnd();
+  #endif
+}
+
+// ==============================================
+// QUEUE THROUGHPUT
+// ==============================================
+
+#if defined(TTP229_HOST_SIM)
+// Virtual time stands still in a loop without delays - time the ring on
+// the PC's own clock
+const uint32_t RING_OPS = 1000000;
+
+uint32_t ringMicros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+const uint32_t RING_OPS = 10000;
+
+uint32_t ringMicros() {
+  return micros();
+}
+#endif
+
+void benchRing() {
+  TTP229EventRing<TTP229::KeyEvent, TTP229_EVENT_QUEUE_CAPACITY> ring;
+  TTP229::KeyEvent event;
+  memset(&event, 0, sizeof(event));
+  volatile uint8_t checksum = 0;  // Keeps the loop from being optimized out
+
+  uint32_t start = ringMicros();
+  for (uint32_t i = 0; i < RING_OPS; i++) {
+    event.key = (uint8_t)i;
+    ring.push(event);
+    ring.pop(event);
+    checksum = checksum + event.key;
+  }
+  uint32_t elapsed = ringMicros() - start;
+
+  benchBegin("ring");
+  benchUint("ops", RING_OPS);
+  benchFloat("ns_per_push_pop", elapsed * 1000.0f / RING_OPS);
+  benchUint("push_pop_per_s", elapsed ? (uint32_t)(RING_OPS * 1000000.0f / elapsed) : 0);
+  benchEnd();
+}
+
+void benchSustained() {
+  #if defined(TTP229_HOST_SIM)
+  // All 16 keys toggling every 2ms, scanned and drained every 1ms: a
+  // scan can queue 16 events, so a queue of 16 or more keeps up
+  const uint16_t TOGGLES = 1000;
+  static TTP229SimStep burst[TOGGLES];
+  for (uint16_t i = 0; i < TOGGLES; i++) {
+    burst[i].atMs = i * 2UL;
+    burst[i].mask = (i & 1) ? 0x0000 : 0xFFFF;
+  }
+
+  // A keypad of its own on the same pins, so the other tests keep the
+  // board's debounce and scan interval
+  TTP229 burstPad(SCL_PIN, SDO_PIN, true);
+  burstPad.begin();
+  burstPad.setDebounce((uint8_t)1, (uint8_t)1);
+  burstPad.setScanInterval(1);
+  burstPad.setQueueSize(TTP229_EVENT_QUEUE_CAPACITY);
+  uint32_t events = 0;
+
+  ttp229HostSim().playScript(burst, TOGGLES);
+  uint32_t start = millis();
+  while (!ttp229HostSim().scriptDone() || millis() - start < TOGGLES * 2UL + 50) {
+    burstPad.read();
+    delay(1);
+    TTP229::KeyEvent batch[TTP229_EVENT_QUEUE_CAPACITY];
+    events += burstPad.getKeyEvents(batch, TTP229_EVENT_QUEUE_CAPACITY);
+  }
+  uint32_t elapsed = millis() - start;
+
+  benchBegin("sustained");
+  benchUint("edges", TOGGLES * 16UL);
+  benchUint("events", events);
+  benchUint("overflows", burstPad.getQueueOverflows());
+  benchUint("events_per_s", elapsed ? (uint32_t)(events * 1000UL / elapsed) : 0);
+  benchUint("queue_size", burstPad.getQueueSize());
+  benchEnd();
+  #else
+  // Needs scripted touches - run it on the host simulation
+  benchBegin("sustained");
+  benchText("status", "host_only");
+  benchEnd();
+  #endif
+}
+
+// ==============================================
+// MUTEX CONTENTION (ESP32 RTOS)
+// ==============================================
+
+#if TTP229_RTOS_SUPPORT && defined(ESP32)
+const uint8_t READER_TASKS = 3;
+volatile bool readersRunning = false;
+volatile bool readersWait = false;
+volatile uint32_t readerCounts[READER_TASKS];
+
+// read() copies the published snapshot and never takes the mutex.
+// waitForEvent() does, to (re)subscribe on every call, as does the scan
+// task for each frame - that is where contention is left to measure.
+void readerTask(void* parameter) {
+  uint8_t id = (uint8_t)(uintptr_t)parameter;
+  TTP229::KeyEvent event;
+  while (readersRunning) {
+    if (readersWait) {
+      keypad.waitForEvent(event, 0);
+    } else {
+      keypad.read();
+    }
+    readerCounts[id]++;
+    taskYIELD();
+  }
+  keypad.unsubscribe();
+  vTaskDelete(NULL);
+}
+
+uint32_t runReaders(bool wait) {
+  readersWait = wait;
+  readersRunning = true;
+  for (uint8_t i = 0; i < READER_TASKS; i++) {
+    readerCounts[i] = 0;
+    xTaskCreate(readerTask, "BenchReader", 2048, (void*)(uintptr_t)i, 2, NULL);
+  }
+  delay(3000);
+  readersRunning = false;
+  delay(50);  // Let the readers exit
+
+  uint32_t calls = 0;
+  for (uint8_t i = 0; i < READER_TASKS; i++) calls += readerCounts[i];
+  return calls / 3;
+}
+
+void benchContention() {
+  keypad.beginRTOS();
+
+  benchBegin("snapshot");
+  benchUint("reader_tasks", READER_TASKS);
+  benchUint("reads_per_s", runReaders(false));
+  benchEnd();
+
+  keypad.resetRTOSStats();
+  uint32_t waitsPerSecond = runReaders(true);
+  TTP229::RTOSStats stats = keypad.getRTOSStats();
+  benchBegin("contention");
+  benchUint("waiter_tasks", READER_TASKS);
+  benchUint("waits_per_s", waitsPerSecond);
+  benchUint("contentions", stats.mutexContentions);
+  benchUint("timeouts", stats.mutexTimeouts);
+  benchEnd();
+
+  // The scan task feeds the queue now - measure its latency too
+  benchLatency("rtos", false);
+  keypad.endRTOS();
+}
+#endif
+
+// ==============================================
+// SKETCH
+// ==============================================
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("# TTP229 benchmark suite");
+  keypad.begin();
+
+  benchScan(TTP229::BACKEND_BITBANG, "bitbang");
+  benchScan(TTP229::BACKEND_SPI, "spi");
+  keypad.begin();
+
+  benchRing();
+  benchLatency("poll", true);
+  benchSustained();
+
+  #if TTP229_RTOS_SUPPORT && defined(ESP32)
+  benchContention();
+  #endif
+
+  Serial.println("# done");
+}
+
+void loop() {
+  delay(1000);
+}
+
+#if defined(TTP229_HOST_SIM)
+int main() {
+  TTP229HostSim& sim = ttp229HostSim();
+  sim.serial.echo = true;
+  sim.ioCostNs = 100;  // Rough cost of a digitalWrite()/digitalRead()
+  sim.attachChip(SCL_PIN, SDO_PIN);
+  setup();
+  return 0;
+}
+#endif
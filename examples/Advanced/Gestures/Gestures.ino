@@ -0,0 +1,65 @@
+/*
+   TTP229 Gestures Example
+   Double/multi-tap, swipes across the 4x4 grid and chords.
+   
+   Try:
+   - Tap a key twice (or more) quickly
+   - Slide a finger along a row (left/right) or a column (up/down)
+   - Touch two or more keys together and hold them
+*/
+
+#include <TTP229.h>
+
+TTP229 keypad(2, 3, true);  // SCL=2, SDO=3, 16-key mode
+
+void setup() {
+  Serial.begin(115200);
+  keypad.begin();
+  
+  // Tap: press <= 250ms, taps <= 300ms apart. Swipe: <= 200ms per key.
+  // Chord: keys touched within 80ms of each other.
+  keypad.setGestureTiming(250, 300, 200, 80);
+  keypad.setSwipeLength(3);
+  keypad.enableGestures(TTP229::EVENT_MASK_GESTURES);
+  
+  Serial.println("TTP229 Gestures - tap, swipe or chord");
+}
+
+void loop() {
+  keypad.read();
+  
+  TTP229::KeyEvent event;
+  while (keypad.getKeyEvents(event)) {
+    switch (event.eventType) {
+      case TTP229::EVENT_DOUBLE_TAP:
+      case TTP229::EVENT_MULTI_TAP:
+        Serial.print("Tap x");
+        Serial.print(event.data);
+        Serial.print(" on key ");
+        Serial.println(event.key);
+        break;
+        
+      case TTP229::EVENT_SWIPE_LEFT:
+      case TTP229::EVENT_SWIPE_RIGHT:
+      case TTP229::EVENT_SWIPE_UP:
+      case TTP229::EVENT_SWIPE_DOWN: {
+        static const char* const directions[] = { "left", "right", "up", "down" };
+        Serial.print("Swipe ");
+        Serial.print(directions[event.eventType - TTP229::EVENT_SWIPE_LEFT]);
+        Serial.print(" to key ");
+        Serial.print(event.key);
+        Serial.print(", ");
+        Serial.print(event.data);
+        Serial.println(" keys/s");
+        break;
+      }
+        
+      case TTP229::EVENT_CHORD:
+        Serial.print("Chord 0x");
+        Serial.println(event.data, HEX);
+        break;
+    }
+  }
+  
+  delay(5);
+}
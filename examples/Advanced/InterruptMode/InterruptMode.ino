@@ -0,0 +1,43 @@
+/*
+   TTP229 Interrupt Mode Example
+   Scans only when the chip signals data valid on SDO.
+   While nothing is touched no frames are clocked out at all.
+   
+   SDO must be on an interrupt-capable pin (pin 2 or 3 on Uno/Nano,
+   any GPIO on ESP32).
+*/
+
+#include <TTP229.h>
+
+TTP229 keypad(2, 3, true);  // SCL=2, SDO=3 (INT1 on Uno)
+
+uint32_t loops = 0;
+uint32_t lastReport = 0;
+
+void setup() {
+  Serial.begin(115200);
+  keypad.begin();
+  
+  if (keypad.enableInterruptMode()) {
+    Serial.println("Interrupt mode enabled");
+  } else {
+    Serial.println("SDO pin has no interrupt - staying in polling mode");
+  }
+}
+
+void loop() {
+  uint8_t key = keypad.read();  // Returns immediately while idle
+  loops++;
+  
+  if (keypad.wasPressed()) {
+    Serial.print("Key pressed: ");
+    Serial.println(key);
+  }
+  
+  if (millis() - lastReport > 5000) {
+    lastReport = millis();
+    Serial.print("Loop iterations in 5s: ");
+    Serial.println(loops);
+    loops = 0;
+  }
+}
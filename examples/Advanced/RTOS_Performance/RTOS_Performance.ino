@@ -1,6 +1,9 @@
 /*
    TTP229 RTOS Performance Test
    Measures RTOS vs non-RTOS performance
+   
+   For scan cost, latency histograms and machine-readable results see
+   Advanced/BenchmarkSuite.
 */
 
 #include <TTP229.h>
@@ -22,6 +25,7 @@ TestMode currentMode = MODE_NON_RTOS;
 uint32_t testStartTime = 0;
 uint32_t readCount = 0;
 uint32_t eventCount = 0;
+portMUX_TYPE countMux = portMUX_INITIALIZER_UNLOCKED;  // Guards readCount
 
 // Performance task
 void performanceTask(void* parameter) {
@@ -34,9 +38,9 @@ void performanceTask(void* parameter) {
         
         // Update global counter every 1000 reads
         if (localReads >= 1000) {
-            portENTER_CRITICAL(&keypadRTOS._statsMutex);
+            portENTER_CRITICAL(&countMux);
             readCount += localReads;
-            portEXIT_CRITICAL(&keypadRTOS._statsMutex);
+            portEXIT_CRITICAL(&countMux);
             localReads = 0;
         }
         
@@ -74,12 +78,10 @@ void runRTOSSinglePerfTest() {
     // Let RTOS task run for 5 seconds
     delay(5000);
     
-    #if TTP229_RTOS_AVAILABLE
+    #if TTP229_RTOS_SUPPORT
     TTP229::RTOSStats stats = keypadRTOS.getRTOSStats();
     Serial.print("Reads per second: ");
     Serial.println(stats.readsPerSecond);
-    Serial.print("Task priority: ");
-    Serial.println(keypadRTOS.getTaskPriority());
     Serial.print("Queue usage: ");
     Serial.println(stats.maxQueueUsage);
     #endif
@@ -121,6 +123,11 @@ void runRTOSMultiPerfTest() {
     Serial.println(readsPerSec, 1);
     Serial.print("Reads per task: ");
     Serial.println(readCount / numTasks);
+    
+    // read() copies the published snapshot without the mutex, so the
+    // tasks never wait on each other or on the scan task. Mutex
+    // contention is measured in BenchmarkSuite (waitForEvent() callers).
+    Serial.println("Lock-free reads: no mutex contention");
 }
 
 void runRTOSQueuePerfTest() {
@@ -146,7 +153,7 @@ void runRTOSQueuePerfTest() {
     Serial.print("Events processed per second: ");
     Serial.println(eventsPerSec, 1);
     
-    #if TTP229_RTOS_AVAILABLE
+    #if TTP229_RTOS_SUPPORT
     TTP229::RTOSStats stats = keypadRTOS.getRTOSStats();
     Serial.print("Queue overflows: ");
     Serial.println(stats.queueOverflows);
@@ -189,15 +196,15 @@ void loop() {
     if (millis() - lastDisplay > 10000) {
         lastDisplay = millis();
         
-        #if TTP229_RTOS_AVAILABLE
+        #if TTP229_RTOS_SUPPORT
         if (keypadRTOS.isRTOSEnabled()) {
             TTP229::RTOSStats stats = keypadRTOS.getRTOSStats();
             Serial.print("[Status] Reads/sec: ");
             Serial.print(stats.readsPerSecond);
             Serial.print(" Queue: ");
             Serial.print(keypadRTOS.getQueueCount());
-            Serial.print("/");
-            Serial.println(keypadRTOS._queueSize);
+            Serial.print(" Overflows: ");
+            Serial.println(keypadRTOS.getQueueOverflows());
         }
         #endif
     }
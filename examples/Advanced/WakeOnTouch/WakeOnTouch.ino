@@ -0,0 +1,60 @@
+/*
+   TTP229 Wake-on-Touch Example
+   Sleeps after 5s without a touch and wakes on the next one.
+   The touch that wakes the board is delivered as the first event.
+   
+   Sleep modes:
+   - ESP32:  light sleep (GPIO wake-up) / deep sleep (EXT0, restarts)
+   - AVR:    idle / power-down (SDO on pin 2 or 3 on Uno/Nano)
+   - RP2040: WFE / dormant (dormant needs pico-extras)
+*/
+
+#include <TTP229.h>
+
+TTP229 keypad(2, 3, true);  // SCL=2, SDO=3 (INT1 on Uno)
+
+const uint32_t IDLE_BEFORE_SLEEP_MS = 5000;
+uint32_t lastActivity = 0;
+
+void setup() {
+  Serial.begin(115200);
+  keypad.begin();
+  
+  // Restarted from deep sleep by a touch? (ESP32)
+  if (keypad.wokeByTouch()) {
+    Serial.print("Woke from deep sleep, first event after ");
+    Serial.print(keypad.getWakeLatency());
+    Serial.println(" us");
+  }
+  
+  lastActivity = millis();
+}
+
+void loop() {
+  keypad.read();
+  
+  TTP229::KeyEvent event;
+  while (keypad.getKeyEvents(event)) {
+    lastActivity = millis();
+    if (event.eventType == TTP229::EVENT_PRESS) {
+      Serial.print("Key ");
+      Serial.println(event.key);
+    }
+  }
+  
+  if (!keypad.isPressed() && millis() - lastActivity > IDLE_BEFORE_SLEEP_MS) {
+    Serial.println("Sleeping until touch...");
+    Serial.flush();
+    
+    if (keypad.sleepUntilTouch(TTP229::SLEEP_DEEP)) {
+      Serial.print("Woke on touch, first event after ");
+      Serial.print(keypad.getWakeLatency());
+      Serial.println(" us");
+    } else {
+      Serial.println("Sleep not available on this board/pin");
+    }
+    lastActivity = millis();
+  }
+  
+  delay(10);
+}
@@ -1,6 +1,7 @@
 /*
    TTP229 Volume Control / Menu Navigation
-   Use keypad as a media controller or menu navigator
+   Use keypad as a media controller or menu navigator.
+   Each key has its own press handler - loop() only dispatches.
 */
 
 #include <TTP229.h>
@@ -35,103 +36,96 @@ void setup() {
   Serial.println("A-D: Direct Functions");
   Serial.println("=======================\n");
   
+  keypad.onPress(1, playPause);
+  keypad.onPress(2, nextTrack);
+  keypad.onPress(3, previousTrack);
+  keypad.onPress(4, menuUp);             // Key A
+  keypad.onPress(5, volumeUp);
+  keypad.onRepeat(5, volumeUp);          // Hold to keep stepping
+  keypad.onPress(6, volumeDown);
+  keypad.onRepeat(6, volumeDown);
+  keypad.onPress(7, menuDown);           // Key C
+  keypad.onPress(8, toggleMute);
+  keypad.onPress(15, selectItem);        // Key #
+  keypad.onPress(TTP229::KEY_ANY, pressed);  // Runs after the key's own handler
+  
+  // Volume keys repeat after 400ms, every 150ms speeding up to 50ms
+  keypad.setAutoRepeat(400, 150, 50, TTP229::keyToMask(5) | TTP229::keyToMask(6));
+  
   displayStatus();
 }
 
 void loop() {
-  uint8_t key = keypad.read();
-  
-  if (keypad.wasPressed()) {
-    switch(key) {
-      case 1:  // Key 1 - Play/Pause
-        isPlaying = !isPlaying;
-        Serial.print("Play/Pause: ");
-        Serial.println(isPlaying ? "Playing" : "Paused");
-        break;
-        
-      case 2:  // Key 2 - Next
-        Serial.println(">> Next Track");
-        break;
-        
-      case 3:  // Key 3 - Previous
-        Serial.println("<< Previous Track");
-        break;
-        
-      case 4:  // Key 4 - A (Menu Up)
-        currentMenuItem = (currentMenuItem - 1 + 8) % 8;
-        displayMenu();
-        break;
-        
-      case 5:  // Key 5 - Volume Up
-        if (!isMuted && volumeLevel < 100) {
-          volumeLevel += 5;
-          if (volumeLevel > 100) volumeLevel = 100;
-          Serial.print("Volume: ");
-          Serial.println(volumeLevel);
-        }
-        break;
-        
-      case 6:  // Key 6 - Volume Down
-        if (!isMuted && volumeLevel > 0) {
-          volumeLevel -= 5;
-          if (volumeLevel < 0) volumeLevel = 0;
-          Serial.print("Volume: ");
-          Serial.println(volumeLevel);
-        }
-        break;
-        
-      case 7:  // Key 7 - C (Menu Down)
-        currentMenuItem = (currentMenuItem + 1) % 8;
-        displayMenu();
-        break;
-        
-      case 8:  // Key 8 - Mute Toggle
-        isMuted = !isMuted;
-        Serial.print("Mute: ");
-        Serial.println(isMuted ? "ON" : "OFF");
-        break;
-        
-      case 9:  // Key 9 - Enter Settings
-        Serial.println("Entering Settings...");
-        break;
-        
-      case 10: // Key A
-        Serial.println("Function A");
-        break;
-        
-      case 11: // Key B
-        Serial.println("Function B");
-        break;
-        
-      case 12: // Key C
-        Serial.println("Function C");
-        break;
-        
-      case 13: // Key * - Back
-        Serial.println("Back/Exit");
-        break;
-        
-      case 14: // Key 0 - Special
-        Serial.println("Special Function");
-        break;
-        
-      case 15: // Key # - Select/Confirm
-        Serial.print("Selected: ");
-        Serial.println(menuItems[currentMenuItem]);
-        break;
-        
-      case 16: // Key D
-        Serial.println("Function D");
-        break;
-    }
-    
-    // Update status display
-    displayStatus();
-  }
-  
+  keypad.dispatchEvents();  // Scans and runs the handlers
   delay(10);
 }
 
+// Key handlers
+void playPause(const TTP229::KeyEvent& event) {
+  isPlaying = !isPlaying;
+  Serial.print("Play/Pause: ");
+  Serial.println(isPlaying ? "Playing" : "Paused");
+}
+
+void nextTrack(const TTP229::KeyEvent& event) {
+  Serial.println(">> Next Track");
+}
+
+void previousTrack(const TTP229::KeyEvent& event) {
+  Serial.println("<< Previous Track");
+}
+
+void menuUp(const TTP229::KeyEvent& event) {
+  currentMenuItem = (currentMenuItem - 1 + 8) % 8;
+  displayMenu();
+}
+
+void menuDown(const TTP229::KeyEvent& event) {
+  currentMenuItem = (currentMenuItem + 1) % 8;
+  displayMenu();
+}
+
+void volumeUp(const TTP229::KeyEvent& event) {
+  if (isMuted) return;
+  volumeLevel += 5;
+  if (volumeLevel > 100) volumeLevel = 100;
+  Serial.print("Volume: ");
+  Serial.println(volumeLevel);
+}
+
+void volumeDown(const TTP229::KeyEvent& event) {
+  if (isMuted) return;
+  volumeLevel -= 5;
+  if (volumeLevel < 0) volumeLevel = 0;
+  Serial.print("Volume: ");
+  Serial.println(volumeLevel);
+}
+
+void toggleMute(const TTP229::KeyEvent& event) {
+  isMuted = !isMuted;
+  Serial.print("Mute: ");
+  Serial.println(isMuted ? "ON" : "OFF");
+}
+
+void selectItem(const TTP229::KeyEvent& event) {
+  Serial.print("Selected: ");
+  Serial.println(menuItems[currentMenuItem]);
+}
+
+// Every press: keys without their own handler, then the status line
+void pressed(const TTP229::KeyEvent& event) {
+  static const char* const otherKeys[] = {
+    "Entering Settings...", "Function A", "Function B", "Function C",
+    "Back/Exit", "Special Function"
+  };
+  if (event.key >= 9 && event.key <= 14) {
+    Serial.println(otherKeys[event.key - 9]);
+  } else if (event.key == 16) {
+    Serial.println("Function D");
+  }
+  displayStatus();
+}
+
 void displayStatus() {
   Serial.println("\n--- Current Status ---");
   Serial.print("State: ");
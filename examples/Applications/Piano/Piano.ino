@@ -78,10 +78,11 @@ void setup() {
 
 void loop() {
   uint8_t key = keypad.read();
+  uint16_t keys = keypad.getKeyMask();  // All touched keys - chords included
   
   // Check for note presses
   for (int i = 1; i <= 16; i++) {
-    if (keypad.isKeyPressed(i)) {
+    if (keys & TTP229::keyToMask(i)) {
       if (!notePlaying[i-1]) {
         playNote(i);
         notePlaying[i-1] = true;
@@ -0,0 +1,64 @@
+/*
+   TTP229 Event Queue Example (any board)
+   Press, release, hold and long-press events without an RTOS.
+
+   On AVR a Timer1 interrupt scans the keypad every 10ms via service(),
+   so loop() can be slow (here: 500ms per pass) and still see every
+   press in order. On other boards read() drives the scan from loop().
+*/
+
+#include <TTP229.h>
+
+TTP229 keypad(2, 3, true);  // SCL=2, SDO=3, 16-key mode
+
+#if defined(ARDUINO_ARCH_AVR)
+ISR(TIMER1_COMPA_vect) {
+  keypad.service();  // Scan, debounce, queue events
+}
+
+void startScanTimer() {
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);  // CTC, clk/64
+  OCR1A = (F_CPU / 64 / 100) - 1;               // 100Hz
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+  keypad.begin();
+  keypad.setHoldThreshold(800);
+
+  #if defined(ARDUINO_ARCH_AVR)
+  startScanTimer();
+  Serial.println("Scanning from Timer1");
+  #else
+  Serial.println("Scanning from loop()");
+  #endif
+}
+
+void loop() {
+  #if !defined(ARDUINO_ARCH_AVR)
+  keypad.read();
+  #endif
+
+  TTP229::KeyEvent event;
+  while (keypad.getKeyEvents(event)) {
+    Serial.print("Key ");
+    Serial.print(event.key);
+    switch (event.eventType) {
+      case TTP229::EVENT_PRESS:      Serial.println(" PRESS"); break;
+      case TTP229::EVENT_RELEASE:    Serial.println(" RELEASE"); break;
+      case TTP229::EVENT_HOLD:       Serial.println(" HOLD"); break;
+      case TTP229::EVENT_LONG_PRESS: Serial.println(" LONG_PRESS"); break;
+    }
+  }
+
+  #if defined(ARDUINO_ARCH_AVR)
+  delay(500);  // Slow main loop - the timer keeps scanning
+  #else
+  delay(10);
+  #endif
+}
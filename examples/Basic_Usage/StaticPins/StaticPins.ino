@@ -0,0 +1,33 @@
+/*
+   TTP229 Static Pins Example
+   Compile-time wiring: pins, key count and clock timing are template
+   parameters, so the scan loop is unrolled and the object is tiny.
+*/
+
+#include <TTP229Static.h>
+
+// SCL=2, SDO=3, 16 keys, 2000ns clock half period
+TTP229Static<2, 3, 16, 2000> keypad;
+
+void setup() {
+  Serial.begin(115200);
+  keypad.begin();
+  
+  Serial.print("Keypad object size: ");
+  Serial.print(sizeof(keypad));
+  Serial.println(" bytes");
+}
+
+void loop() {
+  keypad.read();
+  
+  uint16_t pressed = keypad.getPressedMask();
+  for (uint8_t key = 1; key <= 16; key++) {
+    if (pressed & ttp229KeyToMask(key)) {
+      Serial.print("Key pressed: ");
+      Serial.println(key);
+    }
+  }
+  
+  delay(10);
+}
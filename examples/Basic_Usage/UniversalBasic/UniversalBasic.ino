@@ -13,7 +13,7 @@ void setup() {
   delay(1000);
   
   // Initialize with debug info
-  keypad.begin(true);  // true enables debug output
+  keypad.begin(true);  // true enables debug output (errors; build with TTP229_LOG_LEVEL=3 for status)
   
   Serial.println("\nPress any key on the keypad...");
 }
@@ -120,7 +120,7 @@ void loop() {
     if (millis() - lastStats > 5000) {
         lastStats = millis();
         
-        #if TTP229_RTOS_AVAILABLE
+        #if TTP229_RTOS_SUPPORT
         TTP229::RTOSStats stats = keypad.getRTOSStats();
         Serial.println("\n--- RTOS Statistics ---");
         Serial.print("Reads/sec: ");
@@ -0,0 +1,68 @@
+/*
+   TTP229 RTOS Multi-Keypad Example
+   Three keypads scanned by ONE task into ONE event queue.
+   Keypads 0 and 1 share the SCL line and are clocked together.
+*/
+
+#include <TTP229.h>
+#include <TTP229Group.h>
+
+TTP229 keypadA(18, 19, true);   // Shared SCL=18
+TTP229 keypadB(18, 21, true);   // Shared SCL=18
+TTP229 keypadC(22, 23, true);   // Own clock line
+
+TTP229Group keypads(2, 4096);   // Priority 2, 4KB stack
+
+const char* names[] = { "A", "B", "C" };
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    
+    Serial.println("=== TTP229 Multi-Keypad Example ===");
+    
+    keypadA.begin();
+    keypadB.begin();
+    keypadC.begin();
+    
+    keypads.addDevice(keypadA);  // id 0
+    keypads.addDevice(keypadB);  // id 1
+    keypads.addDevice(keypadC);  // id 2
+    
+    if (!keypads.begin(10)) {    // Scan all keypads every 10ms
+        Serial.println("ERROR: Failed to start keypad group");
+    }
+}
+
+void loop() {
+    TTP229Group::GroupEvent e;
+    while (keypads.getEvent(e)) {
+        Serial.print("Keypad ");
+        Serial.print(names[e.deviceId]);
+        Serial.print(": key ");
+        Serial.print(e.event.key);
+        Serial.println(e.event.eventType == TTP229::EVENT_PRESS ? " pressed" :
+                       e.event.eventType == TTP229::EVENT_RELEASE ? " released" : " held");
+    }
+    
+    static uint32_t lastStats = 0;
+    if (millis() - lastStats > 10000) {
+        lastStats = millis();
+        for (uint8_t i = 0; i < keypads.getDeviceCount(); i++) {
+            TTP229Group::DeviceStats stats = keypads.getDeviceStats(i);
+            Serial.print("[Stats] ");
+            Serial.print(names[i]);
+            Serial.print(" scans=");
+            Serial.print(stats.scans);
+            Serial.print(" events=");
+            Serial.print(stats.events);
+            Serial.print(" overflows=");
+            Serial.print(stats.queueOverflows);
+            Serial.print(" scan=");
+            Serial.print(stats.lastScanTime);
+            Serial.println("us");
+        }
+    }
+    
+    delay(10);
+}
@@ -1,6 +1,6 @@
 /*
    TTP229 RTOS Multi-Task Example
-   Multiple tasks using the same keypad with mutex protection
+   Multiple tasks reading the same keypad through lock-free state snapshots
 */
 
 #include <TTP229.h>
@@ -18,10 +18,14 @@ volatile uint32_t keyPressCount = 0;
 
 // Sound task - plays tones based on keys
 void soundTask(void* parameter) {
+    // Own edge cursor: presses seen here are not taken from other tasks
+    TTP229::Reader keys = keypad.reader();
+    
     while (1) {
-        uint8_t currentKey = keypad.read();
+        keys.update();
         
-        if (keypad.wasPressed()) {
+        if (keys.wasPressed()) {
+            uint8_t currentKey = TTP229::maskToKey(keys.getPressedMask());
             lastKey = currentKey;
             keyPressCount++;
             
@@ -47,26 +51,13 @@ void ledTask(void* parameter) {
     }
     
     while (1) {
-        #if TTP229_RTOS_AVAILABLE
-        // Use mutex-protected read
-        if (keypad.takeMutex(10)) {
-            uint8_t key = keypad.getKey();
-            
-            // Light LEDs based on key
-            if (key != 0) {
-                for (int i = 0; i < 8; i++) {
-                    digitalWrite(ledPins[i], (key & (1 << i)) ? HIGH : LOW);
-                }
-            } else {
-                // Turn off all LEDs when no key
-                for (int i = 0; i < 8; i++) {
-                    digitalWrite(ledPins[i], LOW);
-                }
-            }
-            
-            keypad.giveMutex();
+        // Snapshot copy - the scan task is never held up by the LED writes
+        uint8_t key = keypad.getKeyState().key;
+        
+        // Light LEDs based on key (all off when no key)
+        for (int i = 0; i < 8; i++) {
+            digitalWrite(ledPins[i], (key & (1 << i)) ? HIGH : LOW);
         }
-        #endif
         
         vTaskDelay(pdMS_TO_TICKS(50));
     }
@@ -88,7 +79,7 @@ void serialTask(void* parameter) {
                 
                 // Process command
                 if (strcmp(command, "stats") == 0) {
-                    #if TTP229_RTOS_AVAILABLE
+                    #if TTP229_RTOS_SUPPORT
                     TTP229::RTOSStats stats = keypad.getRTOSStats();
                     Serial.print("Key presses: ");
                     Serial.println(keyPressCount);
@@ -96,11 +87,13 @@ void serialTask(void* parameter) {
                     Serial.println(lastKey);
                     Serial.print("Queue items: ");
                     Serial.println(keypad.getQueueCount());
+                    Serial.print("Reads/sec: ");
+                    Serial.println(stats.readsPerSecond);
                     #endif
                 }
                 else if (strcmp(command, "reset") == 0) {
                     keyPressCount = 0;
-                    #if TTP229_RTOS_AVAILABLE
+                    #if TTP229_RTOS_SUPPORT
                     keypad.resetRTOSStats();
                     #endif
                     Serial.println("Statistics reset");
@@ -22,13 +22,14 @@ void setup() {
     Serial.print("Queue count: ");
     Serial.println(keypad.getQueueCount());
     
-    TTP229::KeyEvent event;
-    int eventCount = 0;
+    // Drain the whole queue in one call
+    TTP229::KeyEvent events[TTP229_EVENT_QUEUE_CAPACITY];
+    size_t eventCount = keypad.getKeyEvents(events, TTP229_EVENT_QUEUE_CAPACITY);
     
-    while (keypad.getKeyEvents(event)) {
-        eventCount++;
+    for (size_t i = 0; i < eventCount; i++) {
+        TTP229::KeyEvent& event = events[i];
         Serial.print("\nEvent ");
-        Serial.print(eventCount);
+        Serial.print(i + 1);
         Serial.print(": Key=");
         Serial.print(event.key);
         Serial.print(", Type=");
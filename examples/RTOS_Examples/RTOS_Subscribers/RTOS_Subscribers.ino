@@ -0,0 +1,54 @@
+/*
+   TTP229 RTOS Subscribers Example (ESP32)
+   Several tasks block in waitForEvent(), each with its own filter.
+   The scan task wakes each one directly with the event it asked for -
+   no task polls the queue.
+   
+   - digitTask: presses on keys 1-10
+   - holdTask:  hold and long press on any key
+   - loop():    every release of key 16, with a 5s timeout
+*/
+
+#include <TTP229.h>
+
+TTP229 keypad(18, 19, true, 2, 4096);
+
+void digitTask(void* parameter) {
+  TTP229::KeyEvent event;
+  for (;;) {
+    if (keypad.waitForEvent(event, 0xFFFFFFFF, TTP229::EVENT_MASK_PRESS, 0x03FF)) {
+      Serial.print("[digit] ");
+      Serial.println(event.key % 10);
+    }
+  }
+}
+
+void holdTask(void* parameter) {
+  TTP229::KeyEvent event;
+  for (;;) {
+    if (keypad.waitForEvent(event, 0xFFFFFFFF,
+                            TTP229::EVENT_MASK_HOLD | TTP229::EVENT_MASK_LONG_PRESS)) {
+      Serial.print("[hold] key ");
+      Serial.print(event.key);
+      Serial.println(event.eventType == TTP229::EVENT_HOLD ? " HOLD" : " LONG_PRESS");
+    }
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  keypad.begin();
+  keypad.beginRTOS();
+  
+  xTaskCreate(digitTask, "digits", 2048, NULL, 1, NULL);
+  xTaskCreate(holdTask, "holds", 2048, NULL, 1, NULL);
+}
+
+void loop() {
+  TTP229::KeyEvent event;
+  if (keypad.waitForEvent(event, 5000, TTP229::EVENT_MASK_RELEASE, TTP229::keyToMask(16))) {
+    Serial.println("[loop] key 16 released");
+  } else {
+    Serial.println("[loop] no release of key 16 in 5s");
+  }
+}
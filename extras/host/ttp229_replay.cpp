@@ -0,0 +1,492 @@
+// ==============================================
+// TTP229 REPLAY DRIVER (host tool)
+// ==============================================
+// Runs the full scan pipeline - TTP229ReplaySource backend, debouncer,
+// event machine, gesture recognizer, event queue - over recorded or
+// synthetic frames in virtual time, as fast as the CPU allows. Reports
+// events against ground truth and the cost of each stage per frame, so
+// debounce and hold settings can be swept over millions of frames.
+//
+//   g++ -std=gnu++11 -O2 -DTTP229_HOST_SIM -Isrc src/TTP229.cpp extras/host/ttp229_replay.cpp -o ttp229_replay
+//
+//   ttp229_replay --synthetic 1000000 [--seed N] [--glitch RATE] [--bounce-ms MS] [--period-us US]
+//   ttp229_replay --file capture.bin [--truth touches.txt]
+//
+//   Pipeline:  --debounce PRESS RELEASE  --hold HOLD_MS LONG_MS  --keys 8|16  --gestures
+//   Output:    --events (print every event)  --sweep (all debounce pairs)
+//
+// Files are memory-mapped: a dumpTrace() capture, or bare 6-byte frame
+// records (TTP229Trace.h) of any length. A capture replays with the
+// debounce, hold and key settings from its header, so it runs like the
+// unit that recorded it; the pipeline options above override them. Ground truth for a file is one
+// touch per line, "key down_ms up_ms", relative to the first frame.
+// Synthetic runs generate their own: single touches with contact bounce
+// at both edges and random one-frame glitches on any key.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "TTP229.h"
+
+struct Touch {
+    uint8_t key;
+    uint64_t downUs;
+    uint64_t upUs;
+};
+
+struct Settings {
+    uint8_t pressScans;
+    uint8_t releaseScans;
+    uint16_t holdMs;
+    uint16_t longPressMs;
+    uint8_t keys;
+    bool gestures;
+    bool printEvents;
+};
+
+struct TimedEvent {
+    uint64_t us;         // Frame that accepted it, virtual time
+    uint8_t key;
+    uint8_t type;
+};
+
+struct Score {
+    size_t correct;
+    size_t missed;
+    size_t spurious;
+    double meanLatencyMs;
+    double maxLatencyMs;
+};
+
+static const uint64_t RELEASE_SLACK_US = 250000;  // Latest a release may follow the lift
+
+static const char* const EVENT_NAMES[TTP229_EVENT_TYPES] = {
+    "PRESS", "RELEASE", "HOLD", "LONG_PRESS", "REPEAT", "DOUBLE_TAP",
+    "MULTI_TAP", "SWIPE_LEFT", "SWIPE_RIGHT", "SWIPE_UP", "SWIPE_DOWN", "CHORD"
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ==============================================
+// INPUT
+// ==============================================
+
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void synthesize(size_t frames, uint8_t keys, uint32_t periodUs, uint32_t seed, double glitchRate,
+                       uint32_t bounceUs, std::vector<uint8_t>& records, std::vector<Touch>& truth) {
+    uint32_t rng = seed ? seed : 1;
+    uint64_t endUs = (uint64_t)frames * periodUs;
+    for (uint64_t at = 0;;) {
+        Touch touch;
+        touch.downUs = at + 100000 + nextRandom(rng) % 500000;   // 100-600 ms idle
+        touch.upUs = touch.downUs + 40000 + nextRandom(rng) % 1200000;  // 40-1240 ms held
+        touch.key = (uint8_t)(1 + nextRandom(rng) % keys);
+        if (touch.upUs + bounceUs >= endUs) break;
+        truth.push_back(touch);
+        at = touch.upUs + bounceUs;
+    }
+
+    uint32_t glitchThreshold = (uint32_t)(glitchRate * 4294967295.0);
+    records.resize(frames * TTP229_TRACE_FRAME_BYTES);
+    size_t next = 0;
+    for (size_t i = 0; i < frames; i++) {
+        uint64_t t = (uint64_t)i * periodUs;
+        while (next < truth.size() && truth[next].upUs + bounceUs <= t) next++;
+
+        uint16_t mask = 0;
+        if (next < truth.size() && t >= truth[next].downUs) {
+            const Touch& touch = truth[next];
+            bool bouncing = t < touch.downUs + bounceUs || t >= touch.upUs;
+            bool touched = t < touch.upUs;
+            if (bouncing) touched = (nextRandom(rng) & 1) != 0;
+            if (touched) mask = ttp229KeyToMask(touch.key);
+        }
+        if (glitchThreshold && nextRandom(rng) < glitchThreshold) {
+            mask ^= (uint16_t)(1u << (nextRandom(rng) % keys));
+        }
+
+        TTP229TraceFrame frame;
+        frame.micros = (uint32_t)t;
+        frame.mask = mask;
+        ttp229EncodeTraceFrame(&records[i * TTP229_TRACE_FRAME_BYTES], frame);
+    }
+}
+
+// Read-only mapping of a whole file, unmapped when it goes out of scope
+struct MappedFile {
+    const uint8_t* data;
+    size_t length;
+
+    MappedFile() : data(NULL), length(0) {}
+    ~MappedFile() {
+        if (data != NULL) munmap((void*)data, length);
+    }
+
+    bool map(const char* path) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        void* mapped = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+        data = (const uint8_t*)mapped;
+        length = (size_t)info.st_size;
+        return true;
+    }
+};
+
+static bool loadTruth(const char* path, std::vector<Touch>& truth) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return false;
+    unsigned key;
+    double downMs, upMs;
+    while (fscanf(file, "%u %lf %lf", &key, &downMs, &upMs) == 3) {
+        Touch touch;
+        touch.key = (uint8_t)key;
+        touch.downUs = (uint64_t)(downMs * 1000);
+        touch.upUs = (uint64_t)(upMs * 1000);
+        truth.push_back(touch);
+    }
+    fclose(file);
+    std::sort(truth.begin(), truth.end(),
+              [](const Touch& a, const Touch& b) { return a.downUs < b.downUs; });
+    return true;
+}
+
+// ==============================================
+// SCORING
+// ==============================================
+// A press counts once for the touch it falls in (bounce tail included),
+// a release once within RELEASE_SLACK_US after the lift. Everything else
+// is spurious; touches without either are missed.
+
+static Score score(const std::vector<TimedEvent>& events, const std::vector<Touch>& truth,
+                   uint8_t type, uint64_t bounceUs) {
+    Score result;
+    memset(&result, 0, sizeof(result));
+    std::vector<bool> credited(truth.size(), false);
+    double latencySum = 0;
+
+    for (size_t i = 0; i < events.size(); i++) {
+        const TimedEvent& event = events[i];
+        if (event.type != type) continue;
+
+        // Last touch of this key that started (press) or ended (release) before the event
+        size_t match = truth.size();
+        for (size_t j = std::upper_bound(truth.begin(), truth.end(), event.us,
+                                         [](uint64_t us, const Touch& t) { return us < t.downUs; }) -
+                        truth.begin();
+             j-- > 0;) {
+            if (truth[j].key != event.key) continue;
+            uint64_t from = type == TTP229_EVENT_PRESS ? truth[j].downUs : truth[j].upUs;
+            uint64_t until = type == TTP229_EVENT_PRESS ? truth[j].upUs + bounceUs
+                                                        : truth[j].upUs + RELEASE_SLACK_US;
+            if (event.us >= from && event.us <= until) match = j;
+            break;
+        }
+
+        if (match == truth.size() || credited[match]) {
+            result.spurious++;
+            continue;
+        }
+        credited[match] = true;
+        result.correct++;
+        uint64_t from = type == TTP229_EVENT_PRESS ? truth[match].downUs : truth[match].upUs;
+        double latencyMs = (event.us - from) / 1000.0;
+        latencySum += latencyMs;
+        if (latencyMs > result.maxLatencyMs) result.maxLatencyMs = latencyMs;
+    }
+
+    result.missed = truth.size() - result.correct;
+    result.meanLatencyMs = result.correct ? latencySum / result.correct : 0;
+    return result;
+}
+
+// ==============================================
+// PIPELINE RUNS
+// ==============================================
+
+// Full library path: TTP229::service() with the replay backend, one call
+// per frame at the frame's virtual time. Returns ns per frame.
+static double runPipeline(const Settings& settings, const uint8_t* records, size_t count,
+                          std::vector<TimedEvent>& events, uint32_t* counts) {
+    TTP229HostSim& sim = ttp229HostSim();
+    sim.nowNs = 0;
+
+    TTP229ReplaySource source(records, count);
+    TTP229* keypad = new TTP229(2, 3, settings.keys == 16);
+    keypad->begin(source);
+    keypad->setDebounce(settings.pressScans, settings.releaseScans);
+    keypad->setHoldThreshold(settings.holdMs, settings.longPressMs);
+    keypad->setQueueSize(TTP229_EVENT_QUEUE_CAPACITY);
+    if (settings.gestures) keypad->enableGestures();
+
+    events.clear();
+    uint64_t nowUs = 0;
+    uint32_t previous = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    TTP229TraceFrame frame;
+    for (size_t i = 0; source.peek(frame); i++) {
+        if (i == 0) previous = frame.micros;
+        nowUs += frame.micros - previous;  // Recorded micros() wraps
+        previous = frame.micros;
+        sim.nowNs = (nowUs + 1000) * 1000;  // Keep millis() above 0
+
+        keypad->service();
+
+        TTP229::KeyEvent event;
+        while (keypad->getKeyEvents(event)) {
+            TimedEvent timed;
+            timed.us = nowUs;
+            timed.key = event.key;
+            timed.type = event.eventType;
+            events.push_back(timed);
+            counts[event.eventType]++;
+        }
+    }
+
+    double ns = secondsSince(start) * 1e9 / (count ? count : 1);
+    delete keypad;
+    return ns;
+}
+
+struct CountingSink {
+    uint32_t events;
+    void emitEvent(uint8_t, uint8_t, uint16_t) { events++; }
+};
+
+// The same stages on their own (TTP229Core.h), each pass adding one, to
+// split the per-frame cost. ns per frame up to and including read,
+// debounce, events, gestures; best of three passes.
+static void timeStages(const Settings& settings, const uint8_t* records, size_t count, double* ns) {
+    volatile uint32_t guard = 0;  // Keeps the loops from being optimized out
+    for (uint8_t pass = 0; pass < 12; pass++) {
+        uint8_t stages = 1 + pass % 4;
+        TTP229ReplaySource source(records, count);
+        TTP229Debouncer debouncer;
+        debouncer.reset();
+        debouncer.setThresholds(settings.pressScans, settings.releaseScans);
+        TTP229EventMachine machine;
+        machine.reset();
+        machine.holdMs = settings.holdMs;
+        machine.longPressMs = settings.longPressMs;
+        machine.repeatDelayMs = 0;
+        machine.repeatMs = 0;
+        machine.repeatFastestMs = 0;
+        machine.repeatKeys = 0xFFFF;
+        machine.nextDeadline = 0;
+        TTP229GestureRecognizer gestures;
+        gestures.reset();
+        gestures.enabled = settings.gestures ? TTP229::EVENT_MASK_GESTURES : 0;
+        gestures.tapMs = TTP229::DEFAULT_TAP_MS;
+        gestures.multiTapMs = TTP229::DEFAULT_MULTI_TAP_MS;
+        gestures.swipeStepMs = TTP229::DEFAULT_SWIPE_STEP_MS;
+        gestures.chordMs = TTP229::DEFAULT_CHORD_MS;
+        gestures.swipeKeys = TTP229::DEFAULT_SWIPE_KEYS;
+        CountingSink sink = {0};
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint32_t accumulated = 0;
+        TTP229TraceFrame frame;
+        while (source.peek(frame)) {
+            uint16_t mask = source.read();
+            if (stages >= 2) mask = debouncer.update(mask);
+            if (stages >= 3) {
+                uint32_t now = frame.micros / 1000;
+                uint16_t previous = machine.keyMask;
+                uint16_t changed = 0;
+                if (mask != previous || machine.due(now)) changed = machine.update(mask, now, sink);
+                if (stages >= 4 && gestures.enabled && (changed || gestures.due(now))) {
+                    gestures.update(changed & mask, changed & previous, mask, now, sink);
+                }
+            }
+            accumulated += mask;
+        }
+        guard = guard + accumulated + sink.events;
+        double elapsed = secondsSince(start) * 1e9 / (count ? count : 1);
+        if (pass < 4 || elapsed < ns[stages - 1]) ns[stages - 1] = elapsed;
+    }
+    (void)guard;
+}
+
+// Cost of one stage: its pass minus the one before, never below 0
+static double stageCost(const double* ns, uint8_t stage) {
+    double cost = stage ? ns[stage] - ns[stage - 1] : ns[0];
+    return cost > 0 ? cost : 0;
+}
+
+static void printScore(const char* name, const Score& s, size_t touches) {
+    printf("%s %zu/%zu correct, %zu missed, %zu spurious, latency mean %.1f ms max %.1f ms\n",
+           name, s.correct, touches, s.missed, s.spurious, s.meanLatencyMs, s.maxLatencyMs);
+}
+
+int main(int argc, char** argv) {
+    Settings settings = { 2, 2, TTP229::DEFAULT_HOLD_THRESHOLD_MS,
+                          TTP229::DEFAULT_LONG_PRESS_THRESHOLD_MS, 16, false, false };
+    bool debounceSet = false, holdSet = false, keysSet = false;  // Given on the command line
+    size_t synthetic = 0;
+    uint32_t seed = 1, periodUs = 10000, bounceUs = 15000;
+    double glitchRate = 0.001;
+    const char* file = NULL;
+    const char* truthFile = NULL;
+    bool sweep = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool more = i + 1 < argc;
+        if (strcmp(arg, "--synthetic") == 0 && more) synthetic = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--seed") == 0 && more) seed = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--glitch") == 0 && more) glitchRate = atof(argv[++i]);
+        else if (strcmp(arg, "--bounce-ms") == 0 && more) bounceUs = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (strcmp(arg, "--period-us") == 0 && more) periodUs = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(arg, "--file") == 0 && more) file = argv[++i];
+        else if (strcmp(arg, "--truth") == 0 && more) truthFile = argv[++i];
+        else if (strcmp(arg, "--debounce") == 0 && i + 2 < argc) {
+            settings.pressScans = (uint8_t)atoi(argv[++i]);
+            settings.releaseScans = (uint8_t)atoi(argv[++i]);
+            debounceSet = true;
+        } else if (strcmp(arg, "--hold") == 0 && i + 2 < argc) {
+            settings.holdMs = (uint16_t)atoi(argv[++i]);
+            settings.longPressMs = (uint16_t)atoi(argv[++i]);
+            holdSet = true;
+        } else if (strcmp(arg, "--keys") == 0 && more) {
+            settings.keys = (uint8_t)atoi(argv[++i]);
+            keysSet = true;
+        } else if (strcmp(arg, "--gestures") == 0) settings.gestures = true;
+        else if (strcmp(arg, "--events") == 0) settings.printEvents = true;
+        else if (strcmp(arg, "--sweep") == 0) sweep = true;
+        else {
+            fprintf(stderr, "Unknown or incomplete option: %s (see the top of ttp229_replay.cpp)\n", arg);
+            return 2;
+        }
+    }
+    if ((synthetic == 0) == (file == NULL) || periodUs == 0) {
+        fprintf(stderr, "Usage: %s --synthetic FRAMES | --file DUMP [options]\n", argv[0]);
+        return 2;
+    }
+    if (settings.keys != 8 && settings.keys != 16) {
+        fprintf(stderr, "--keys must be 8 or 16\n");
+        return 2;
+    }
+
+    // Frames and ground truth
+    std::vector<uint8_t> generated;
+    std::vector<Touch> truth;
+    MappedFile mapped;
+    const uint8_t* records;
+    size_t count;
+    if (synthetic) {
+        synthesize(synthetic, settings.keys, periodUs, seed, glitchRate, bounceUs, generated, truth);
+        records = generated.data();
+        count = synthetic;
+        printf("# synthetic: %zu frames every %u us, %zu touches, bounce %.1f ms, glitch rate %g\n",
+               count, periodUs, truth.size(), bounceUs / 1000.0, glitchRate);
+    } else {
+        if (!mapped.map(file)) {
+            fprintf(stderr, "Cannot map %s\n", file);
+            return 1;
+        }
+        TTP229TraceReader trace(mapped.data, mapped.length);
+        records = trace.valid() ? trace.frames() : mapped.data;
+        count = trace.valid() ? trace.header().frames : mapped.length / TTP229_TRACE_FRAME_BYTES;
+        if (trace.valid()) {
+            // Run as the unit did, unless told otherwise
+            const TTP229TraceHeader& header = trace.header();
+            if (!debounceSet) {
+                settings.pressScans = header.pressScans;
+                settings.releaseScans = header.releaseScans;
+            }
+            if (!holdSet) {
+                settings.holdMs = header.holdMs;
+                settings.longPressMs = header.longPressMs;
+            }
+            if (!keysSet) settings.keys = header.keys;
+        }
+        if (truthFile != NULL && !loadTruth(truthFile, truth)) {
+            fprintf(stderr, "Cannot read %s\n", truthFile);
+            return 1;
+        }
+        printf("# file: %zu frames, %zu ground-truth touches%s\n", count, truth.size(),
+               trace.valid() ? ", settings from the dump header" : "");
+    }
+    if (settings.pressScans < 1 || settings.pressScans > TTP229Debouncer::MAX_SCANS ||
+        settings.releaseScans < 1 || settings.releaseScans > TTP229Debouncer::MAX_SCANS ||
+        settings.holdMs >= settings.longPressMs || (settings.keys != 8 && settings.keys != 16)) {
+        fprintf(stderr, "Invalid debounce (1-%u scans), hold or key count\n", TTP229Debouncer::MAX_SCANS);
+        return 2;
+    }
+
+    // Sweep: every debounce pair, accuracy and cost only
+    if (sweep) {
+        printf("# press release  press_ok missed spurious  release_ok missed spurious  latency_ms  ns/frame\n");
+        for (uint8_t p = 1; p <= TTP229Debouncer::MAX_SCANS; p++) {
+            for (uint8_t r = 1; r <= TTP229Debouncer::MAX_SCANS; r++) {
+                Settings s = settings;
+                s.pressScans = p;
+                s.releaseScans = r;
+                std::vector<TimedEvent> events;
+                uint32_t counts[TTP229_EVENT_TYPES] = {0};
+                double ns = runPipeline(s, records, count, events, counts);
+                Score press = score(events, truth, TTP229_EVENT_PRESS, bounceUs);
+                Score release = score(events, truth, TTP229_EVENT_RELEASE, bounceUs);
+                printf("%7u %7u  %8zu %6zu %8zu  %10zu %6zu %8zu  %10.1f  %8.1f\n", p, r,
+                       press.correct, press.missed, press.spurious, release.correct,
+                       release.missed, release.spurious, press.meanLatencyMs, ns);
+            }
+        }
+        return 0;
+    }
+
+    std::vector<TimedEvent> events;
+    events.reserve(count / 8);
+    uint32_t counts[TTP229_EVENT_TYPES] = {0};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double pipelineNs = runPipeline(settings, records, count, events, counts);
+    double wall = secondsSince(start);
+    double stageNs[4];
+    timeStages(settings, records, count, stageNs);
+
+    if (settings.printEvents) {
+        for (size_t i = 0; i < events.size(); i++) {
+            printf("%12.1f  %3u  %s\n", events[i].us / 1000.0, events[i].key, EVENT_NAMES[events[i].type]);
+        }
+    }
+
+    printf("# debounce %u/%u scans, hold %u/%u ms, %u keys%s\n", settings.pressScans,
+           settings.releaseScans, settings.holdMs, settings.longPressMs, settings.keys,
+           settings.gestures ? ", gestures" : "");
+    printf("frames %zu in %.3f s (%.1f M frames/s)\n", count, wall, count / wall / 1e6);
+    printf("ns/frame: read %.1f, debounce %.1f, events %.1f, gestures %.1f; full pipeline %.1f\n",
+           stageCost(stageNs, 0), stageCost(stageNs, 1), stageCost(stageNs, 2), stageCost(stageNs, 3),
+           pipelineNs);
+    printf("events:");
+    for (uint8_t type = 0; type < TTP229_EVENT_TYPES; type++) {
+        if (counts[type]) printf(" %s=%lu", EVENT_NAMES[type], (unsigned long)counts[type]);
+    }
+    printf("\n");
+    if (!truth.empty()) {
+        printScore("press:  ", score(events, truth, TTP229_EVENT_PRESS, bounceUs), truth.size());
+        printScore("release:", score(events, truth, TTP229_EVENT_RELEASE, bounceUs), truth.size());
+    }
+    return 0;
+}
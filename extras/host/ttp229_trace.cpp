@@ -0,0 +1,162 @@
+// ==============================================
+// TTP229 TRACE DECODER AND REPLAYER (host tool)
+// ==============================================
+// Reads a raw frame dump written by TTP229::dumpTrace() (build the
+// sketch with TTP229_TRACE_DEPTH > 0) and either lists the frames or
+// feeds them, at their recorded times, through the library's debouncer,
+// event machine and gesture recognizer on the host simulation.
+// Debounce and hold settings default to the ones in the dump, so a
+// glitch from the field replays as it happened and can then be re-run
+// with other settings.
+//
+//   g++ -std=gnu++11 -DTTP229_HOST_SIM -Isrc src/TTP229.cpp extras/host/ttp229_trace.cpp -o ttp229_trace
+//
+//   ttp229_trace frames capture.bin
+//   ttp229_trace replay capture.bin [--debounce PRESS RELEASE]
+//                                   [--hold HOLD_MS LONG_MS] [--gestures]
+//
+// The capture may contain other serial output around the dump, e.g.
+// a raw log of the serial port.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "TTP229.h"
+
+static const char* const EVENT_NAMES[TTP229_EVENT_TYPES] = {
+    "PRESS", "RELEASE", "HOLD", "LONG_PRESS", "REPEAT", "DOUBLE_TAP",
+    "MULTI_TAP", "SWIPE_LEFT", "SWIPE_RIGHT", "SWIPE_UP", "SWIPE_DOWN", "CHORD"
+};
+
+static bool loadFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return true;
+}
+
+static void printHeader(const TTP229TraceHeader& header) {
+    printf("# %u frames, %u keys, scan %u ms, debounce %u/%u scans, hold %u/%u ms, last sequence %lu\n",
+           header.frames, header.keys, header.scanIntervalMs, header.pressScans,
+           header.releaseScans, header.holdMs, header.longPressMs,
+           (unsigned long)header.lastSequence);
+}
+
+static int listFrames(TTP229TraceReader& trace) {
+    printHeader(trace.header());
+    printf("# frame  time_ms     gap_us  mask    changed\n");
+
+    TTP229TraceFrame frame;
+    uint32_t first = 0, previous = 0;
+    uint16_t lastMask = 0;
+    for (uint16_t i = 0; trace.next(frame); i++) {
+        if (i == 0) first = previous = frame.micros;
+        printf("%7u  %10.3f  %7lu  0x%04X  0x%04X\n", i,
+               (frame.micros - first) / 1000.0, (unsigned long)(frame.micros - previous),
+               frame.mask, (uint16_t)(frame.mask ^ lastMask));
+        previous = frame.micros;
+        lastMask = frame.mask;
+    }
+    return 0;
+}
+
+static int replay(TTP229TraceReader& trace, int argc, char** argv) {
+    const TTP229TraceHeader& header = trace.header();
+    uint8_t pressScans = header.pressScans, releaseScans = header.releaseScans;
+    uint16_t holdMs = header.holdMs, longPressMs = header.longPressMs;
+    bool gestures = false;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--debounce") == 0 && i + 2 < argc) {
+            pressScans = (uint8_t)atoi(argv[++i]);
+            releaseScans = (uint8_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--hold") == 0 && i + 2 < argc) {
+            holdMs = (uint16_t)atoi(argv[++i]);
+            longPressMs = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gestures") == 0) {
+            gestures = true;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // The simulated chip shows each recorded frame while it is scanned
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, header.keys != 8);
+    sim.attachChip(2, 3, header.keys != 8 ? 16 : 8);
+    keypad.begin();
+    keypad.setScanInterval(header.scanIntervalMs ? header.scanIntervalMs : 10);
+    if (!keypad.setDebounce(pressScans, releaseScans) ||
+        !keypad.setHoldThreshold(holdMs, longPressMs)) {
+        fprintf(stderr, "Invalid debounce or hold settings\n");
+        return 2;
+    }
+    if (gestures) keypad.enableGestures();
+
+    printHeader(header);
+    printf("# replay: debounce %u/%u scans, hold %u/%u ms%s\n", pressScans, releaseScans,
+           holdMs, longPressMs, gestures ? ", gestures" : "");
+    printf("# time_ms (from the first frame)  key  event\n");
+
+    uint32_t counts[TTP229_EVENT_TYPES] = {0};
+    uint64_t startUs = sim.nowUs();
+    uint64_t elapsedUs = 0;
+    uint32_t previous = 0;
+    TTP229TraceFrame frame;
+    for (uint16_t i = 0; trace.next(frame); i++) {
+        if (i == 0) previous = frame.micros;
+        elapsedUs += frame.micros - previous;  // Wraps with micros() on the board
+        previous = frame.micros;
+
+        uint64_t targetUs = startUs + elapsedUs;
+        if (sim.nowUs() < targetUs) sim.advanceNs((targetUs - sim.nowUs()) * 1000);
+        sim.setTouched(frame.mask);
+        keypad.service();
+
+        TTP229::KeyEvent event;
+        while (keypad.getKeyEvents(event)) {
+            counts[event.eventType]++;
+            printf("%9.1f  %3u  %s", (double)(event.timestamp - startUs / 1000),
+                   event.key, EVENT_NAMES[event.eventType]);
+            if (event.eventType >= TTP229::EVENT_DOUBLE_TAP) printf(" data=0x%X", event.data);
+            printf("\n");
+        }
+    }
+
+    printf("# summary:");
+    for (uint8_t type = 0; type < TTP229_EVENT_TYPES; type++) {
+        if (counts[type]) printf(" %s=%lu", EVENT_NAMES[type], (unsigned long)counts[type]);
+    }
+    printf(" over %.1f ms\n", elapsedUs / 1000.0);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || (strcmp(argv[1], "frames") != 0 && strcmp(argv[1], "replay") != 0)) {
+        fprintf(stderr, "Usage: %s frames|replay <dump> [--debounce PRESS RELEASE] "
+                        "[--hold HOLD_MS LONG_MS] [--gestures]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> data;
+    if (!loadFile(argv[2], data)) {
+        fprintf(stderr, "Cannot read %s\n", argv[2]);
+        return 1;
+    }
+    TTP229TraceReader trace(data.data(), data.size());
+    if (!trace.valid()) {
+        fprintf(stderr, "No complete TTP229 trace in %s\n", argv[2]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "frames") == 0) return listFrames(trace);
+    return replay(trace, argc - 3, argv + 3);
+}
@@ -0,0 +1,146 @@
+// TTP229Debouncer (bit-sliced vertical counters) against a plain
+// per-key counter, and the debounced path through TTP229
+
+#include "ttp229_test.h"
+
+// One counter per key: a key flips after its threshold of scans in a
+// row at the new level; a scan back at the old level restarts it
+struct ReferenceDebouncer {
+    uint16_t stable;
+    uint8_t count[16];
+    uint8_t press;
+    uint8_t release;
+
+    void reset(uint8_t pressScans, uint8_t releaseScans) {
+        stable = 0;
+        for (uint8_t i = 0; i < 16; i++) count[i] = 0;
+        press = pressScans;
+        release = releaseScans;
+    }
+
+    uint16_t update(uint16_t raw) {
+        for (uint8_t i = 0; i < 16; i++) {
+            uint16_t bit = (uint16_t)(1u << i);
+            if ((raw & bit) == (stable & bit)) {
+                count[i] = 0;
+                continue;
+            }
+            count[i]++;
+            if (count[i] >= ((raw & bit) ? press : release)) {
+                stable ^= bit;
+                count[i] = 0;
+            }
+        }
+        return stable;
+    }
+};
+
+TEST(matches_reference) {
+    TTP229TestRandom random(11);
+    for (uint8_t press = 1; press <= TTP229Debouncer::MAX_SCANS; press++) {
+        for (uint8_t release = 1; release <= TTP229Debouncer::MAX_SCANS; release++) {
+            TTP229Debouncer debouncer;
+            debouncer.reset();
+            debouncer.setThresholds(press, release);
+            ReferenceDebouncer reference;
+            reference.reset(press, release);
+
+            // Keys held for a while with flicker on top
+            uint16_t held = 0;
+            for (int scan = 0; scan < 20000; scan++) {
+                if (random.below(16) == 0) held ^= (uint16_t)(1u << random.below(16));
+                uint16_t raw = held ^ (uint16_t)(random.next() & random.next() & random.next());
+                uint16_t got = debouncer.update(raw);
+                uint16_t want = reference.update(raw);
+                if (got != want) {
+                    CHECK_EQ(got, want);
+                    printf("  press %u release %u scan %d\n", press, release, scan);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+TEST(thresholds_per_direction) {
+    TTP229Debouncer debouncer;
+    debouncer.reset();
+    debouncer.setThresholds(3, 5);
+
+    CHECK_EQ(debouncer.update(0x0001), 0);
+    CHECK_EQ(debouncer.update(0x0001), 0);
+    CHECK(debouncer.pending());
+    CHECK_EQ(debouncer.update(0x0001), 0x0001);  // Third scan
+    CHECK(!debouncer.pending());
+
+    for (int i = 0; i < 4; i++) CHECK_EQ(debouncer.update(0), 0x0001);
+    CHECK_EQ(debouncer.update(0), 0);            // Fifth scan
+}
+
+TEST(thresholds_clamped) {
+    TTP229Debouncer debouncer;
+    debouncer.setThresholds(0, 9);
+    CHECK_EQ(debouncer.pressScans, 1);
+    CHECK_EQ(debouncer.releaseScans, TTP229Debouncer::MAX_SCANS);
+}
+
+TEST(flicker_does_not_delay_other_keys) {
+    TTP229Debouncer debouncer;
+    debouncer.reset();
+    debouncer.setThresholds(3, 3);
+
+    // Key 2 flickers every scan; key 1 goes down cleanly
+    CHECK_EQ(debouncer.update(0x0003), 0);
+    CHECK_EQ(debouncer.update(0x0001), 0);
+    CHECK_EQ(debouncer.update(0x0003), 0x0001);
+}
+
+TEST(accept_takes_frame) {
+    TTP229Debouncer debouncer;
+    debouncer.reset();
+    debouncer.setThresholds(3, 3);
+    debouncer.update(0x00F0);
+    debouncer.accept(0x0F00);
+    CHECK_EQ(debouncer.stable, 0x0F00);
+    CHECK(!debouncer.pending());
+}
+
+TEST(bouncy_press_one_event) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    // 1ms contact bounce at both edges, well inside 2 scans of 10ms
+    const TTP229SimStep touch[] = {
+        {0, 0x0004}, {3, 0}, {6, 0x0004}, {9, 0}, {12, 0x0004},
+        {300, 0}, {303, 0x0004}, {306, 0}
+    };
+    sim.playScript(touch, 8);
+    ttp229TestRun(keypad, 500);
+
+    TTP229::KeyEvent event;
+    int presses = 0, releases = 0;
+    while (keypad.getKeyEvents(event)) {
+        CHECK_EQ(event.key, 3);
+        if (event.eventType == TTP229::EVENT_PRESS) presses++;
+        if (event.eventType == TTP229::EVENT_RELEASE) releases++;
+    }
+    CHECK_EQ(presses, 1);
+    CHECK_EQ(releases, 1);
+    CHECK_EQ(keypad.getKeyMask(), 0);
+}
+
+TEST(glitch_rejected) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    // Shorter than one scan interval: seen by at most one scan
+    const TTP229SimStep glitch[] = { {25, 0x0100}, {28, 0} };
+    sim.playScript(glitch, 2);
+    ttp229TestRun(keypad, 200);
+
+    TTP229::KeyEvent event;
+    CHECK(!keypad.getKeyEvents(event));
+    CHECK_EQ(keypad.getKeyMask(), 0);
+}
@@ -0,0 +1,281 @@
+// TTP229EventMachine transitions and hold / long-press / repeat timing,
+// on its own and through TTP229 under virtual time
+
+#include "ttp229_test.h"
+
+struct RecordedEvent {
+    uint8_t key;
+    uint8_t type;
+    uint16_t data;
+    uint32_t time;
+};
+
+struct RecordingSink {
+    RecordedEvent events[64];
+    uint8_t count;
+    uint32_t now;
+
+    RecordingSink() : count(0), now(0) {}
+
+    void emitEvent(uint8_t key, uint8_t type, uint16_t data) {
+        if (count >= 64) return;
+        RecordedEvent& event = events[count++];
+        event.key = key;
+        event.type = type;
+        event.data = data;
+        event.time = now;
+    }
+};
+
+static void setUp(TTP229EventMachine& machine) {
+    machine.reset();
+    machine.holdMs = 1000;
+    machine.longPressMs = 2000;
+    machine.repeatDelayMs = 0;
+    machine.repeatMs = 0;
+    machine.repeatFastestMs = 0;
+    machine.repeatKeys = 0xFFFF;
+    machine.nextDeadline = 0;
+}
+
+static void step(TTP229EventMachine& machine, RecordingSink& sink, uint16_t mask, uint32_t now) {
+    sink.now = now;
+    machine.update(mask, now, sink);
+}
+
+TEST(press_release) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    RecordingSink sink;
+
+    step(machine, sink, 0x0001, 100);
+    step(machine, sink, 0x0001, 110);   // No change, nothing due
+    step(machine, sink, 0x0000, 200);
+    CHECK_EQ(sink.count, 2);
+    CHECK_EQ(sink.events[0].type, TTP229_EVENT_PRESS);
+    CHECK_EQ(sink.events[0].key, 1);
+    CHECK_EQ(sink.events[1].type, TTP229_EVENT_RELEASE);
+    CHECK_EQ(sink.events[1].key, 1);
+    CHECK(!machine.timing());
+}
+
+TEST(releases_before_presses) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    RecordingSink sink;
+
+    step(machine, sink, 0x0003, 0);       // Keys 1 and 2 down
+    step(machine, sink, 0x000C, 50);      // ...up, keys 3 and 4 down
+    CHECK_EQ(sink.count, 6);
+    CHECK_EQ(sink.events[0].key, 2);      // Highest key first
+    CHECK_EQ(sink.events[1].key, 1);
+    CHECK_EQ(sink.events[2].type, TTP229_EVENT_RELEASE);
+    CHECK_EQ(sink.events[2].key, 2);
+    CHECK_EQ(sink.events[3].type, TTP229_EVENT_RELEASE);
+    CHECK_EQ(sink.events[3].key, 1);
+    CHECK_EQ(sink.events[4].type, TTP229_EVENT_PRESS);
+    CHECK_EQ(sink.events[4].key, 4);
+    CHECK_EQ(sink.events[5].type, TTP229_EVENT_PRESS);
+    CHECK_EQ(sink.events[5].key, 3);
+}
+
+TEST(hold_and_long_press_on_time) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    RecordingSink sink;
+
+    step(machine, sink, 0x0020, 500);
+    CHECK(machine.timing());
+    CHECK_EQ(machine.nextDeadline, 1500);
+    CHECK(!machine.due(1499));
+    step(machine, sink, 0x0020, 1499);
+    CHECK_EQ(sink.count, 1);
+
+    CHECK(machine.due(1500));
+    step(machine, sink, 0x0020, 1500);
+    CHECK_EQ(sink.count, 2);
+    CHECK_EQ(sink.events[1].type, TTP229_EVENT_HOLD);
+    CHECK_EQ(sink.events[1].key, 6);
+    CHECK_EQ(machine.nextDeadline, 2500);
+
+    step(machine, sink, 0x0020, 2500);
+    CHECK_EQ(sink.count, 3);
+    CHECK_EQ(sink.events[2].type, TTP229_EVENT_LONG_PRESS);
+    CHECK(!machine.timing());
+
+    step(machine, sink, 0x0020, 9000);    // Nothing more while held
+    CHECK_EQ(sink.count, 3);
+}
+
+TEST(release_cancels_timers) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    RecordingSink sink;
+
+    step(machine, sink, 0x0001, 0);
+    step(machine, sink, 0x0000, 999);
+    step(machine, sink, 0x0000, 5000);
+    CHECK_EQ(sink.count, 2);
+    CHECK(!machine.timing());
+}
+
+TEST(keys_timed_independently) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    RecordingSink sink;
+
+    step(machine, sink, 0x0001, 0);
+    step(machine, sink, 0x0003, 400);     // Key 2 joins later
+    step(machine, sink, 0x0003, 1000);
+    step(machine, sink, 0x0003, 1400);
+    CHECK_EQ(sink.count, 4);
+    CHECK_EQ(sink.events[2].key, 1);
+    CHECK_EQ(sink.events[2].type, TTP229_EVENT_HOLD);
+    CHECK_EQ(sink.events[2].time, 1000);
+    CHECK_EQ(sink.events[3].key, 2);
+    CHECK_EQ(sink.events[3].type, TTP229_EVENT_HOLD);
+    CHECK_EQ(sink.events[3].time, 1400);
+}
+
+TEST(repeat_accelerates) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    machine.holdMs = 60000;
+    machine.longPressMs = 60001;
+    machine.repeatDelayMs = 500;
+    machine.repeatMs = 100;
+    machine.repeatFastestMs = 50;
+    RecordingSink sink;
+
+    step(machine, sink, 0x0001, 0);
+    // Each interval 1/8 shorter, down to 50ms
+    const uint32_t expected[] = { 500, 600, 688, 765, 833, 893, 946, 996, 1046 };
+    for (uint8_t i = 0; i < 9; i++) {
+        CHECK_EQ(machine.nextDeadline, expected[i]);
+        step(machine, sink, 0x0001, machine.nextDeadline);
+        CHECK_EQ(sink.events[sink.count - 1].type, TTP229_EVENT_REPEAT);
+        CHECK_EQ(sink.events[sink.count - 1].data, i + 1);
+        CHECK_EQ(sink.events[sink.count - 1].time, expected[i]);
+    }
+}
+
+TEST(late_scan_no_repeat_burst) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    machine.holdMs = 60000;
+    machine.longPressMs = 60001;
+    machine.repeatDelayMs = 500;
+    machine.repeatMs = 100;
+    machine.repeatFastestMs = 100;
+    RecordingSink sink;
+
+    step(machine, sink, 0x0001, 0);
+    step(machine, sink, 0x0001, 2000);    // 1.5s late
+    CHECK_EQ(sink.count, 2);
+    CHECK_EQ(machine.nextDeadline, 2100);
+}
+
+TEST(repeat_key_mask) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    machine.repeatDelayMs = 200;
+    machine.repeatMs = 100;
+    machine.repeatFastestMs = 100;
+    machine.repeatKeys = 0x0002;          // Key 2 only
+    RecordingSink sink;
+
+    step(machine, sink, 0x0003, 0);
+    for (uint32_t t = 0; t <= 500; t += 10) step(machine, sink, 0x0003, t);
+    int repeats1 = 0, repeats2 = 0;
+    for (uint8_t i = 0; i < sink.count; i++) {
+        if (sink.events[i].type != TTP229_EVENT_REPEAT) continue;
+        if (sink.events[i].key == 1) repeats1++;
+        if (sink.events[i].key == 2) repeats2++;
+    }
+    CHECK_EQ(repeats1, 0);
+    CHECK_EQ(repeats2, 4);                // 200, 300, 400, 500
+}
+
+TEST(timer_table_full) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    RecordingSink sink;
+
+    // One key more than there are timer slots
+    uint16_t mask = (uint16_t)((1ul << (TTP229_TIMED_KEYS + 1)) - 1);
+    if (TTP229_TIMED_KEYS >= 16) mask = 0xFFFF;
+    step(machine, sink, mask, 0);
+    step(machine, sink, mask, 1000);
+    uint8_t holds = 0;
+    for (uint8_t i = 0; i < sink.count; i++) {
+        if (sink.events[i].type == TTP229_EVENT_HOLD) holds++;
+    }
+    CHECK_EQ(holds, TTP229_TIMED_KEYS);
+}
+
+TEST(timestamps_wrap) {
+    TTP229EventMachine machine;
+    setUp(machine);
+    RecordingSink sink;
+
+    step(machine, sink, 0x0001, 0xFFFFFF00u);
+    step(machine, sink, 0x0001, 0x00000100u);   // 512ms later, millis() wrapped
+    CHECK_EQ(sink.count, 1);
+    step(machine, sink, 0x0001, 0xFFFFFF00u + 1000);
+    CHECK_EQ(sink.count, 2);
+    CHECK_EQ(sink.events[1].type, TTP229_EVENT_HOLD);
+}
+
+TEST(keypad_hold_timing) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setHoldThreshold(800, 1500);
+
+    const TTP229SimStep touch[] = { {100, 0x0001}, {2100, 0} };
+    sim.playScript(touch, 2);
+    ttp229TestRun(keypad, 2300);
+
+    TTP229::KeyEvent events[8];
+    size_t count = keypad.getKeyEvents(events, 8);
+    CHECK_EQ(count, 4);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(events[1].eventType, TTP229::EVENT_HOLD);
+    CHECK_EQ(events[2].eventType, TTP229::EVENT_LONG_PRESS);
+    CHECK_EQ(events[3].eventType, TTP229::EVENT_RELEASE);
+    // Timers run between scans, so hold and long press are on the
+    // millisecond (read() is called every ms here)
+    CHECK_EQ(events[1].timestamp - events[0].timestamp, 800);
+    CHECK_EQ(events[2].timestamp - events[0].timestamp, 1500);
+    // Press accepted on the second scan after the touch
+    CHECK(events[0].timestamp >= 110 && events[0].timestamp <= 120);
+}
+
+TEST(keypad_auto_repeat) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setHoldThreshold(5000, 6000);
+    CHECK(keypad.setAutoRepeat(300, 100, 100));
+
+    const TTP229SimStep touch[] = { {0, 0x0100}, {1000, 0} };
+    sim.playScript(touch, 2);
+    ttp229TestRun(keypad, 1200);
+
+    TTP229::KeyEvent event;
+    int repeats = 0;
+    uint32_t pressedAt = 0;
+    while (keypad.getKeyEvents(event)) {
+        if (event.eventType == TTP229::EVENT_PRESS) pressedAt = event.timestamp;
+        if (event.eventType == TTP229::EVENT_REPEAT) {
+            repeats++;
+            CHECK_EQ(event.data, repeats);
+            // A frame can carry read() just past the millisecond a repeat
+            // is due; the schedule itself does not drift
+            uint32_t late = event.timestamp - pressedAt - (300 + 100 * (repeats - 1));
+            CHECK(late <= 1);
+        }
+    }
+    // Held from ~20ms to ~1020ms: repeats at +300 ... +900
+    CHECK_EQ(repeats, 7);
+}
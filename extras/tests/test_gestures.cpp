@@ -0,0 +1,154 @@
+// Taps, swipes and chords from scripted touches, through the debouncer
+// and event machine like on a board
+
+#include "ttp229_test.h"
+
+// Gesture events queued while the script plays (press/release skipped)
+static size_t runGestures(TTP229& keypad, const TTP229SimStep* steps, size_t count,
+                          TTP229::KeyEvent* out, size_t max) {
+    ttp229HostSim().playScript(steps, count);
+    ttp229TestRun(keypad, steps[count - 1].atMs + 500);
+
+    size_t found = 0;
+    TTP229::KeyEvent event;
+    while (keypad.getKeyEvents(event)) {
+        if (event.eventType >= TTP229::EVENT_DOUBLE_TAP && found < max) out[found++] = event;
+    }
+    return found;
+}
+
+static void beginGestures(TTP229& keypad, uint16_t gestures = TTP229::EVENT_MASK_GESTURES) {
+    ttp229TestBegin(keypad);
+    CHECK(keypad.enableGestures(gestures));
+}
+
+TEST(double_tap) {
+    TTP229 keypad(2, 3, true);
+    beginGestures(keypad);
+
+    const TTP229SimStep taps[] = { {0, 0x0020}, {60, 0}, {150, 0x0020}, {210, 0} };
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(runGestures(keypad, taps, 4, events, 4), 1);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_DOUBLE_TAP);
+    CHECK_EQ(events[0].key, 6);
+    CHECK_EQ(events[0].data, 2);
+}
+
+TEST(multi_tap_counts) {
+    TTP229 keypad(2, 3, true);
+    beginGestures(keypad);
+
+    const TTP229SimStep taps[] = {
+        {0, 0x0100}, {50, 0}, {150, 0x0100}, {200, 0},
+        {300, 0x0100}, {350, 0}, {450, 0x0100}, {500, 0}
+    };
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(runGestures(keypad, taps, 8, events, 4), 3);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_DOUBLE_TAP);
+    CHECK_EQ(events[1].eventType, TTP229::EVENT_MULTI_TAP);
+    CHECK_EQ(events[1].data, 3);
+    CHECK_EQ(events[2].eventType, TTP229::EVENT_MULTI_TAP);
+    CHECK_EQ(events[2].data, 4);
+    CHECK_EQ(events[2].key, 9);
+}
+
+TEST(not_taps) {
+    TTP229 keypad(2, 3, true);
+    beginGestures(keypad);
+
+    // Gap longer than multiTapMs, then a press held longer than tapMs,
+    // then a tap on another key
+    const TTP229SimStep steps[] = {
+        {0, 0x0001}, {50, 0}, {500, 0x0001}, {550, 0},
+        {1000, 0x0001}, {1400, 0}, {1500, 0x0001}, {1550, 0},
+        {1650, 0x0002}, {1700, 0}
+    };
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(runGestures(keypad, steps, 10, events, 4), 0);
+}
+
+TEST(swipe_directions) {
+    // Lifting between keys, 60ms per key
+    struct Case { uint8_t keys[3]; uint8_t type; };
+    const Case cases[] = {
+        { {1, 2, 3}, TTP229::EVENT_SWIPE_RIGHT },
+        { {8, 7, 6}, TTP229::EVENT_SWIPE_LEFT },
+        { {2, 6, 10}, TTP229::EVENT_SWIPE_DOWN },
+        { {16, 12, 8}, TTP229::EVENT_SWIPE_UP }
+    };
+    for (uint8_t c = 0; c < 4; c++) {
+        ttp229HostSim().reset();
+        TTP229 keypad(2, 3, true);
+        beginGestures(keypad, TTP229::EVENT_MASK_SWIPE);
+
+        TTP229SimStep steps[6];
+        for (uint8_t i = 0; i < 3; i++) {
+            steps[2 * i].atMs = 60u * i;
+            steps[2 * i].mask = TTP229::keyToMask(cases[c].keys[i]);
+            steps[2 * i + 1].atMs = 60u * i + 40;
+            steps[2 * i + 1].mask = 0;
+        }
+        TTP229::KeyEvent events[4];
+        CHECK_EQ(runGestures(keypad, steps, 6, events, 4), 1);
+        CHECK_EQ(events[0].eventType, cases[c].type);
+        CHECK_EQ(events[0].key, cases[c].keys[2]);
+        CHECK(events[0].data >= 15 && events[0].data <= 18);    // 2 steps in ~120ms
+    }
+}
+
+TEST(overlap_swipe) {
+    TTP229 keypad(2, 3, true);
+    beginGestures(keypad);
+
+    // A finger sliding along row 1, each key touched before the last lifts
+    const TTP229SimStep slide[] = {
+        {0, 0x0010}, {50, 0x0030}, {80, 0x0020}, {130, 0x0060},
+        {160, 0x0040}, {210, 0x00C0}, {240, 0x0080}, {290, 0}
+    };
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(runGestures(keypad, slide, 8, events, 4), 1);     // No chord
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_SWIPE_RIGHT);
+    CHECK_EQ(events[0].key, 8);
+
+    // Two keys are not a swipe until setSwipeLength(2)
+    const TTP229SimStep two[] = { {0, 0x0001}, {50, 0x0003}, {80, 0x0002}, {130, 0} };
+    CHECK_EQ(runGestures(keypad, two, 4, events, 4), 0);
+    CHECK(keypad.setSwipeLength(2));
+    CHECK_EQ(runGestures(keypad, two, 4, events, 4), 1);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_SWIPE_RIGHT);
+}
+
+TEST(chord_mask_in_data) {
+    TTP229 keypad(2, 3, true);
+    beginGestures(keypad);
+
+    const TTP229SimStep chord[] = { {0, 0x0001}, {30, 0x8001}, {50, 0x8041}, {400, 0} };
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(runGestures(keypad, chord, 4, events, 4), 1);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_CHORD);
+    CHECK_EQ(events[0].data, 0x8041);
+    CHECK_EQ(events[0].key, 16);
+
+    // A key lifted inside the hold time: no chord
+    const TTP229SimStep early[] = { {0, 0x0001}, {30, 0x0003}, {60, 0x0001}, {300, 0} };
+    CHECK_EQ(runGestures(keypad, early, 4, events, 4), 0);
+
+    // The third key joins too late to count
+    const TTP229SimStep late[] = { {0, 0x0001}, {30, 0x0009}, {200, 0x0809}, {500, 0} };
+    CHECK_EQ(runGestures(keypad, late, 4, events, 4), 1);
+    CHECK_EQ(events[0].data, 0x0009);
+    CHECK_EQ(events[0].key, 4);
+}
+
+TEST(only_enabled_gestures) {
+    TTP229 keypad(2, 3, true);
+    beginGestures(keypad, TTP229::EVENT_MASK_CHORD);
+
+    const TTP229SimStep taps[] = { {0, 0x0020}, {60, 0}, {150, 0x0020}, {210, 0} };
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(runGestures(keypad, taps, 4, events, 4), 0);
+
+    CHECK(keypad.enableGestures(0));
+    const TTP229SimStep chord[] = { {0, 0x0003}, {300, 0} };
+    CHECK_EQ(runGestures(keypad, chord, 2, events, 4), 0);
+}
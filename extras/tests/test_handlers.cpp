@@ -0,0 +1,156 @@
+// Key handler table and dispatch: deferred to dispatchEvents(), or
+// straight from the scan with DISPATCH_IMMEDIATE
+
+#include "ttp229_test.h"
+
+// Every handler call, in order
+struct HandlerCall {
+    char handler;
+    uint8_t key;
+    uint8_t type;
+};
+
+static HandlerCall calls[32];
+static uint8_t callCount;
+
+static void record(char handler, const TTP229::KeyEvent& event) {
+    if (callCount < 32) {
+        calls[callCount].handler = handler;
+        calls[callCount].key = event.key;
+        calls[callCount].type = event.eventType;
+        callCount++;
+    }
+}
+
+static void keyHandler(const TTP229::KeyEvent& event) { record('k', event); }
+static void anyHandler(const TTP229::KeyEvent& event) { record('a', event); }
+static void repeatHandler(const TTP229::KeyEvent& event) { record('r', event); }
+
+static void beginHandlers(TTP229& keypad) {
+    ttp229TestBegin(keypad);
+    callCount = 0;
+}
+
+TEST(deferred_handlers_run_in_dispatch) {
+    TTP229 keypad(2, 3, true);
+    beginHandlers(keypad);
+    CHECK(keypad.onPress(5, keyHandler));
+    CHECK(keypad.onPress(TTP229::KEY_ANY, anyHandler));
+    CHECK(keypad.onRelease(TTP229::KEY_ANY, anyHandler));
+    CHECK(keypad.onRepeat(5, repeatHandler));
+    CHECK(keypad.setAutoRepeat(300, 100, 100));
+
+    const TTP229SimStep touch[] = { {0, 0x0010}, {650, 0}, {700, 0x0020}, {750, 0} };
+    ttp229HostSim().playScript(touch, 4);
+    ttp229TestRun(keypad, 800);
+
+    // Nothing runs until dispatchEvents()
+    CHECK_EQ(callCount, 0);
+    uint32_t queued = keypad.getQueueCount();
+    CHECK_EQ(keypad.dispatchEvents(), queued);
+    CHECK_EQ(keypad.getQueueCount(), 0);
+
+    // Key 5: own handler then KEY_ANY, 4 repeats (300..600ms), release;
+    // key 6: KEY_ANY only
+    CHECK_EQ(callCount, 9);
+    CHECK_EQ(calls[0].handler, 'k');
+    CHECK_EQ(calls[0].type, TTP229::EVENT_PRESS);
+    CHECK_EQ(calls[1].handler, 'a');
+    CHECK_EQ(calls[1].key, 5);
+    for (uint8_t i = 2; i < 6; i++) {
+        CHECK_EQ(calls[i].handler, 'r');
+        CHECK_EQ(calls[i].type, TTP229::EVENT_REPEAT);
+    }
+    CHECK_EQ(calls[6].type, TTP229::EVENT_RELEASE);
+    CHECK_EQ(calls[7].handler, 'a');
+    CHECK_EQ(calls[7].key, 6);
+    CHECK_EQ(calls[8].type, TTP229::EVENT_RELEASE);
+
+    CHECK_EQ(keypad.dispatchEvents(), 0);
+}
+
+TEST(dispatch_scans_and_waits) {
+    TTP229 keypad(2, 3, true);
+    beginHandlers(keypad);
+    keypad.onPress(TTP229::KEY_ANY, anyHandler);
+
+    // Nothing pending: returns at once
+    uint32_t start = millis();
+    CHECK_EQ(keypad.dispatchEvents(), 0);
+    CHECK_EQ(millis(), start);
+
+    // No read() from the sketch: dispatchEvents() scans while it waits
+    const TTP229SimStep tap[] = { {50, 0x0400}, {100, 0} };
+    ttp229HostSim().playScript(tap, 2);
+    start = millis();
+    CHECK_EQ(keypad.dispatchEvents(500), 1);
+    CHECK(millis() - start <= 50 + 2 * 10 + 1);
+    CHECK_EQ(callCount, 1);
+    CHECK_EQ(calls[0].key, 11);
+
+    // Times out when nothing comes
+    start = millis();
+    CHECK_EQ(keypad.dispatchEvents(100), 1);       // The release, no handler
+    CHECK_EQ(keypad.dispatchEvents(100), 0);
+    CHECK(millis() - start >= 100);
+    CHECK_EQ(callCount, 1);
+}
+
+TEST(immediate_handlers_in_scan) {
+    TTP229 keypad(2, 3, true);
+    beginHandlers(keypad);
+    keypad.setDispatchMode(TTP229::DISPATCH_IMMEDIATE);
+    keypad.onPress(3, keyHandler);
+
+    const TTP229SimStep taps[] = { {0, 0x0004}, {50, 0}, {100, 0x0008}, {150, 0} };
+    ttp229HostSim().playScript(taps, 4);
+    ttp229TestRun(keypad, 200);
+
+    // Ran from read(); the handled press is not queued, the rest are
+    CHECK_EQ(callCount, 1);
+    CHECK_EQ(calls[0].key, 3);
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 3);
+    CHECK_EQ(events[0].key, 3);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_RELEASE);
+    CHECK_EQ(events[1].key, 4);
+}
+
+TEST(gesture_handler) {
+    TTP229 keypad(2, 3, true);
+    beginHandlers(keypad);
+    keypad.enableGestures(TTP229::EVENT_MASK_DOUBLE_TAP);
+    CHECK(keypad.onGesture(TTP229::EVENT_DOUBLE_TAP, anyHandler));
+
+    const TTP229SimStep taps[] = { {0, 0x0020}, {60, 0}, {150, 0x0020}, {210, 0} };
+    ttp229HostSim().playScript(taps, 4);
+    ttp229TestRun(keypad, 700);
+    CHECK_EQ(keypad.dispatchEvents(), 5);
+    CHECK_EQ(callCount, 1);
+    CHECK_EQ(calls[0].type, TTP229::EVENT_DOUBLE_TAP);
+    CHECK_EQ(calls[0].key, 6);
+}
+
+TEST(handler_table_limits) {
+    TTP229 keypad(2, 3, true);
+    beginHandlers(keypad);
+    CHECK(!keypad.onPress(17, keyHandler));
+    CHECK(!keypad.onEvent(1, TTP229::EVENT_DOUBLE_TAP, keyHandler));
+    CHECK(!keypad.onGesture(TTP229::EVENT_PRESS, keyHandler));
+
+    // NULL removes one, clearHandlers() all
+    keypad.setDispatchMode(TTP229::DISPATCH_IMMEDIATE);
+    keypad.onPress(1, keyHandler);
+    keypad.onPress(2, keyHandler);
+    keypad.onPress(1, NULL);
+    const TTP229SimStep taps[] = { {0, 0x0001}, {50, 0}, {100, 0x0002}, {150, 0} };
+    ttp229HostSim().playScript(taps, 4);
+    ttp229TestRun(keypad, 200);
+    CHECK_EQ(callCount, 1);
+    CHECK_EQ(calls[0].key, 2);
+
+    keypad.clearHandlers();
+    ttp229HostSim().playScript(taps, 4);
+    ttp229TestRun(keypad, 200);
+    CHECK_EQ(callCount, 1);
+}
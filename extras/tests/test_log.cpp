@@ -0,0 +1,142 @@
+// Deferred debug output: the scan path queues binary records, printLog()
+// formats them. Built with TTP229_LOG_LEVEL 4 and TTP229_LOG_DEPTH 8.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ttp229_test.h"
+
+static char output[4096];
+
+// ttp229TestBegin() with debug output on, printed into output[]
+static void beginDebug(TTP229& keypad) {
+    ttp229HostSim().attachChip(2, 3, 16);
+    ttp229HostSim().serial.capture(output, sizeof(output));
+    keypad.begin(true);
+    keypad.setScanInterval(10);
+    keypad.setDebounce((uint8_t)2, (uint8_t)2);
+    ttp229HostSim().serial.capture(output, sizeof(output));   // Drop the begin() banner
+}
+
+static int countLines(const char* text, const char* what) {
+    int n = 0;
+    for (const char* at = strstr(text, what); at != NULL; at = strstr(at + 1, what)) n++;
+    return n;
+}
+
+TEST(polling_read_prints_scan_path) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    beginDebug(keypad);
+
+    sim.setTouched(0x0004);
+    ttp229TestRun(keypad, 40);
+    sim.setTouched(0);
+    ttp229TestRun(keypad, 40);
+
+    // Printed by read() before its next scan, in scan order
+    const char* press = strstr(output, "Adding PRESS event to queue, key 3");
+    const char* change = strstr(output, "Key change ACCEPTED: mask=0x4");
+    const char* release = strstr(output, "Adding RELEASE event to queue, key 3");
+    CHECK(press != NULL);
+    CHECK(change != NULL && change > press);
+    CHECK(release != NULL && release > change);
+    CHECK_EQ(countLines(output, " us: "), 4);
+    CHECK_EQ(keypad.printLog(), 0);           // Nothing left over
+}
+
+TEST(records_stamped_at_scan_time) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    beginDebug(keypad);
+
+    sim.setTouched(0x0001);
+    uint32_t accepted = 0;
+    while (keypad.getKeyMask() == 0) {
+        keypad.read();
+        accepted = micros();
+        delay(1);
+    }
+    CHECK(strstr(output, "mask=0x1") == NULL);  // Still queued
+
+    // The stamp is the scan's micros(), not when it was printed
+    delay(50);
+    CHECK_EQ(keypad.printLog(), 2);           // Event and key change
+    unsigned long stamp = strtoul(output, NULL, 10);
+    CHECK(stamp <= accepted && accepted - stamp < 1000);
+}
+
+TEST(service_leaves_ring_to_printLog) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    beginDebug(keypad);
+
+    // The timer scans; read() only reports and must not drain the ring
+    static TTP229* serviced = &keypad;
+    struct Tick { static void isr() { serviced->service(); } };
+    sim.setTimer(10000, Tick::isr);
+    sim.setTouched(0x0010);
+    ttp229TestRun(keypad, 40);
+    CHECK_EQ(keypad.read(), 5);
+    CHECK_EQ(output[0], '\0');
+
+    CHECK_EQ(keypad.printLog(), 2);           // Event and key change
+    CHECK(strstr(output, "Adding PRESS event to queue, key 5") != NULL);
+    CHECK_EQ(keypad.printLog(), 0);
+    sim.setTimer(0, NULL);
+}
+
+TEST(full_ring_counts_drops) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    beginDebug(keypad);
+
+    static TTP229* serviced = &keypad;
+    struct Tick { static void isr() { serviced->service(); } };
+    sim.setTimer(10000, Tick::isr);
+
+    // Six taps, two records per edge: 24 records into a ring of 8
+    for (int i = 0; i < 6; i++) {
+        sim.setTouched(TTP229::keyToMask((uint8_t)(i + 1)));
+        delay(40);
+        sim.setTouched(0);
+        delay(40);
+    }
+    sim.setTimer(0, NULL);
+
+    CHECK_EQ(keypad.printLog(), TTP229_LOG_DEPTH);
+    CHECK(strstr(output, "16 log messages dropped") != NULL);
+
+    // Reported once
+    sim.serial.capture(output, sizeof(output));
+    CHECK_EQ(keypad.printLog(), 0);
+    CHECK_EQ(output[0], '\0');
+}
+
+TEST(queue_full_logged_as_error) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    beginDebug(keypad);
+    CHECK(keypad.setQueueSize(2));
+
+    sim.setTouched(0x0001);
+    ttp229TestRun(keypad, 40);
+    sim.setTouched(0);
+    ttp229TestRun(keypad, 40);
+    sim.setTouched(0x0002);
+    ttp229TestRun(keypad, 40);
+    CHECK(strstr(output, "ERROR: Queue is full! Dropped PRESS of key 2") != NULL);
+    CHECK_EQ(keypad.getQueueOverflows(), 1);
+}
+
+TEST(no_records_without_debug) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    sim.serial.capture(output, sizeof(output));
+
+    sim.setTouched(0x0001);
+    ttp229TestRun(keypad, 40);
+    CHECK_EQ(keypad.printLog(), 0);
+    CHECK_EQ(output[0], '\0');
+}
@@ -0,0 +1,186 @@
+// TTP229PackedEvent, uplink batches and the packed event queue, including
+// what they leave out: data, micros fields, time past 23 bits. Built with
+// TTP229_PACKED_QUEUE.
+
+#include "ttp229_test.h"
+
+TEST(pack_round_trip) {
+    TTP229TestRandom random(20);
+    for (uint8_t key = 0; key <= 16; key++) {
+        for (uint8_t type = 0; type < TTP229_EVENT_TYPES; type++) {
+            uint32_t time = random.next();
+            TTP229PackedEvent event = TTP229PackedEvent::pack(key, type, time);
+            CHECK_EQ(event.key(), key);
+            CHECK_EQ(event.type(), type);
+            CHECK_EQ(event.time(), time & TTP229_PACKED_TIME_MASK);  // Low 23 bits kept
+        }
+    }
+}
+
+TEST(time_before_within_range) {
+    // Any millis() within ~2.3 hours after the event gives its full time,
+    // across the 32-bit wrap too
+    const uint32_t times[] = { 0, 12345, 0x007FFFFF, 0x00800000, 0xFFFFFF00u };
+    const uint32_t ages[] = { 0, 1, 1000, TTP229_PACKED_TIME_MASK };
+    for (uint8_t t = 0; t < 5; t++) {
+        TTP229PackedEvent event = TTP229PackedEvent::pack(1, TTP229_EVENT_PRESS, times[t]);
+        for (uint8_t a = 0; a < 4; a++) {
+            CHECK_EQ(event.timeBefore(times[t] + ages[a]), times[t]);
+        }
+    }
+
+    // Read later than that, it aliases to a newer time
+    TTP229PackedEvent late = TTP229PackedEvent::pack(1, TTP229_EVENT_PRESS, 5000);
+    CHECK_EQ(late.timeBefore(5000 + TTP229_PACKED_TIME_MASK + 1), 5000 + TTP229_PACKED_TIME_MASK + 1);
+}
+
+TEST(batch_round_trip) {
+    uint8_t buffer[TTP229_BATCH_HEADER_BYTES + 16 * 4];
+    TTP229BatchWriter writer(buffer, sizeof(buffer));
+    CHECK_EQ(writer.length(), 0);
+
+    TTP229TestRandom random(7);
+    uint8_t keys[16], types[16];
+    uint32_t times[16];
+    uint32_t time = 0xFFFF0000u;            // Wraps inside the batch
+    for (uint8_t i = 0; i < 16; i++) {
+        keys[i] = (uint8_t)(1 + random.below(16));
+        types[i] = (uint8_t)random.below(TTP229_EVENT_TYPES);
+        time += random.below(30000);
+        times[i] = time;
+        CHECK(writer.add(keys[i], types[i], time));
+    }
+    CHECK(writer.full());
+    CHECK(!writer.add(1, TTP229_EVENT_PRESS, time));
+    CHECK_EQ(writer.count(), 16);
+    CHECK_EQ(writer.length(), sizeof(buffer));
+
+    TTP229BatchReader reader(buffer, writer.length());
+    CHECK(reader.valid());
+    CHECK_EQ(reader.count(), 16);
+    TTP229::KeyEvent event;
+    for (uint8_t i = 0; i < 16; i++) {
+        memset(&event, 0xA5, sizeof(event));
+        CHECK(reader.next(event));
+        CHECK_EQ(event.key, keys[i]);
+        CHECK_EQ(event.eventType, types[i]);
+        CHECK_EQ(event.timestamp, times[i]);
+        CHECK_EQ(event.row, (keys[i] - 1) / 4);
+        CHECK_EQ(event.col, (keys[i] - 1) % 4);
+        CHECK_EQ(event.data, 0);            // Not carried
+    }
+    CHECK(!reader.next(event));
+}
+
+TEST(batch_clamps_long_gaps) {
+    uint8_t buffer[64];
+    TTP229BatchWriter writer(buffer, sizeof(buffer));
+    writer.add(1, TTP229_EVENT_PRESS, 1000);
+    writer.add(1, TTP229_EVENT_RELEASE, 1000 + TTP229_PACKED_TIME_MASK + 5000);  // 2.3 hours later
+    writer.add(2, TTP229_EVENT_PRESS, 1000 + TTP229_PACKED_TIME_MASK + 5300);
+
+    // The long gap is cut to 23 bits; later deltas stay right
+    TTP229BatchReader reader(buffer, writer.length());
+    uint8_t key, type;
+    uint32_t first, second, third;
+    CHECK(reader.next(key, type, first));
+    CHECK(reader.next(key, type, second));
+    CHECK(reader.next(key, type, third));
+    CHECK_EQ(first, 1000);
+    CHECK_EQ(second - first, TTP229_PACKED_TIME_MASK);
+    CHECK_EQ(third - second, 300);
+}
+
+TEST(batch_limits) {
+    // No room for the header and one event
+    uint8_t small[TTP229_BATCH_HEADER_BYTES + 3];
+    TTP229BatchWriter tooSmall(small, sizeof(small));
+    CHECK(tooSmall.full());
+    CHECK(!tooSmall.add(1, TTP229_EVENT_PRESS, 0));
+    CHECK_EQ(tooSmall.length(), 0);
+
+    // At most 255 events, whatever the buffer
+    static uint8_t large[TTP229_BATCH_HEADER_BYTES + 300 * 4];
+    TTP229BatchWriter writer(large, sizeof(large));
+    uint16_t added = 0;
+    while (writer.add(3, TTP229_EVENT_PRESS, added)) added++;
+    CHECK_EQ(added, 255);
+    CHECK_EQ(writer.length(), TTP229_BATCH_HEADER_BYTES + 255 * 4);
+}
+
+TEST(batch_reader_rejects) {
+    uint8_t buffer[TTP229_BATCH_HEADER_BYTES + 8];
+    TTP229BatchWriter writer(buffer, sizeof(buffer));
+    writer.add(1, TTP229_EVENT_PRESS, 10);
+    writer.add(1, TTP229_EVENT_RELEASE, 20);
+
+    CHECK(TTP229BatchReader(buffer, writer.length()).valid());
+    CHECK(!TTP229BatchReader(buffer, writer.length() - 1).valid());   // Cut short
+    CHECK(!TTP229BatchReader(buffer, 3).valid());
+    buffer[0] = TTP229_BATCH_VERSION + 1;
+    CHECK(!TTP229BatchReader(buffer, writer.length()).valid());
+}
+
+TEST(packed_queue_events) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.enableGestures(TTP229::EVENT_MASK_DOUBLE_TAP);
+
+    // 4 bytes per queued event
+    TTP229::MemoryFootprint memory = keypad.getMemoryFootprint();
+    CHECK(memory.eventRing < TTP229_EVENT_QUEUE_CAPACITY * sizeof(TTP229::KeyEvent) / 2);
+
+    // Double tap on key 7
+    const TTP229SimStep taps[] = { {0, 0x0040}, {60, 0}, {150, 0x0040}, {210, 0} };
+    sim.playScript(taps, 4);
+    uint32_t pressedAt = 0;
+    for (uint32_t ms = 0; ms < 300; ms++) {
+        uint16_t before = keypad.getKeyMask();
+        keypad.read();
+        if (before == 0 && keypad.getKeyMask() != 0 && pressedAt == 0) pressedAt = millis();
+        delay(1);
+    }
+
+    TTP229::KeyEvent events[8];
+    CHECK_EQ(keypad.getKeyEvents(events, 8), 5);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(events[0].timestamp, pressedAt);   // Full millis() back from 23 bits
+    CHECK_EQ(events[0].key, 7);
+    CHECK_EQ(events[0].row, 1);
+    CHECK_EQ(events[0].col, 2);
+    CHECK_EQ(events[4].eventType, TTP229::EVENT_DOUBLE_TAP);
+    CHECK_EQ(events[4].key, 7);
+    CHECK_EQ(events[4].data, 0);                // Tap count is not stored
+}
+
+TEST(packed_queue_encodes_batch) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    const TTP229SimStep taps[] = { {0, 0x0001}, {50, 0}, {100, 0x0100}, {150, 0} };
+    sim.playScript(taps, 4);
+    ttp229TestRun(keypad, 200);
+    CHECK_EQ(keypad.getQueueCount(), 4);
+
+    uint8_t buffer[TTP229_BATCH_HEADER_BYTES + 3 * 4];   // One event short
+    size_t length = keypad.encodeEvents(buffer, sizeof(buffer));
+    CHECK_EQ(length, sizeof(buffer));
+    CHECK_EQ(keypad.getQueueCount(), 1);        // The last one waits for the next batch
+
+    TTP229BatchReader batch(buffer, length);
+    TTP229::KeyEvent event;
+    const uint8_t keys[] = { 1, 1, 9 };
+    uint32_t previous = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK(batch.next(event));
+        CHECK_EQ(event.key, keys[i]);
+        CHECK_EQ(event.eventType, i % 2 ? TTP229::EVENT_RELEASE : TTP229::EVENT_PRESS);
+        if (i > 0) CHECK(event.timestamp - previous >= 40 && event.timestamp - previous <= 60);
+        previous = event.timestamp;
+    }
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.key, 9);
+    CHECK_EQ(event.eventType, TTP229::EVENT_RELEASE);
+}
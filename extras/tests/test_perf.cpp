@@ -0,0 +1,107 @@
+// Virtual-time performance gates: frame cost, press latency, sustained
+// event throughput. Limits sit just above today's numbers, so a change
+// that adds clock edges, scans later or drops events fails the build.
+
+#include "ttp229_test.h"
+
+TEST(frame_cost) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    uint32_t frames = sim.frames;
+    uint32_t edges = sim.sclEdges;
+    uint32_t start = sim.nowUs();
+    for (int i = 0; i < 100; i++) {
+        keypad.readRawMask();
+        delay(5);
+    }
+    uint32_t frameUs = (sim.nowUs() - start) / 100 - 5000;
+    PERF("frame_us", frameUs, 500);
+    PERF("edges_per_frame", (sim.sclEdges - edges) / 100.0, 16);
+    PERF("extra_frames", sim.frames - frames - 100, 0);
+}
+
+TEST(press_latency) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    // Touches at random offsets against the 10ms scan clock; debounce of
+    // two scans means a press is reported within two intervals (plus the
+    // frame that carries the second scan past the millisecond)
+    TTP229TestRandom random(9);
+    uint32_t worst = 0, total = 0;
+    for (int i = 0; i < 200; i++) {
+        ttp229TestRun(keypad, 20 + random.below(13));
+        uint8_t key = (uint8_t)(1 + random.below(16));
+        sim.setTouched(TTP229::keyToMask(key));
+        uint32_t touched = millis();
+        TTP229::KeyEvent event;
+        while (!keypad.getKeyEvents(event) && millis() - touched < 100) {
+            keypad.read();
+            delay(1);
+        }
+        CHECK_EQ(event.key, key);
+        uint32_t latency = millis() - touched;
+        if (latency > worst) worst = latency;
+        total += latency;
+
+        sim.setTouched(0);
+        ttp229TestRun(keypad, 40);
+        while (keypad.getKeyEvents(event)) {}
+    }
+    PERF("press_latency_ms_max", worst, 21);
+    PERF("press_latency_ms_mean", total / 200.0, 17);
+}
+
+TEST(sustained_taps) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    // 2000 taps as fast as the debounce allows, drained every ms: every
+    // press and release arrives, nothing overflows
+    TTP229TestRandom random(25);
+    uint32_t presses = 0, releases = 0;
+    uint16_t expectedKey = 0;
+    uint32_t wrongKey = 0;
+    TTP229::KeyEvent event;
+    for (int i = 0; i < 2000; i++) {
+        uint8_t key = (uint8_t)(1 + random.below(16));
+        for (int phase = 0; phase < 2; phase++) {
+            sim.setTouched(phase == 0 ? TTP229::keyToMask(key) : 0);
+            uint32_t start = millis();
+            while (millis() - start < 30) {
+                keypad.read();
+                while (keypad.getKeyEvents(event)) {
+                    if (event.eventType == TTP229::EVENT_PRESS) {
+                        presses++;
+                        expectedKey = event.key;
+                    } else if (event.eventType == TTP229::EVENT_RELEASE) {
+                        releases++;
+                        if (event.key != expectedKey) wrongKey++;
+                    }
+                }
+                delay(1);
+            }
+        }
+    }
+    CHECK_EQ(presses, 2000);
+    CHECK_EQ(releases, 2000);
+    CHECK_EQ(wrongKey, 0);
+    PERF("missed_events", 4000 - presses - releases, 0);
+    PERF("queue_overflows", keypad.getQueueOverflows(), 0);
+}
+
+TEST(idle_scans) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    // read() every ms for a second with nothing touched: one frame per
+    // scan interval, no more
+    uint32_t frames = sim.frames;
+    ttp229TestRun(keypad, 1000);
+    PERF("frames_per_second_idle", sim.frames - frames, 101);
+}
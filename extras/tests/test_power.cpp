@@ -0,0 +1,238 @@
+// Scanning only when needed: interrupt mode on the data-valid pulse, the
+// adaptive scan policy and sleeping until a touch
+
+#include "ttp229_test.h"
+
+TEST(interrupt_mode_idle_has_no_scl_edges) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.enableInterruptMode());
+    CHECK(keypad.isInterruptMode());
+
+    // One scan to pick up the current state, then nothing while idle
+    ttp229TestRun(keypad, 20);
+    CHECK_EQ(sim.frames, 1);
+    uint32_t edges = sim.sclEdges;
+    ttp229TestRun(keypad, 2000);
+    CHECK_EQ(sim.sclEdges, edges);
+
+    // Polling again once it is off
+    CHECK(keypad.enableInterruptMode(false));
+    CHECK(!keypad.isInterruptMode());
+    ttp229TestRun(keypad, 100);
+    CHECK(sim.frames >= 10);
+}
+
+TEST(interrupt_mode_scans_on_data_valid) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setScanInterval(50);
+    keypad.enableInterruptMode();
+    ttp229TestRun(keypad, 20);
+
+    // The touch is scanned at once, not at the next 50ms tick; debounce
+    // and the release poll at the scan interval
+    const TTP229SimStep tap[] = { {7, 0x0008}, {300, 0} };
+    sim.playScript(tap, 2);
+    uint32_t touchedAt = millis() + 7;
+    ttp229TestRun(keypad, 500);
+
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 2);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(events[0].key, 4);
+    CHECK(events[0].timestamp - touchedAt <= 51);   // Second scan of the touch
+    CHECK_EQ(events[1].eventType, TTP229::EVENT_RELEASE);
+
+    // Idle again afterwards
+    uint32_t edges = sim.sclEdges;
+    ttp229TestRun(keypad, 1000);
+    CHECK_EQ(sim.sclEdges, edges);
+}
+
+TEST(interrupt_mode_limits) {
+    TTP229 early(2, 3, true);
+    CHECK(!early.enableInterruptMode());            // Before begin()
+    CHECK(!early.isInterruptMode());
+
+    // Four trampoline slots
+    TTP229 a(2, 3, true), b(4, 5, true), c(6, 7, true), d(8, 9, true), e(10, 11, true);
+    TTP229* keypads[5] = { &a, &b, &c, &d, &e };
+    for (uint8_t i = 0; i < 5; i++) keypads[i]->begin();
+    for (uint8_t i = 0; i < 4; i++) CHECK(keypads[i]->enableInterruptMode());
+    CHECK(keypads[0]->enableInterruptMode());       // Already on
+    CHECK(!keypads[4]->enableInterruptMode());
+
+    // A slot given back is free again
+    CHECK(keypads[1]->enableInterruptMode(false));
+    CHECK(keypads[4]->enableInterruptMode());
+    for (uint8_t i = 0; i < 5; i++) keypads[i]->enableInterruptMode(false);
+}
+
+// Frames scanned in the next ms milliseconds
+static uint32_t framesIn(TTP229& keypad, uint32_t ms) {
+    uint32_t before = ttp229HostSim().frames;
+    ttp229TestRun(keypad, ms);
+    return ttp229HostSim().frames - before;
+}
+
+TEST(scan_policy_idle_burst_idle) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.setScanPolicy(100, 10, 300));
+    CHECK_EQ(keypad.getScanInterval(), 100);
+
+    // Idle: 100ms
+    CHECK(framesIn(keypad, 1000) <= 11);
+
+    // The first touched frame switches to 10ms; a short tap still gets
+    // both debounce scans and a prompt release
+    sim.setTouched(0x0001);
+    uint32_t touchedAt = millis();
+    ttp229TestRun(keypad, 150);
+    CHECK_EQ(keypad.getScanInterval(), 10);
+    TTP229::KeyEvent event;
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.eventType, TTP229::EVENT_PRESS);
+    CHECK(event.timestamp - touchedAt <= 100 + 10 + 1);  // Next idle scan, one more
+    CHECK(framesIn(keypad, 200) >= 19);
+
+    sim.setTouched(0);
+    uint32_t releasedAt = millis();
+    ttp229TestRun(keypad, 50);
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.eventType, TTP229::EVENT_RELEASE);
+    CHECK(event.timestamp - releasedAt <= 2 * 10 + 1);
+
+    // Fast until quiet for 300ms, then idle again
+    ttp229TestRun(keypad, 200);
+    CHECK_EQ(keypad.getScanInterval(), 10);
+    ttp229TestRun(keypad, 150);
+    CHECK_EQ(keypad.getScanInterval(), 100);
+    CHECK(framesIn(keypad, 1000) <= 11);
+}
+
+TEST(scan_policy_on_timer) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setScanPolicy(100, 10, 300);
+
+    // A 10ms timer tick skips scans while idle
+    static TTP229* serviced = &keypad;
+    struct Tick { static void isr() { serviced->service(); } };
+    sim.setTimer(10000, Tick::isr);
+    const TTP229SimStep tap[] = { {1000, 0x0004}, {1200, 0} };
+    sim.playScript(tap, 2);
+
+    delay(900);
+    CHECK(sim.frames <= 10);
+    uint32_t idle = sim.frames;
+    delay(600);                                     // Touch, release, quiet
+    CHECK(sim.frames - idle >= 40);
+    CHECK_EQ(keypad.getScanInterval(), 100);
+    uint32_t after = sim.frames;
+    delay(1000);
+    CHECK(sim.frames - after <= 11);
+    sim.setTimer(0, NULL);
+
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 2);
+    CHECK_EQ(events[0].key, 3);
+    CHECK_EQ(events[1].eventType, TTP229::EVENT_RELEASE);
+}
+
+TEST(scan_policy_limits) {
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(!keypad.setScanPolicy(100, 0, 300));      // active < 1
+    CHECK(!keypad.setScanPolicy(10, 20, 300));      // active > idle
+    CHECK(!keypad.setScanPolicy(2000, 10, 300));    // idle > 1000
+    CHECK_EQ(keypad.getScanInterval(), 10);
+
+    // setScanInterval() goes back to a fixed rate
+    CHECK(keypad.setScanPolicy(100, 10, 300));
+    CHECK(keypad.setScanInterval(20));
+    ttp229HostSim().setTouched(0x0001);
+    ttp229TestRun(keypad, 100);
+    CHECK_EQ(keypad.getScanInterval(), 20);
+}
+
+TEST(sleep_wakes_on_touch) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    // A 5ms tap, shorter than the 2-scan debounce
+    const TTP229SimStep tap[] = { {5000, 0x0004}, {5005, 0} };
+    sim.playScript(tap, 2);
+    uint32_t touchedUs = micros() + 5000000;
+    CHECK(keypad.sleepUntilTouch());
+    CHECK(keypad.wokeByTouch());
+    CHECK(sim.sleepNs >= 4999000000ULL);
+
+    // The waking frame is the first event, one frame after the wake-up
+    uint32_t latency = keypad.getWakeLatency();
+    CHECK(latency >= 300 && latency <= 350);
+    CHECK(micros() - touchedUs <= 350);
+    TTP229::KeyEvent event;
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(event.key, 3);
+    CHECK_EQ(event.timestamp, touchedUs / 1000);
+
+    ttp229TestRun(keypad, 50);
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.eventType, TTP229::EVENT_RELEASE);
+}
+
+TEST(sleep_refused_or_not_woken) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 early(2, 3, true);
+    CHECK(!early.sleepUntilTouch());                // Before begin()
+
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    // Key down: it would wake at once
+    sim.setTouched(0x0001);
+    ttp229TestRun(keypad, 50);
+    CHECK(!keypad.sleepUntilTouch());
+    CHECK_EQ(sim.sleepNs, 0);
+
+    // Nothing left to wake on
+    sim.setTouched(0);
+    ttp229TestRun(keypad, 50);
+    CHECK(!keypad.sleepUntilTouch());
+    CHECK(!keypad.wokeByTouch());
+}
+
+TEST(sleep_keeps_interrupt_mode) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.enableInterruptMode();
+    ttp229TestRun(keypad, 20);
+
+    const TTP229SimStep taps[] = { {1000, 0x0010}, {1100, 0}, {1500, 0x0020}, {1600, 0} };
+    sim.playScript(taps, 4);
+    CHECK(keypad.sleepUntilTouch(TTP229::SLEEP_DEEP));   // Same as light on the host
+    CHECK(keypad.isInterruptMode());
+    ttp229TestRun(keypad, 200);
+
+    // Idle again, until the second touch comes through the SDO interrupt
+    uint32_t edges = sim.sclEdges;
+    ttp229TestRun(keypad, 200);
+    CHECK_EQ(sim.sclEdges, edges);
+    ttp229TestRun(keypad, 500);
+    CHECK(sim.sclEdges > edges);
+
+    TTP229::KeyEvent events[8];
+    CHECK_EQ(keypad.getKeyEvents(events, 8), 4);
+    CHECK_EQ(events[0].key, 5);
+    CHECK_EQ(events[2].key, 6);
+    CHECK_EQ(events[3].eventType, TTP229::EVENT_RELEASE);
+}
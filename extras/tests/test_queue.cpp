@@ -0,0 +1,191 @@
+// TTP229EventRing (push, pop, takeFirst, resize) against a reference
+// deque, and the queue overflow policies of TTP229
+
+#include <deque>
+
+#include "ttp229_test.h"
+
+struct MultipleOf {
+    uint32_t divisor;
+    bool operator()(uint32_t value) const { return value % divisor == 0; }
+};
+
+static uint8_t roundedSize(uint8_t size, uint8_t capacity) {
+    uint8_t rounded = 2;
+    while (rounded < size && rounded < capacity) rounded <<= 1;
+    return rounded;
+}
+
+TEST(ring_matches_deque) {
+    TTP229EventRing<uint32_t, 16> ring;
+    std::deque<uint32_t> reference;
+    uint8_t size = roundedSize(10, 16);
+    ring.reset(10);
+    CHECK_EQ(ring.size(), size);
+
+    TTP229TestRandom random(14);
+    uint32_t nextValue = 1;
+    for (int op = 0; op < 20000; op++) {
+        switch (random.below(9)) {
+            case 0: case 1: case 2: {
+                bool pushed = ring.push(nextValue);
+                bool fits = reference.size() < size;
+                CHECK_EQ(pushed, fits);
+                if (fits) reference.push_back(nextValue);
+                nextValue++;
+                break;
+            }
+            case 3: {
+                bool dropped = ring.pushOverwrite(nextValue);
+                bool full = reference.size() >= size;
+                CHECK_EQ(dropped, full);
+                if (full) reference.pop_front();
+                reference.push_back(nextValue);
+                nextValue++;
+                break;
+            }
+            case 4: case 5: case 6: {
+                uint32_t value = 0;
+                bool popped = ring.pop(value);
+                CHECK_EQ(popped, !reference.empty());
+                if (popped && !reference.empty()) {
+                    CHECK_EQ(value, reference.front());
+                    reference.pop_front();
+                }
+                break;
+            }
+            case 7: {
+                MultipleOf match = { 3 };
+                uint32_t value = 0;
+                bool taken = ring.takeFirst(value, match);
+                std::deque<uint32_t>::iterator it = reference.begin();
+                while (it != reference.end() && !match(*it)) ++it;
+                CHECK_EQ(taken, it != reference.end());
+                if (taken && it != reference.end()) {
+                    CHECK_EQ(value, *it);
+                    reference.erase(it);
+                }
+                break;
+            }
+            default: {
+                uint8_t newSize = roundedSize((uint8_t)(1 + random.below(20)), 16);
+                uint8_t expectDropped = reference.size() > newSize ?
+                                        (uint8_t)(reference.size() - newSize) : 0;
+                CHECK_EQ(ring.resize((uint8_t)newSize), expectDropped);
+                while (reference.size() > newSize) reference.pop_front();
+                size = newSize;
+                break;
+            }
+        }
+        CHECK_EQ(ring.count(), reference.size());
+        CHECK_EQ(ring.isEmpty(), reference.empty());
+        if (ttp229TestFailures() > 0) {
+            printf("  op %d\n", op);
+            return;
+        }
+    }
+}
+
+TEST(ring_batch_pop) {
+    TTP229EventRing<uint32_t, 8> ring;
+    for (uint32_t i = 0; i < 6; i++) ring.push(i);
+    uint32_t values[8];
+    CHECK_EQ(ring.popBatch(values, 4), 4);
+    CHECK_EQ(values[3], 3);
+    CHECK_EQ(ring.popBatch(values, 8), 2);
+    CHECK_EQ(values[1], 5);
+}
+
+// Six taps (press + release each) with nothing drained: 12 events into
+// a 4-event queue
+static void tapSix(TTP229& keypad) {
+    ttp229TestBegin(keypad);
+    CHECK(keypad.setQueueSize(4));
+    static const TTP229SimStep taps[] = {
+        {0, 0x0001}, {50, 0}, {100, 0x0002}, {150, 0}, {200, 0x0004}, {250, 0},
+        {300, 0x0008}, {350, 0}, {400, 0x0010}, {450, 0}, {500, 0x0020}, {550, 0}
+    };
+    ttp229HostSim().playScript(taps, 12);
+    ttp229TestRun(keypad, 700);
+}
+
+TEST(overflow_drop_newest) {
+    TTP229 keypad(2, 3, true);
+    tapSix(keypad);
+
+    CHECK_EQ(keypad.getQueueCount(), 4);
+    CHECK_EQ(keypad.getQueueOverflows(), 8);
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 4);
+    CHECK_EQ(events[0].key, 1);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(events[3].key, 2);
+    CHECK_EQ(events[3].eventType, TTP229::EVENT_RELEASE);
+}
+
+TEST(overflow_drop_oldest) {
+    TTP229 keypad(2, 3, true);
+    keypad.setOverflowPolicy(TTP229::OVERFLOW_DROP_OLDEST);
+    tapSix(keypad);
+
+    CHECK_EQ(keypad.getQueueCount(), 4);
+    CHECK_EQ(keypad.getQueueOverflows(), 8);
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 4);
+    CHECK_EQ(events[0].key, 5);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(events[3].key, 6);
+    CHECK_EQ(events[3].eventType, TTP229::EVENT_RELEASE);
+}
+
+TEST(overflow_coalesce) {
+    TTP229 keypad(2, 3, true);
+    keypad.setOverflowPolicy(TTP229::OVERFLOW_COALESCE);
+    tapSix(keypad);
+
+    CHECK_EQ(keypad.getQueueCount(), 4);
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 4);
+    CHECK_EQ(events[3].key, 2);
+
+    // Keys 3-6 kept their latest event, sent once there is room
+    keypad.read();
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 4);
+    for (uint8_t i = 0; i < 4; i++) {
+        CHECK_EQ(events[i].key, 6 - i);
+        CHECK_EQ(events[i].eventType, TTP229::EVENT_RELEASE);
+    }
+}
+
+TEST(queue_resize_keeps_events) {
+    TTP229 keypad(2, 3, true);
+    tapSix(keypad);
+
+    CHECK(keypad.setQueueSize(10));
+    CHECK_EQ(keypad.getQueueSize(), 16);
+    CHECK_EQ(keypad.getQueueCount(), 4);
+    TTP229::KeyEvent event;
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.key, 1);
+}
+
+TEST(batch_encoding_round_trip) {
+    TTP229 keypad(2, 3, true);
+    tapSix(keypad);
+
+    uint8_t buffer[64];
+    size_t length = keypad.encodeEvents(buffer, sizeof(buffer));
+    CHECK_EQ(length, TTP229_BATCH_HEADER_BYTES + 4 * 4);
+    CHECK_EQ(keypad.getQueueCount(), 0);
+
+    TTP229BatchReader batch(buffer, length);
+    CHECK(batch.valid());
+    TTP229::KeyEvent event;
+    uint8_t n = 0;
+    while (batch.next(event)) {
+        CHECK_EQ(event.key, n / 2 + 1);
+        CHECK_EQ(event.eventType, n % 2 ? TTP229::EVENT_RELEASE : TTP229::EVENT_PRESS);
+        n++;
+    }
+    CHECK_EQ(n, 4);
+}
@@ -0,0 +1,107 @@
+// TTP229ReplaySource on its own and as the read backend of TTP229
+
+#include <string.h>
+
+#include "ttp229_test.h"
+
+static void putFrames(uint8_t* out, const uint16_t* masks, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        TTP229TraceFrame frame;
+        frame.micros = 1000u + 10000u * i;
+        frame.mask = masks[i];
+        ttp229EncodeTraceFrame(out + i * TTP229_TRACE_FRAME_BYTES, frame);
+    }
+}
+
+TEST(bare_records_in_order) {
+    const uint16_t masks[] = { 0x0000, 0x0001, 0x8001, 0x0100 };
+    uint8_t records[4 * TTP229_TRACE_FRAME_BYTES];
+    putFrames(records, masks, 4);
+
+    TTP229ReplaySource source(records, 4);
+    CHECK_EQ(source.count(), 4);
+    TTP229TraceFrame frame = { 0, 0 };
+    CHECK(source.peek(frame));
+    CHECK(source.peek(frame));              // Peeking does not take it
+    CHECK_EQ(source.position(), 0);
+    CHECK_EQ(frame.micros, 1000);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        CHECK(source.peek(frame));
+        CHECK_EQ(frame.micros, 1000u + 10000u * i);
+        CHECK_EQ(source.read(), masks[i]);
+    }
+    CHECK(source.done());
+    CHECK(!source.peek(frame));
+    CHECK_EQ(source.read(), 0x0100);        // Last frame repeats
+    CHECK_EQ(source.position(), 4);
+
+    source.rewind();
+    CHECK(!source.done());
+    CHECK_EQ(source.read(), 0x0000);
+}
+
+TEST(empty_source_reads_nothing) {
+    TTP229ReplaySource source;
+    CHECK(source.done());
+    CHECK_EQ(source.read(), 0);
+}
+
+TEST(from_dump_finds_the_block) {
+    const uint16_t masks[] = { 0x0004, 0x0000, 0x0004 };
+    uint8_t dump[7 + TTP229_TRACE_HEADER_BYTES + 3 * TTP229_TRACE_FRAME_BYTES];
+    memcpy(dump, "hello\r\n", 7);
+    TTP229TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    header.pressScans = 2;
+    header.releaseScans = 2;
+    header.keys = 16;
+    header.frames = 3;
+    ttp229EncodeTraceHeader(dump + 7, header);
+    putFrames(dump + 7 + TTP229_TRACE_HEADER_BYTES, masks, 3);
+
+    TTP229ReplaySource source = TTP229ReplaySource::fromDump(dump, sizeof(dump));
+    CHECK_EQ(source.count(), 3);
+    for (uint8_t i = 0; i < 3; i++) CHECK_EQ(source.read(), masks[i]);
+
+    // No header: the whole buffer is records, a partial one left out
+    uint8_t bare[2 * TTP229_TRACE_FRAME_BYTES + 3];
+    putFrames(bare, masks, 2);
+    TTP229ReplaySource records = TTP229ReplaySource::fromDump(bare, sizeof(bare));
+    CHECK_EQ(records.count(), 2);
+    CHECK_EQ(records.read(), 0x0004);
+}
+
+TEST(keypad_scans_the_source) {
+    TTP229HostSim& sim = ttp229HostSim();
+    const uint16_t masks[] = { 0x0000, 0x0020, 0x0020, 0x0020, 0x0000, 0x0000 };
+    uint8_t records[6 * TTP229_TRACE_FRAME_BYTES];
+    putFrames(records, masks, 6);
+    TTP229ReplaySource source(records, 6);
+
+    TTP229 keypad;
+    CHECK(keypad.begin(source));
+    CHECK(keypad.isInitialized());
+    CHECK_EQ(keypad.getReadBackend(), TTP229::BACKEND_REPLAY);
+    keypad.setScanInterval(10);
+    keypad.setDebounce((uint8_t)2, (uint8_t)2);
+
+    // One scan per frame, no pins touched
+    uint8_t keys[6];
+    for (uint8_t i = 0; i < 6; i++) {
+        delay(10);
+        keys[i] = keypad.read();
+    }
+    CHECK(source.done());
+    CHECK_EQ(sim.sclEdges, 0);
+    CHECK_EQ(keys[1], 0);                   // Debounced: second frame of the touch
+    CHECK_EQ(keys[2], 6);
+    CHECK_EQ(keys[4], 6);
+    CHECK_EQ(keys[5], 0);
+
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 2);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(events[1].eventType, TTP229::EVENT_RELEASE);
+    CHECK_EQ(events[1].key, 6);
+}
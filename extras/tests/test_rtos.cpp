@@ -0,0 +1,537 @@
+// The scan task, waitForEvent() subscribers and TTP229Group on the
+// FreeRTOS stand-in (TTP229HostRTOS.h). main() is the Arduino loop task;
+// its delay() lets the other tasks run. Built with TTP229_HOST_RTOS.
+
+#include "ttp229_test.h"
+#include "TTP229Group.h"
+
+TEST(scan_task_publishes_events) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.beginRTOS());
+    CHECK(keypad.isRTOSEnabled());
+    CHECK_EQ(ttp229SimRTOS().taskCount(), 2);
+
+    // Nobody calls read() to scan: the task does, every 10ms
+    const TTP229SimStep tap[] = { {100, 0x0010}, {300, 0} };
+    sim.playScript(tap, 2);
+    delay(200);
+    CHECK_EQ(keypad.read(), 5);
+    CHECK_EQ(keypad.getKeyState().mask, 0x0010);
+    delay(1300);
+
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 2);
+    CHECK_EQ(events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(events[0].key, 5);
+    CHECK(events[0].timestamp >= 100 && events[0].timestamp <= 100 + 2 * 10 + 1);
+    CHECK_EQ(events[1].eventType, TTP229::EVENT_RELEASE);
+    CHECK_EQ(keypad.read(), TTP229::KEY_NONE);
+
+    TTP229::RTOSStats stats = keypad.getRTOSStats();
+    CHECK(stats.readsPerSecond >= 95 && stats.readsPerSecond <= 101);
+    CHECK_EQ(stats.scanIntervalMs, 10);
+
+    // No scans once it is stopped
+    keypad.endRTOS();
+    CHECK(!keypad.isRTOSEnabled());
+    CHECK_EQ(ttp229SimRTOS().taskCount(), 1);
+    uint32_t frames = sim.frames;
+    delay(500);
+    CHECK_EQ(sim.frames, frames);
+}
+
+TEST(scan_task_parks_in_interrupt_mode) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.enableInterruptMode());
+    CHECK(keypad.beginRTOS());
+    delay(20);
+
+    // Idle: the task waits for the data-valid notification
+    uint32_t edges = sim.sclEdges;
+    delay(2000);
+    CHECK_EQ(sim.sclEdges, edges);
+
+    const TTP229SimStep tap[] = { {7, 0x0100}, {200, 0} };
+    sim.playScript(tap, 2);
+    uint32_t touchedAt = millis() + 7;
+    delay(500);
+
+    TTP229::KeyEvent events[4];
+    CHECK_EQ(keypad.getKeyEvents(events, 4), 2);
+    CHECK_EQ(events[0].key, 9);
+    CHECK(events[0].timestamp - touchedAt <= 10 + 1);   // Second scan of the touch
+    CHECK_EQ(events[1].eventType, TTP229::EVENT_RELEASE);
+
+    edges = sim.sclEdges;
+    delay(1000);
+    CHECK_EQ(sim.sclEdges, edges);
+    keypad.endRTOS();
+}
+
+// A task that records the events passing its filter until endRTOS()
+struct Consumer {
+    TTP229* keypad;
+    uint16_t eventMask;
+    uint16_t keyMask;
+    TTP229::KeyEvent events[8];
+    uint8_t count;
+    bool done;
+};
+
+static void consumerTask(void* parameter) {
+    Consumer* consumer = (Consumer*)parameter;
+    TTP229::KeyEvent event;
+    while (consumer->keypad->waitForEvent(event, 0xFFFFFFFF, consumer->eventMask, consumer->keyMask)) {
+        if (consumer->count < 8) consumer->events[consumer->count++] = event;
+    }
+    consumer->done = true;
+    vTaskDelete(NULL);
+}
+
+TEST(wait_for_event_subscribers) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.beginRTOS());
+
+    Consumer presses = { &keypad, TTP229::EVENT_MASK_PRESS, 0xFFFF, {}, 0, false };
+    Consumer key5 = { &keypad, TTP229::EVENT_MASK_ALL, 0x0010, {}, 0, false };
+    CHECK_EQ(xTaskCreate(consumerTask, "presses", 2048, &presses, 2, NULL), pdPASS);
+    CHECK_EQ(xTaskCreate(consumerTask, "key5", 2048, &key5, 2, NULL), pdPASS);
+
+    const TTP229SimStep taps[] = { {50, 0x0001}, {150, 0}, {250, 0x0010}, {350, 0} };
+    sim.playScript(taps, 4);
+    delay(500);
+
+    // Each got its own copy of what it asked for
+    CHECK_EQ(presses.count, 2);
+    CHECK_EQ(presses.events[0].key, 1);
+    CHECK_EQ(presses.events[1].key, 5);
+    CHECK_EQ(key5.count, 2);
+    CHECK_EQ(key5.events[0].eventType, TTP229::EVENT_PRESS);
+    CHECK_EQ(key5.events[1].eventType, TTP229::EVENT_RELEASE);
+    CHECK_EQ(key5.events[1].key, 5);
+    CHECK_EQ(keypad.getRTOSStats().missedEvents, 0);
+
+    // The main queue still has all four
+    CHECK_EQ(keypad.getQueueCount(), 4);
+
+    // endRTOS() releases both waiters
+    CHECK(!presses.done && !key5.done);
+    keypad.endRTOS();
+    delay(1);
+    CHECK(presses.done);
+    CHECK(key5.done);
+    CHECK_EQ(ttp229SimRTOS().taskCount(), 1);
+}
+
+TEST(wait_for_event_timeout) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.beginRTOS());
+
+    TTP229::KeyEvent event;
+    uint32_t start = millis();
+    CHECK(!keypad.waitForEvent(event, 100));
+    CHECK_EQ(millis() - start, 100);
+
+    // Woken by the press, not at the timeout
+    const TTP229SimStep tap[] = { {50, 0x0800}, {150, 0} };
+    sim.playScript(tap, 2);
+    start = millis();
+    CHECK_EQ(keypad.readWithTimeout(1000), 12);
+    CHECK(millis() - start <= 50 + 2 * 10 + 1);
+
+    // Subscribed since the first call: the release waited for us
+    CHECK(keypad.waitForEvent(event, 1000));
+    CHECK_EQ(event.eventType, TTP229::EVENT_RELEASE);
+    keypad.unsubscribe();
+    keypad.endRTOS();
+}
+
+TEST(rtos_without_task_polls) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.beginRTOS(false));
+    CHECK_EQ(ttp229SimRTOS().taskCount(), 1);
+
+    // read() scans as without RTOS, and waitForEvent() polls
+    delay(100);
+    CHECK_EQ(sim.frames, 0);
+    sim.setTouched(0x0004);
+    TTP229::KeyEvent event;
+    CHECK(keypad.waitForEvent(event, 100, TTP229::EVENT_MASK_PRESS));
+    CHECK_EQ(event.key, 3);
+    CHECK(sim.frames > 0);
+    keypad.endRTOS();
+}
+
+TEST(rtos_static_storage) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    static TTP229::RTOSBuffers<4096> buffers;
+    CHECK(keypad.beginRTOS(buffers));
+    sim.setTouched(0x0002);
+    delay(50);
+    CHECK_EQ(keypad.read(), 2);
+    keypad.endRTOS();
+
+    TTP229::RTOSStorage noStack;
+    noStack.stack = NULL;
+    noStack.stackDepth = 0;
+    CHECK(!keypad.beginRTOS(noStack));
+}
+
+TEST(group_merges_keypads) {
+    TTP229HostSim& sim = ttp229HostSim();
+    sim.attachChip(2, 3);
+
+    // a and c share SCL 2; b plays back recorded frames
+    TTP229 a(2, 3, true), c(2, 5, true), b;
+    const uint16_t masks[] = { 0x0000, 0x0002, 0x0002, 0x0002, 0x0000, 0x0000 };
+    uint8_t records[6 * TTP229_TRACE_FRAME_BYTES];
+    for (uint8_t i = 0; i < 6; i++) {
+        TTP229TraceFrame frame;
+        frame.micros = 10000u * i;
+        frame.mask = masks[i];
+        ttp229EncodeTraceFrame(records + i * TTP229_TRACE_FRAME_BYTES, frame);
+    }
+    TTP229ReplaySource source(records, 6);
+    TTP229* keypads[3] = { &a, &b, &c };
+    a.begin();
+    b.begin(source);
+    c.begin();
+    for (uint8_t i = 0; i < 3; i++) keypads[i]->setDebounce((uint8_t)2, (uint8_t)2);
+
+    TTP229Group group;
+    CHECK_EQ(group.addDevice(a), 0);
+    CHECK_EQ(group.addDevice(b), 1);
+    CHECK_EQ(group.addDevice(c), 2);
+    CHECK_EQ(group.addDevice(a), TTP229Group::DEVICE_INVALID);   // Already in
+    CHECK_EQ(group.getDeviceCount(), 3);
+    CHECK(group.getDevice(1) == &b);
+
+    const TTP229SimStep tap[] = { {100, 0x0010}, {200, 0} };
+    sim.playScript(tap, 2);
+    CHECK(group.begin(10));
+    delay(150);
+    CHECK_EQ(a.read(), 5);
+    delay(150);
+
+    // One queue, tagged by keypad, in the order they happened
+    uint8_t devices[8], keys[8], types[8];
+    uint8_t count = 0;
+    TTP229Group::GroupEvent event;
+    while (count < 8 && group.getEvent(event)) {
+        devices[count] = event.deviceId;
+        keys[count] = event.event.key;
+        types[count] = event.event.eventType;
+        count++;
+    }
+    CHECK_EQ(count, 4);
+    const uint8_t wantDevices[] = { 1, 1, 0, 0 };
+    const uint8_t wantKeys[] = { 2, 2, 5, 5 };
+    for (uint8_t i = 0; i < 4 && i < count; i++) {
+        CHECK_EQ(devices[i], wantDevices[i]);
+        CHECK_EQ(keys[i], wantKeys[i]);
+        CHECK_EQ(types[i], i % 2 ? TTP229::EVENT_RELEASE : TTP229::EVENT_PRESS);
+    }
+
+    // a and c clocked by one train: one chip frame per pass
+    TTP229Group::DeviceStats statsA = group.getDeviceStats(0);
+    TTP229Group::DeviceStats statsC = group.getDeviceStats(2);
+    CHECK(statsA.scans >= 29 && statsA.scans <= 31);
+    CHECK_EQ(statsC.scans, statsA.scans);
+    CHECK_EQ(sim.frames, statsA.scans);
+    CHECK_EQ(statsA.events, 2);
+    CHECK_EQ(group.getDeviceStats(1).events, 2);
+    CHECK_EQ(statsC.events, 0);
+    CHECK_EQ(statsA.queueOverflows, 0);
+
+    // Stopped, and the keypads are free again
+    group.end();
+    uint32_t frames = sim.frames;
+    delay(100);
+    CHECK_EQ(sim.frames, frames);
+    CHECK_EQ(group.getDeviceCount(), 0);
+    CHECK_EQ(ttp229SimRTOS().taskCount(), 1);
+}
+
+TEST(group_without_task) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 a(2, 3, true), b(6, 7, true);
+    ttp229TestBegin(a);
+    b.begin();
+
+    // A keypad with its own scan task cannot join
+    CHECK(b.beginRTOS());
+    TTP229Group group;
+    CHECK_EQ(group.addDevice(b), TTP229Group::DEVICE_INVALID);
+    b.endRTOS();
+
+    CHECK_EQ(group.addDevice(a), 0);
+    CHECK(group.begin(10, false));
+    CHECK_EQ(ttp229SimRTOS().taskCount(), 1);
+
+    // update() from loop() does the scanning
+    sim.setTouched(0x8000);
+    for (uint8_t i = 0; i < 5; i++) {
+        group.update();
+        delay(10);
+    }
+    CHECK_EQ(group.getQueueCount(), 1);
+    TTP229Group::GroupEvent event;
+    CHECK(group.getEvent(event));
+    CHECK_EQ(event.deviceId, 0);
+    CHECK_EQ(event.event.key, 16);
+    CHECK_EQ(group.getDeviceStats(0).scans, 5);
+    group.end();
+}
+
+TEST(group_queue_overflows) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 a(2, 3, true);
+    ttp229TestBegin(a);
+    TTP229Group group;
+    group.addDevice(a);
+    group.setQueueSize(3);                          // Rounded up to 4
+    CHECK(group.begin(10, false));
+
+    // Three taps, nobody reading: the two newest events are dropped
+    const TTP229SimStep taps[] = {
+        {0, 0x0001}, {50, 0}, {100, 0x0002}, {150, 0}, {200, 0x0004}, {250, 0}
+    };
+    sim.playScript(taps, 6);
+    for (uint8_t i = 0; i < 35; i++) {
+        group.update();
+        delay(10);
+    }
+    CHECK_EQ(group.getQueueCount(), 4);
+    TTP229Group::DeviceStats stats = group.getDeviceStats(0);
+    CHECK_EQ(stats.events, 4);
+    CHECK_EQ(stats.queueOverflows, 2);
+
+    TTP229Group::GroupEvent event;
+    for (uint8_t i = 0; i < 4; i++) {
+        CHECK(group.getEvent(event));
+        CHECK_EQ(event.event.key, 1 + i / 2);
+    }
+    CHECK(!group.getEvent(event));
+    group.end();
+}
+
+TEST(group_live_resize) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 a(2, 3, true);
+    ttp229TestBegin(a);
+    TTP229Group group;
+    group.addDevice(a);
+    CHECK(group.begin(10));
+
+    // Five taps queued, then shrunk from the loop task: the group task
+    // drops the oldest at its next pass
+    TTP229SimStep taps[10];
+    for (uint8_t i = 0; i < 5; i++) {
+        taps[2 * i].atMs = 100u * i;
+        taps[2 * i].mask = TTP229::keyToMask(i + 1);
+        taps[2 * i + 1].atMs = 100u * i + 50;
+        taps[2 * i + 1].mask = 0;
+    }
+    sim.playScript(taps, 10);
+    delay(600);
+    CHECK_EQ(group.getQueueCount(), 10);
+    uint32_t start = millis();
+    CHECK(group.setQueueSize(4));
+    CHECK(millis() - start <= 10);
+    CHECK_EQ(group.getQueueCount(), 4);
+    CHECK_EQ(group.getDeviceStats(0).queueOverflows, 6);
+
+    TTP229Group::GroupEvent event;
+    CHECK(group.getEvent(event));
+    CHECK_EQ(event.event.key, 4);
+
+    // Grown again: queued events kept, and room for more
+    CHECK(group.setQueueSize(16));
+    CHECK_EQ(group.getQueueCount(), 3);
+    sim.playScript(taps, 10);
+    delay(600);
+    CHECK_EQ(group.getQueueCount(), 13);
+    CHECK_EQ(group.getDeviceStats(0).queueOverflows, 6);
+    group.end();
+
+    CHECK(!group.setQueueSize(0));
+}
+
+TEST(group_static_task_and_footprint) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 a(2, 3, true);
+    ttp229TestBegin(a);
+    TTP229Group group(1, 4096);
+    group.addDevice(a);
+
+    // Before begin(): the object only, merged ring inside it
+    TTP229::MemoryFootprint idle = group.getMemoryFootprint();
+    CHECK_EQ(idle.object, sizeof(TTP229Group));
+    CHECK(idle.eventRing >= TTP229_GROUP_QUEUE_CAPACITY * sizeof(TTP229Group::GroupEvent));
+    CHECK(idle.eventRing < idle.object);
+    CHECK_EQ(idle.total, idle.object);
+    CHECK_EQ(idle.heap, 0);
+
+    CHECK(group.begin(10));
+    TTP229::MemoryFootprint heap = group.getMemoryFootprint();
+    CHECK_EQ(heap.taskStack, 4096);
+    CHECK_EQ(heap.rtosObjects, sizeof(StaticTask_t));
+    CHECK_EQ(heap.heap, heap.taskStack + heap.rtosObjects);
+    CHECK_EQ(heap.total, heap.object + heap.heap);
+    group.end();
+
+    // Same footprint from caller-owned memory, none of it heap
+    static TTP229::RTOSBuffers<2048> buffers;
+    group.addDevice(a);
+    CHECK(group.begin(buffers, 10));
+    sim.setTouched(0x0040);
+    delay(50);
+    CHECK_EQ(a.read(), 7);
+    TTP229::MemoryFootprint fixed = group.getMemoryFootprint();
+    CHECK_EQ(fixed.taskStack, 2048);
+    CHECK_EQ(fixed.heap, 0);
+    CHECK_EQ(fixed.total, fixed.object + 2048 + sizeof(StaticTask_t));
+    group.end();
+
+    TTP229::RTOSStorage noStack;
+    noStack.stack = NULL;
+    noStack.stackDepth = 0;
+    group.addDevice(a);
+    CHECK(!group.begin(noStack));
+}
+
+static uint8_t handledKeys[8];
+static uint8_t handledCount;
+
+static void handled(const TTP229::KeyEvent& event) {
+    if (handledCount < 8) handledKeys[handledCount++] = event.key;
+}
+
+TEST(dispatch_keeps_wait_filter) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.beginRTOS());
+    handledCount = 0;
+    keypad.onPress(TTP229::KEY_ANY, handled);
+
+    // The loop task waits for key 1 presses only
+    TTP229::KeyEvent event;
+    CHECK(!keypad.waitForEvent(event, 0, TTP229::EVENT_MASK_PRESS, 0x0001));
+
+    // Queued before dispatchEvents() is first called: still handled
+    const TTP229SimStep taps[] = { {0, 0x0002}, {50, 0}, {100, 0x0001}, {150, 0} };
+    sim.playScript(taps, 4);
+    delay(200);
+    CHECK_EQ(keypad.dispatchEvents(), 4);
+    CHECK_EQ(handledCount, 2);
+    CHECK_EQ(handledKeys[0], 2);
+    CHECK_EQ(handledKeys[1], 1);
+
+    // ...and the loop task's filter is unchanged: only key 1's press
+    CHECK(keypad.waitForEvent(event, 0, TTP229::EVENT_MASK_PRESS, 0x0001));
+    CHECK_EQ(event.key, 1);
+    CHECK(!keypad.waitForEvent(event, 0, TTP229::EVENT_MASK_PRESS, 0x0001));
+    keypad.endRTOS();
+}
+
+TEST(dispatch_sleeps_until_queued) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    CHECK(keypad.beginRTOS());
+    handledCount = 0;
+    keypad.onPress(TTP229::KEY_ANY, handled);
+
+    // Woken by the scan task's push
+    const TTP229SimStep tap[] = { {50, 0x4000}, {100, 0} };
+    sim.playScript(tap, 2);
+    uint32_t start = millis();
+    CHECK_EQ(keypad.dispatchEvents(0xFFFFFFFF), 1);
+    CHECK(millis() - start <= 50 + 2 * 10 + 1);
+    CHECK_EQ(handledKeys[0], 15);
+
+    // endRTOS() from another task ends a wait forever
+    struct Stopper {
+        static void run(void* parameter) {
+            vTaskDelay(300);
+            ((TTP229*)parameter)->endRTOS();
+            vTaskDelete(NULL);
+        }
+    };
+    xTaskCreate(Stopper::run, "stopper", 2048, &keypad, 1, NULL);
+    CHECK_EQ(keypad.dispatchEvents(0xFFFFFFFF), 1);   // The release, no handler
+    start = millis();
+    CHECK_EQ(keypad.dispatchEvents(500), 0);
+    CHECK(!keypad.isRTOSEnabled());
+    CHECK(millis() - start >= 500);
+}
+
+TEST(group_dispatch_modes) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 a(2, 3, true);
+    ttp229TestBegin(a);
+    handledCount = 0;
+    a.onPress(TTP229::KEY_ANY, handled);
+
+    TTP229Group group;
+    group.addDevice(a);
+    CHECK(group.begin(10));
+
+    // Deferred: every event goes to the group, pressed ones also to the
+    // keypad for dispatchEvents()
+    const TTP229SimStep tap[] = { {0, 0x0100}, {50, 0} };
+    sim.playScript(tap, 2);
+    delay(100);
+    CHECK_EQ(handledCount, 0);
+    CHECK_EQ(group.getQueueCount(), 2);
+    CHECK_EQ(a.getQueueCount(), 1);
+    CHECK_EQ(a.dispatchEvents(), 1);
+    CHECK_EQ(handledKeys[0], 9);
+
+    // Immediate: run on the group task, handled press not posted
+    a.setDispatchMode(TTP229::DISPATCH_IMMEDIATE);
+    sim.playScript(tap, 2);
+    delay(100);
+    CHECK_EQ(handledCount, 2);
+    CHECK_EQ(group.getQueueCount(), 3);
+    CHECK_EQ(a.getQueueCount(), 0);
+    group.end();
+}
+
+TEST(group_keypad_subscribers) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 a(2, 3, true);
+    ttp229TestBegin(a);
+    TTP229Group group;
+    group.addDevice(a);
+    CHECK(group.begin(10));
+
+    Consumer releases = { &a, TTP229::EVENT_MASK_RELEASE, 0xFFFF, {}, 0, false };
+    xTaskCreate(consumerTask, "releases", 2048, &releases, 2, NULL);
+    const TTP229SimStep taps[] = { {0, 0x0001}, {50, 0}, {100, 0x0002}, {150, 0} };
+    sim.playScript(taps, 4);
+    delay(200);
+    CHECK_EQ(releases.count, 2);
+    CHECK_EQ(releases.events[1].key, 2);
+    CHECK_EQ(group.getQueueCount(), 4);
+
+    // end() releases the waiter
+    group.end();
+    delay(1);
+    CHECK(releases.done);
+    CHECK_EQ(ttp229SimRTOS().taskCount(), 1);
+}
@@ -0,0 +1,126 @@
+// readRawMask() against the chip model: bit order, 8/16-key frames,
+// multi-touch and the compile-time TTP229Static reader
+
+#include "ttp229_test.h"
+#include "TTP229Static.h"
+
+TEST(every_key_16) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    for (uint8_t key = 1; key <= 16; key++) {
+        sim.setTouched(TTP229::keyToMask(key));
+        delay(1);
+        uint32_t edges = sim.sclEdges;
+        CHECK_EQ(keypad.readRawMask(), TTP229::keyToMask(key));
+        CHECK_EQ(sim.sclEdges - edges, 16);
+        delay(5);  // Frame timeout: the chip starts the next frame at key 1
+    }
+    sim.setTouched(0);
+    delay(1);
+    CHECK_EQ(keypad.readRawMask(), 0);
+}
+
+TEST(multitouch_16) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    TTP229TestRandom random(16);
+    for (int i = 0; i < 500; i++) {
+        uint16_t mask = (uint16_t)random.next();
+        sim.setTouched(mask);
+        delay(1);
+        CHECK_EQ(keypad.readRawMask(), mask);
+        delay(5);
+    }
+}
+
+TEST(frames_8) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, false);
+    ttp229TestBegin(keypad, false);
+
+    TTP229TestRandom random(8);
+    for (int i = 0; i < 500; i++) {
+        uint16_t mask = (uint16_t)random.next();
+        sim.setTouched(mask);  // Keys 9-16 do not exist in 8-key mode
+        delay(1);
+        uint32_t edges = sim.sclEdges;
+        CHECK_EQ(keypad.readRawMask(), mask & 0x00FF);
+        CHECK_EQ(sim.sclEdges - edges, 8);
+        delay(5);
+    }
+}
+
+TEST(back_to_back_frames) {
+    // Without the frame timeout in between the chip continues where it
+    // stopped - a whole frame per read keeps the bits aligned
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    sim.setTouched(0x8001);
+    delay(1);
+    for (int i = 0; i < 10; i++) CHECK_EQ(keypad.readRawMask(), 0x8001);
+}
+
+TEST(static_reader_matches) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229Static<2, 3> keypad16;
+    sim.attachChip(2, 3, 16);
+    keypad16.begin();
+
+    TTP229TestRandom random(3);
+    for (int i = 0; i < 200; i++) {
+        uint16_t mask = (uint16_t)random.next();
+        sim.setTouched(mask);
+        delay(1);
+        CHECK_EQ(keypad16.readRawMask(), mask);
+        delay(5);
+    }
+
+    sim.reset();
+    TTP229Static<2, 3, 8> keypad8;
+    sim.attachChip(2, 3, 8);
+    keypad8.begin();
+    for (int i = 0; i < 200; i++) {
+        uint16_t mask = (uint16_t)random.next();
+        sim.setTouched(mask);
+        delay(1);
+        CHECK_EQ(keypad8.readRawMask(), mask & 0x00FF);
+        delay(5);
+    }
+}
+
+TEST(static_sub_microsecond_clock) {
+    // A 300ns half period still spends its time on every edge
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229Static<2, 3, 16, 300, 300> keypad;
+    sim.attachChip(2, 3, 16);
+    keypad.begin();
+    sim.ioCostNs = 0;
+
+    sim.setTouched(0x0101);
+    delay(1);
+    uint64_t start = sim.nowNs;
+    CHECK_EQ(keypad.readRawMask(), 0x0101);
+    CHECK_EQ(sim.nowNs - start, 300 + 16 * 2 * 300);
+}
+
+TEST(static_debounced_read) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229Static<2, 3> keypad;
+    sim.attachChip(2, 3, 16);
+    keypad.begin();
+    keypad.setDebounce(2, 2);
+
+    sim.setTouched(0x0010);
+    delay(10);
+    CHECK_EQ(keypad.read(), 0);   // First scan only counts
+    delay(10);
+    CHECK_EQ(keypad.read(), 5);
+    CHECK(keypad.wasPressed());
+    CHECK_EQ(keypad.getPressedMask(), 0x0010);
+}
@@ -0,0 +1,142 @@
+// KeyState snapshot (seqlock) and Reader cursors
+
+#include <atomic>
+#include <thread>
+
+#include "ttp229_test.h"
+
+TEST(snapshot_fields) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    TTP229::KeyState state = keypad.getKeyState();
+    CHECK_EQ(state.mask, 0);
+    CHECK_EQ(state.key, 0);
+
+    sim.setTouched(0x0006);
+    ttp229TestRun(keypad, 30);
+    state = keypad.getKeyState();
+    CHECK_EQ(state.mask, 0x0006);
+    CHECK_EQ(state.pressed, 0x0006);
+    CHECK_EQ(state.released, 0);
+    CHECK_EQ(state.key, 3);
+    CHECK_EQ(state.scanSequence, 2);        // Second scan accepts it
+    CHECK(state.timestamp >= 10 && state.timestamp <= 30);
+
+    sim.setTouched(0x0002);
+    ttp229TestRun(keypad, 30);
+    state = keypad.getKeyState();
+    CHECK_EQ(state.mask, 0x0002);
+    CHECK_EQ(state.pressed, 0);
+    CHECK_EQ(state.released, 0x0004);
+    CHECK_EQ(state.key, 2);
+    CHECK_EQ(keypad.getKeyMask(), 0x0002);
+}
+
+TEST(snapshot_concurrent_reader) {
+    // A second thread reads while the scan path publishes: every copy
+    // must be one whole published state, never a mix of two
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setDebounce((uint8_t)1, (uint8_t)1);
+    keypad.enableEventQueue(false);
+
+    std::atomic<bool> done(false);
+    std::atomic<long> torn(0), reads(0), backwards(0);
+    std::thread reader([&]() {
+        uint32_t lastSequence = 0;
+        while (!done.load()) {
+            TTP229::KeyState state = keypad.getKeyState();
+            // Touches alternate with no touch, so a held mask was all
+            // pressed in its change and an empty one all released
+            bool whole = state.mask != 0 ?
+                (state.mask & 1) != 0 && state.pressed == state.mask && state.released == 0 :
+                state.pressed == 0;
+            if (!whole || state.key != TTP229::maskToKey(state.mask)) torn++;
+            if (state.scanSequence < lastSequence) backwards++;
+            lastSequence = state.scanSequence;
+            reads++;
+        }
+    });
+
+    // Every other scan sees a random touch (key 1 always in it), the
+    // rest none, so each scan publishes a change
+    TTP229TestRandom random(21);
+    for (int i = 0; i < 100000; i++) {
+        sim.setTouched(i % 2 ? 0 : (uint16_t)(random.next() | 1));
+        keypad.service();
+        delay(10);
+    }
+    CHECK(keypad.getScanSequence() >= 100000);
+    done = true;
+    reader.join();
+
+    CHECK_EQ(torn.load(), 0);
+    CHECK_EQ(backwards.load(), 0);
+    CHECK(reads.load() > 0);
+}
+
+TEST(readers_see_every_edge) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    TTP229::Reader fast = keypad.reader();
+    TTP229::Reader slow = keypad.reader();
+
+    uint16_t slowPressed = 0, slowReleased = 0;
+    int fastPresses = 0;
+    for (uint8_t key = 1; key <= 4; key++) {
+        sim.setTouched(TTP229::keyToMask(key));
+        ttp229TestRun(keypad, 30);
+        fast.update();
+        if (fast.wasPressed() && fast.isKeyPressed(key)) fastPresses++;
+        CHECK_EQ(fast.getKey(), key);
+        fast.update();
+        CHECK(!fast.wasPressed());          // Seen once only
+    }
+    sim.setTouched(0);
+    ttp229TestRun(keypad, 30);
+
+    // The slow reader catches up on all eight changes at once
+    slow.update();
+    slowPressed = slow.getPressedMask();
+    slowReleased = slow.getReleasedMask();
+    CHECK_EQ(fastPresses, 4);
+    CHECK_EQ(slowPressed, 0x000F);
+    CHECK_EQ(slowReleased, 0x000F);
+    CHECK_EQ(slow.getKeyMask(), 0);
+    CHECK_EQ(slow.getMissed(), 0);
+}
+
+TEST(reader_resyncs_when_behind) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    TTP229::Reader reader = keypad.reader();
+    // More changes than the history holds
+    for (int i = 0; i < TTP229_STATE_HISTORY + 4; i++) {
+        sim.setTouched(i % 2 ? 0x0001 : 0x0002);
+        ttp229TestRun(keypad, 30);
+    }
+    reader.update();
+    CHECK_EQ(reader.getMissed(), 1);
+    CHECK_EQ(reader.getKeyMask(), keypad.getKeyMask());
+    reader.update();
+    CHECK(!reader.wasPressed() && !reader.wasReleased());
+}
+
+TEST(reader_starts_without_edges) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    sim.setTouched(0x0080);
+    ttp229TestRun(keypad, 30);
+    TTP229::Reader reader = keypad.reader();
+    CHECK_EQ(reader.update(), 8);
+    CHECK(!reader.wasPressed());
+}
@@ -0,0 +1,58 @@
+// KeyEvent::edgeMicros / acceptMicros / scanSequence, built with
+// TTP229_EVENT_TIMING
+
+#include "ttp229_test.h"
+
+#if !defined(TTP229_EVENT_TIMING)
+#error "test_timing needs TTP229_EVENT_TIMING"
+#endif
+
+TEST(press_release_stamps) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    ttp229TestRun(keypad, 25);
+    uint32_t touchUs = sim.nowUs();
+    sim.setTouched(0x0010);
+    ttp229TestRun(keypad, 40);
+    uint32_t pressSequence = 0;
+
+    TTP229::KeyEvent event;
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.eventType, TTP229::EVENT_PRESS);
+    // First frame after the touch, then one scan interval to the second
+    CHECK(event.edgeMicros >= touchUs && event.edgeMicros - touchUs <= 10000);
+    CHECK(event.acceptMicros - event.edgeMicros >= 9000 &&
+          event.acceptMicros - event.edgeMicros <= 11000);
+    pressSequence = event.scanSequence;
+    CHECK(pressSequence > 0 && pressSequence < keypad.getScanSequence());
+
+    uint32_t releaseUs = sim.nowUs();
+    sim.setTouched(0);
+    ttp229TestRun(keypad, 40);
+    CHECK(keypad.getKeyEvents(event));
+    CHECK_EQ(event.eventType, TTP229::EVENT_RELEASE);
+    CHECK(event.edgeMicros >= releaseUs && event.edgeMicros - releaseUs <= 10000);
+    CHECK(event.acceptMicros > event.edgeMicros);
+    // 40ms at 10ms per scan
+    CHECK(event.scanSequence - pressSequence >= 4 && event.scanSequence - pressSequence <= 5);
+}
+
+TEST(timer_events_stamped_when_generated) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setHoldThreshold(500, 1000);
+
+    sim.setTouched(0x0001);
+    ttp229TestRun(keypad, 700);
+
+    TTP229::KeyEvent press, hold;
+    CHECK(keypad.getKeyEvents(press));
+    CHECK(keypad.getKeyEvents(hold));
+    CHECK_EQ(hold.eventType, TTP229::EVENT_HOLD);
+    CHECK_EQ(hold.edgeMicros, hold.acceptMicros);
+    CHECK(hold.edgeMicros - press.acceptMicros >= 499000 &&
+          hold.edgeMicros - press.acceptMicros <= 501000);
+}
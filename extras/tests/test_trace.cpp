@@ -0,0 +1,185 @@
+// Raw frame trace: dumpTrace() of a known frame sequence read back with
+// TTP229TraceReader, and replayed through TTP229ReplaySource. Built with
+// TTP229_TRACE_DEPTH 64.
+
+#include <string.h>
+
+#include "ttp229_test.h"
+
+// dumpTrace() output: anything with write(buffer, length)
+struct DumpBuffer {
+    uint8_t data[1024];
+    size_t length;
+
+    DumpBuffer() : length(0) {}
+
+    size_t write(const uint8_t* bytes, size_t size) {
+        if (size > sizeof(data) - length) size = sizeof(data) - length;
+        memcpy(data + length, bytes, size);
+        length += size;
+        return size;
+    }
+};
+
+struct ScannedFrame {
+    uint32_t before;    // micros() before the read() that scanned it
+    uint32_t after;
+    uint16_t mask;
+};
+
+// read() every ms; each scan gets the next random touch state
+static uint32_t scanFrames(TTP229& keypad, ScannedFrame* frames, uint32_t count, uint32_t seed) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229TestRandom random(seed);
+    uint32_t first = keypad.getScanSequence();
+    uint16_t mask = (uint16_t)random.next();
+    sim.setTouched(mask);
+    for (uint32_t scanned = 0; scanned < count;) {
+        uint32_t before = micros();
+        keypad.read();
+        if (keypad.getScanSequence() - first != scanned) {
+            frames[scanned].before = before;
+            frames[scanned].after = micros();
+            frames[scanned].mask = mask;
+            scanned++;
+            mask = (uint16_t)random.next();
+            sim.setTouched(mask);
+        }
+        delay(1);
+    }
+    return keypad.getScanSequence();
+}
+
+TEST(dump_matches_scans) {
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setHoldThreshold(800, 1500);
+
+    ScannedFrame scanned[40];
+    uint32_t lastSequence = scanFrames(keypad, scanned, 40, 23);
+    CHECK_EQ(keypad.getTraceCount(), 40);
+
+    // Other serial output before the block, as on a real port
+    DumpBuffer dump;
+    dump.write((const uint8_t*)"boot log\r\n", 10);
+    size_t written = keypad.dumpTrace(dump);
+    CHECK_EQ(written, TTP229_TRACE_HEADER_BYTES + 40 * TTP229_TRACE_FRAME_BYTES);
+
+    TTP229TraceReader trace(dump.data, dump.length);
+    CHECK(trace.valid());
+    const TTP229TraceHeader& header = trace.header();
+    CHECK_EQ(header.pressScans, 2);
+    CHECK_EQ(header.releaseScans, 2);
+    CHECK_EQ(header.keys, 16);
+    CHECK_EQ(header.scanIntervalMs, 10);
+    CHECK_EQ(header.holdMs, 800);
+    CHECK_EQ(header.longPressMs, 1500);
+    CHECK_EQ(header.frames, 40);
+    CHECK_EQ(header.lastSequence, lastSequence);
+
+    TTP229TraceFrame frame = { 0, 0 };
+    for (uint8_t i = 0; i < 40; i++) {
+        CHECK(trace.next(frame));
+        CHECK_EQ(frame.mask, scanned[i].mask);
+        CHECK(frame.micros >= scanned[i].before && frame.micros <= scanned[i].after);
+    }
+    CHECK(!trace.next(frame));
+}
+
+TEST(ring_keeps_newest_frames) {
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    ScannedFrame scanned[100];
+    scanFrames(keypad, scanned, 100, 5);
+    CHECK_EQ(keypad.getTraceCount(), TTP229_TRACE_DEPTH);
+
+    DumpBuffer dump;
+    keypad.dumpTrace(dump);
+    TTP229TraceReader trace(dump.data, dump.length);
+    CHECK(trace.valid());
+    CHECK_EQ(trace.header().frames, TTP229_TRACE_DEPTH);
+
+    // Oldest kept frame first
+    TTP229TraceFrame frame = { 0, 0 };
+    for (uint32_t i = 100 - TTP229_TRACE_DEPTH; i < 100; i++) {
+        CHECK(trace.next(frame));
+        CHECK_EQ(frame.mask, scanned[i].mask);
+    }
+}
+
+TEST(trace_off_and_clear) {
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+
+    ScannedFrame scanned[10];
+    keypad.enableTrace(false);
+    scanFrames(keypad, scanned, 10, 3);
+    CHECK_EQ(keypad.getTraceCount(), 0);
+
+    keypad.enableTrace(true);
+    scanFrames(keypad, scanned, 10, 3);
+    CHECK_EQ(keypad.getTraceCount(), 10);
+    keypad.clearTrace();
+    CHECK_EQ(keypad.getTraceCount(), 0);
+
+    DumpBuffer dump;
+    CHECK_EQ(keypad.dumpTrace(dump), TTP229_TRACE_HEADER_BYTES);
+    TTP229TraceReader trace(dump.data, dump.length);
+    CHECK(trace.valid());
+    CHECK_EQ(trace.header().frames, 0);
+}
+
+TEST(replay_of_dump_gives_same_events) {
+    TTP229HostSim& sim = ttp229HostSim();
+    TTP229 keypad(2, 3, true);
+    ttp229TestBegin(keypad);
+    keypad.setDebounce((uint8_t)3, (uint8_t)2);
+    keypad.setHoldThreshold(200, 400);
+
+    // Bouncy taps and a hold, well inside 64 frames of 10ms
+    const TTP229SimStep touches[] = {
+        {5, 0x0001}, {8, 0}, {12, 0x0001}, {90, 0}, {150, 0x0040},
+        {153, 0}, {156, 0x0040}, {600, 0}
+    };
+    sim.playScript(touches, 8);
+    ttp229TestRun(keypad, 630);
+    CHECK(keypad.getTraceCount() < TTP229_TRACE_DEPTH);
+
+    TTP229::KeyEvent recorded[16];
+    size_t recordedCount = keypad.getKeyEvents(recorded, 16);
+    CHECK_EQ(recordedCount, 6);   // Press/release, press/hold/long press/release
+
+    DumpBuffer dump;
+    keypad.dumpTrace(dump);
+    TTP229TraceReader trace(dump.data, dump.length);
+    CHECK(trace.valid());
+
+    // Replay with the settings from the header, one scan per frame at
+    // the frame's time (as extras/host/ttp229_replay.cpp does)
+    TTP229ReplaySource source = TTP229ReplaySource::fromDump(dump.data, dump.length);
+    CHECK_EQ(source.count(), trace.header().frames);
+    TTP229 replay;
+    CHECK(replay.begin(source));
+    CHECK_EQ(replay.getReadBackend(), TTP229::BACKEND_REPLAY);
+    replay.setDebounce(trace.header().pressScans, trace.header().releaseScans);
+    replay.setHoldThreshold(trace.header().holdMs, trace.header().longPressMs);
+
+    TTP229::KeyEvent replayed[16];
+    size_t replayedCount = 0;
+    TTP229TraceFrame frame = { 0, 0 };
+    while (source.peek(frame)) {
+        sim.nowNs = (uint64_t)frame.micros * 1000;
+        replay.service();
+        replayedCount += replay.getKeyEvents(replayed + replayedCount, 16 - replayedCount);
+    }
+    CHECK(source.done());
+
+    CHECK_EQ(replayedCount, recordedCount);
+    for (size_t i = 0; i < recordedCount && i < replayedCount; i++) {
+        CHECK_EQ(replayed[i].key, recorded[i].key);
+        CHECK_EQ(replayed[i].eventType, recorded[i].eventType);
+        // Same frame; the recording stamped it after the frame was read
+        CHECK(recorded[i].timestamp - replayed[i].timestamp <= 1);
+    }
+}
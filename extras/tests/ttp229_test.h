@@ -0,0 +1,131 @@
+#ifndef TTP229_TEST_H
+#define TTP229_TEST_H
+
+// ==============================================
+// HOST TEST RUNNER
+// ==============================================
+// Tiny self-registering test runner for the host tests (no framework to
+// install). Every TEST() starts on a fresh simulated board at t=0;
+// CHECK() / CHECK_EQ() record a failure and carry on. main() returns
+// non-zero if anything failed, which fails the build step and ctest.
+//
+// PERF() prints one "PERF <test> <name>=<value>" line and fails the test
+// if the value is over its limit, so a slowdown in virtual time (more
+// frames, longer latency, dropped events) breaks the build like any
+// other regression.
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "TTP229.h"
+
+struct TTP229TestCase {
+    const char* name;
+    void (*run)();
+    TTP229TestCase* next;
+};
+
+inline TTP229TestCase*& ttp229TestList() {
+    static TTP229TestCase* head = NULL;
+    return head;
+}
+
+inline int& ttp229TestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline const char*& ttp229TestCurrent() {
+    static const char* name = "";
+    return name;
+}
+
+struct TTP229TestRegistrar {
+    explicit TTP229TestRegistrar(TTP229TestCase* test) {
+        // Keep file order
+        TTP229TestCase** tail = &ttp229TestList();
+        while (*tail != NULL) tail = &(*tail)->next;
+        *tail = test;
+    }
+};
+
+inline void ttp229TestFail(const char* file, int line, const char* what) {
+    printf("  %s:%d: %s: CHECK(%s) failed\n", file, line, ttp229TestCurrent(), what);
+    ttp229TestFailures()++;
+}
+
+inline void ttp229TestFailEq(const char* file, int line, const char* a, const char* b,
+                             long long valueA, long long valueB) {
+    printf("  %s:%d: %s: CHECK_EQ(%s, %s) failed: %lld != %lld\n", file, line,
+           ttp229TestCurrent(), a, b, valueA, valueB);
+    ttp229TestFailures()++;
+}
+
+#define TEST(name) \
+    static void name(); \
+    static TTP229TestCase name##_case = { #name, name, NULL }; \
+    static TTP229TestRegistrar name##_registrar(&name##_case); \
+    static void name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) ttp229TestFail(__FILE__, __LINE__, #cond); } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        long long _a = (long long)(a), _b = (long long)(b); \
+        if (_a != _b) ttp229TestFailEq(__FILE__, __LINE__, #a, #b, _a, _b); \
+    } while (0)
+
+#define PERF(name, value, limit) \
+    do { \
+        double _value = (double)(value); \
+        printf("PERF %s %s=%.3f limit=%.3f\n", ttp229TestCurrent(), name, _value, (double)(limit)); \
+        if (_value > (double)(limit)) ttp229TestFail(__FILE__, __LINE__, name " within limit"); \
+    } while (0)
+
+// Deterministic pseudo-random numbers (same sequence on every host)
+struct TTP229TestRandom {
+    uint32_t state;
+    explicit TTP229TestRandom(uint32_t seed) : state(seed ? seed : 1) {}
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    uint32_t below(uint32_t n) { return next() % n; }
+};
+
+// Keypad on SCL=2, SDO=3 of the simulated board with fixed timing, so
+// results do not depend on the host's board defaults
+inline void ttp229TestBegin(TTP229& keypad, bool is16Keys = true) {
+    ttp229HostSim().attachChip(2, 3, is16Keys ? 16 : 8);
+    keypad.begin();
+    keypad.setScanInterval(10);
+    keypad.setDebounce((uint8_t)2, (uint8_t)2);
+}
+
+// read() once per virtual millisecond for ms milliseconds
+inline void ttp229TestRun(TTP229& keypad, uint32_t ms) {
+    uint32_t start = millis();
+    while (millis() - start < ms) {
+        keypad.read();
+        delay(1);
+    }
+}
+
+int main() {
+    int tests = 0;
+    for (TTP229TestCase* test = ttp229TestList(); test != NULL; test = test->next) {
+        ttp229HostSim().reset();
+        ttp229TestCurrent() = test->name;
+        int before = ttp229TestFailures();
+        test->run();
+        printf("%s %s\n", ttp229TestFailures() == before ? "ok  " : "FAIL", test->name);
+        tests++;
+    }
+    printf("%d tests, %d failed checks\n", tests, ttp229TestFailures());
+    return ttp229TestFailures() == 0 ? 0 : 1;
+}
+
+#endif // TTP229_TEST_H
@@ -1,4 +1,55 @@
 #include "TTP229.h"
+#include "TTP229Group.h"
+
+#if TTP229_SPI_SUPPORT
+#include <SPI.h>
+#endif
+
+// Wake-on-touch sleep
+#if TTP229_SLEEP_SUPPORT && !defined(TTP229_HOST_SIM)
+  #if defined(ESP32)
+    #include <esp_sleep.h>
+    #include <driver/gpio.h>
+    #include <driver/rtc_io.h>
+  #elif defined(ARDUINO_ARCH_AVR)
+    #include <avr/sleep.h>
+  #elif defined(ARDUINO_ARCH_RP2040)
+    #include <hardware/sync.h>
+    #if __has_include(<pico/sleep.h>)
+      #include <pico/sleep.h>         // pico-extras: dormant mode
+      #include <hardware/clocks.h>
+      #define TTP229_DORMANT_SUPPORT 1
+    #endif
+  #endif
+#endif
+
+// Debug output by TTP229_LOG_LEVEL. Levels left out compile to nothing -
+// no string, no _debug test. Strings stay in flash on AVR.
+#if TTP229_LOG_LEVEL >= 1
+  #define TTP229_ERROR(text) do { if (_debug) Serial.println(F("ERROR: " text)); } while (0)
+#else
+  #define TTP229_ERROR(text) do {} while (0)
+#endif
+#if TTP229_LOG_LEVEL >= 2
+  #define TTP229_WARNING(text) do { if (_debug) Serial.println(F("WARNING: " text)); } while (0)
+#else
+  #define TTP229_WARNING(text) do {} while (0)
+#endif
+#if TTP229_LOG_LEVEL >= 3
+  #define TTP229_INFO(text) do { if (_debug) Serial.println(F(text)); } while (0)
+#else
+  #define TTP229_INFO(text) do {} while (0)
+#endif
+
+// Scan path: queue a binary record for printLog() instead of printing
+#if TTP229_LOG_LEVEL > 0
+  #define TTP229_LOG(level, code, key, value) \
+      do { if (TTP229_LOG_LEVEL >= (level) && _debug) logRecord(code, key, value); } while (0)
+#else
+  #define TTP229_LOG(level, code, key, value) do {} while (0)
+#endif
+
+TTP229* TTP229::_isrInstances[TTP229::MAX_INTERRUPT_INSTANCES] = { NULL };
 
 // ==============================================
 // CONSTRUCTORS
@@ -15,6 +66,10 @@ TTP229::TTP229() {
     detectBoard();
     setBoardDefaults();
     initializeState();
+    
+    #if TTP229_RTOS_SUPPORT
+    initializeRTOSState(1, 4096);
+    #endif
 }
 
 // Constructor 2: Auto-detect board with specified mode
@@ -33,6 +88,10 @@ TTP229::TTP229(uint8_t sclPin, uint8_t sdoPin, bool is16KeyMode) {
     detectBoard();
     setBoardDefaults();
     initializeState();
+    
+    #if TTP229_RTOS_SUPPORT
+    initializeRTOSState(1, 4096);
+    #endif
 }
 
 // Constructor 4: RTOS-specific constructor
@@ -49,41 +108,22 @@ TTP229::TTP229(uint8_t sclPin, uint8_t sdoPin, bool is16KeyMode,
     detectBoard();
     setBoardDefaults();
     initializeState();  // This must come BEFORE RTOS setup
-    
-    #if defined(ESP32)
-    _taskHandle = NULL;
-    _eventQueue = NULL;
-    _mutex = NULL;
-    _readSemaphore = NULL;
-    _statsMutex = portMUX_INITIALIZER_UNLOCKED;
-    #endif
-    
-    _rtosEnabled = false;
-    _taskRunning = false;
-    _taskPriority = taskPriority;
-    _taskStackDepth = stackDepth;
-    _queueSize = 10;
-    _eventQueueEnabled = true;
-    _holdThreshold = DEFAULT_HOLD_THRESHOLD_MS;	
-    _lastHoldKey = 0;
-    _holdStartTime = 0;
-	_holdEventSent = false;        // NEW
-    _longPressEventSent = false;   // NEW
-    _lastKeyFromISR = 0;
-    
-    memset(&_stats, 0, sizeof(_stats));
-    _lastStatsReset = millis();
+    initializeRTOSState(taskPriority, stackDepth);
 }
 #endif
 
 // Destructor
 TTP229::~TTP229() {
+    enableInterruptMode(false);
+    
     #if TTP229_RTOS_SUPPORT
     // Signal task to stop if running
     if (_rtosEnabled && _taskRunning) {
-        #if defined(ESP32)
+        #if TTP229_FREERTOS
         if (_taskHandle != NULL) {
             _taskRunning = false;
+            xTaskNotifyGive(_taskHandle);  // Wake it if parked in interrupt mode
+            
             // Give task time to exit gracefully
             vTaskDelay(pdMS_TO_TICKS(50));
             
@@ -123,21 +163,125 @@ void TTP229::initializeState() {
     _currentKey = 0;
     _lastKey = 0;
     _lastValidKey = 0;
-    _lastDebounceTime = 0;
     _lastReadTime = 0;
+    _lastActiveTime = 0;
+    
+    // Initialize key bitmask state
+    _currentMask = 0;
+    _keyMask = 0;
+    _lastKeyMask = 0;
+    memset(_states, 0, sizeof(_states));
+    _stateSequence = 0;
+    for (uint8_t i = 0; i < TTP229_STATE_HISTORY; i++) _maskHistory[i] = 0;
+    
+    _scanSequence = 0;
+    #if TTP229_TRACE_DEPTH > 0
+    _traceTotal = 0;
+    _traceLastSequence = 0;
+    _traceEnabled = true;
+    #endif
+    #if TTP229_LOG_LEVEL > 0
+    _log.reset(TTP229_LOG_DEPTH);
+    _logDropped = 0;
+    _logDroppedShown = 0;
+    #endif
+    #if defined(TTP229_EVENT_TIMING)
+    memset(_frameMicros, 0, sizeof(_frameMicros));
+    _acceptSequence = 0;
+    _pressLag = 0;
+    _releaseLag = 0;
+    #endif
     
     // Initialize debounce state
-    _lastRawKey = 0;
-    _stableKey = 0;
-    _lastChangeTime = 0;
+    _debouncer.reset();
+    _debounceInScans = false;
+    applyDebounceTime();
+    
+    _eventMachine.reset();
+    _eventMachine.holdMs = DEFAULT_HOLD_THRESHOLD_MS;
+    _eventMachine.longPressMs = DEFAULT_LONG_PRESS_THRESHOLD_MS;
+    _eventMachine.repeatDelayMs = 0;
+    _eventMachine.repeatMs = 0;
+    _eventMachine.repeatFastestMs = 0;
+    _eventMachine.repeatKeys = 0xFFFF;
+    _serviceMode = false;
+    
+    _queueSize = 10;
+    _eventQueueEnabled = true;
+    _overflowPolicy = OVERFLOW_DROP_NEWEST;
+    _coalescedMask = 0;
+    _queueOverflows = 0;
+    _events.reset(_queueSize);
+    
+    #if !defined(TTP229_NO_GESTURES)
+    _gestures.reset();
+    _gestures.enabled = 0;
+    _gestures.tapMs = DEFAULT_TAP_MS;
+    _gestures.multiTapMs = DEFAULT_MULTI_TAP_MS;
+    _gestures.swipeStepMs = DEFAULT_SWIPE_STEP_MS;
+    _gestures.chordMs = DEFAULT_CHORD_MS;
+    _gestures.swipeKeys = DEFAULT_SWIPE_KEYS;
+    #endif
+    
+    #if !defined(TTP229_NO_KEY_HANDLERS)
+    memset(_handlers, 0, sizeof(_handlers));
+    #if !defined(TTP229_NO_GESTURES)
+    memset(_gestureHandlers, 0, sizeof(_gestureHandlers));
+    #endif
+    _dispatchMode = DISPATCH_DEFERRED;
+    #endif
+    
+    _backend = BACKEND_BITBANG;
+    _replay = NULL;
+    
+    _interruptMode = false;
+    _isrSlot = -1;
+    _dataReady = false;
+    _scanning = false;
+    
+    _wokeByTouch = false;
+    _wakeCount = 0;
+    _wakeLatency = 0;
     
     #if TTP229_RTOS_SUPPORT
     _lastKeyFromISR = 0;
-	_holdEventSent = false;        // NEW
-    _longPressEventSent = false;   // NEW
     #endif
 }
 
+#if TTP229_RTOS_SUPPORT
+void TTP229::initializeRTOSState(uint8_t taskPriority, uint32_t stackDepth) {
+    // Every constructor must leave the RTOS handles in a known state,
+    // otherwise takeMutex()/endRTOS() act on garbage pointers
+    #if TTP229_FREERTOS
+    _taskHandle = NULL;
+    _logTaskHandle = NULL;
+    _dispatchTask = NULL;
+    _mutex = NULL;
+    _statsMutex = portMUX_INITIALIZER_UNLOCKED;
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        _subscribers[i].task = NULL;
+    }
+    #endif
+    #if TTP229_STATIC_RTOS
+    _rtosStorage = NULL;
+    #endif
+    
+    _rtosEnabled = false;
+    _taskRunning = false;
+    _taskPriority = taskPriority;
+    _taskStackDepth = stackDepth;
+    _lastKeyFromISR = 0;
+    
+    memset(&_stats, 0, sizeof(_stats));
+    _lastStatsReset = millis();
+    _lastStatUpdate = 0;
+    _statsReadCount = 0;
+    
+    _group = NULL;
+    _groupId = 0;
+}
+#endif
+
 void TTP229::detectBoard() {
     // Board detection with automatic pin assignment
     #if defined(ESP32)
@@ -191,11 +335,16 @@ void TTP229::setBoardDefaults() {
         _scanInterval = 20;   // 20 milliseconds
     #else
         // AVR boards (Uno, Nano, Mega) are slower
-        _clkDelay = 100;    // 100 microseconds
-        _readDelay = 5;     // 5 milliseconds
+        _clkDelay = 10;     // 10 microseconds (well under the 512kHz SCL limit)
+        _readDelay = 5;     // 5 microseconds
         _debounceDelay = 50;  // 50 milliseconds
         _scanInterval = 50;   // 50 milliseconds
     #endif
+    
+    // Fixed rate until setScanPolicy()
+    _idleScanInterval = _scanInterval;
+    _activeScanInterval = _scanInterval;
+    _quietPeriod = 0;
 }
 
 bool TTP229::isValidPin(uint8_t pin) {
@@ -236,15 +385,21 @@ bool TTP229::begin() {
 }
 
 bool TTP229::begin(bool debugMode) {
+    return begin(BACKEND_BITBANG, debugMode);
+}
+
+bool TTP229::begin(ReadBackend backend, bool debugMode) {
     _debug = debugMode;
     
     // Validate pins
     if (!isValidPin(_sclPin) || !isValidPin(_sdoPin)) {
+        #if TTP229_LOG_LEVEL >= 1
         if (_debug) {
             Serial.begin(115200);
             delay(100);
-            Serial.println("ERROR: Invalid pin configuration");
+            Serial.println(F("ERROR: Invalid pin configuration"));
         }
+        #endif
         return false;
     }
     
@@ -264,15 +419,65 @@ bool TTP229::begin(bool debugMode) {
     digitalWrite(_sclPin, HIGH);
     delay(10);  // Let module stabilize
     
+    // Resolve pins to port registers for the scan loop
+    _gpio.attach(_sclPin, _sdoPin);
+    
+    // Hand the pins to the SPI peripheral if requested and possible
+    if (_backend == BACKEND_SPI && backend != BACKEND_SPI) {
+        endSPI();
+    }
+    _backend = BACKEND_BITBANG;
+    _replay = NULL;
+    if (backend == BACKEND_SPI) {
+        if (beginSPI()) {
+            _backend = BACKEND_SPI;
+        } else {
+            #if TTP229_LOG_LEVEL >= 2
+            if (_debug) Serial.begin(115200);
+            #endif
+            TTP229_WARNING("SPI not available on these pins, using bit-bang");
+        }
+    }
+    
     _initialized = true;
     
+    #if TTP229_SLEEP_SUPPORT && defined(ESP32) && !defined(TTP229_HOST_SIM)
+    // Restarted from deep sleep by the keypad: keep the touch as the first
+    // event (latency counts from reset)
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause == ESP_SLEEP_WAKEUP_EXT0 || cause == ESP_SLEEP_WAKEUP_GPIO) {
+        _wokeByTouch = (wakeScan(0) != 0);
+    }
+    #endif
+    
     // Debug output if enabled
+    #if TTP229_LOG_LEVEL > 0
     if (_debug) {
         Serial.begin(115200);
         delay(100);  // Wait for serial
         printDebugInfo();
     }
+    #endif
+    
+    return true;
+}
+
+bool TTP229::begin(TTP229ReplaySource& source, bool debugMode) {
+    // Frames come from the source - the pins are left alone
+    _debug = debugMode;
+    if (_backend == BACKEND_SPI) {
+        endSPI();
+    }
+    _replay = &source;
+    _backend = BACKEND_REPLAY;
+    _initialized = true;
     
+    #if TTP229_LOG_LEVEL > 0
+    if (_debug) {
+        Serial.begin(115200);
+        printDebugInfo();
+    }
+    #endif
     return true;
 }
 
@@ -283,89 +488,131 @@ bool TTP229::begin(bool debugMode) {
 #if TTP229_RTOS_SUPPORT
 
 bool TTP229::beginRTOS(bool createTask) {
-    #if defined(ESP32)
+    #if TTP229_STATIC_RTOS
+    _rtosStorage = NULL;
+    #endif
+    return startRTOS(createTask);
+}
+
+#if TTP229_STATIC_RTOS
+bool TTP229::beginRTOS(RTOSStorage& storage, bool createTask) {
+    if (createTask && (storage.stack == NULL || storage.stackDepth == 0)) {
+        TTP229_ERROR("RTOSStorage has no stack");
+        return false;
+    }
+    _rtosStorage = &storage;
+    return startRTOS(createTask);
+}
+#endif
+
+bool TTP229::startRTOS(bool createTask) {
+    #if TTP229_FREERTOS
     // Create mutex for thread safety
+    #if TTP229_STATIC_RTOS
+    _mutex = _rtosStorage != NULL ? xSemaphoreCreateMutexStatic(&_rtosStorage->mutex)
+                                  : xSemaphoreCreateMutex();
+    #else
     _mutex = xSemaphoreCreateMutex();
+    #endif
     if (_mutex == NULL) {
-        if (_debug) Serial.println("ERROR: Failed to create mutex");
-        return false;
-    }
-    
-    // Create binary semaphore for blocking reads
-    _readSemaphore = xSemaphoreCreateBinary();
-    if (_readSemaphore == NULL) {
-        if (_debug) Serial.println("ERROR: Failed to create semaphore");
-        vSemaphoreDelete(_mutex);
-        _mutex = NULL;
+        TTP229_ERROR("Failed to create mutex");
         return false;
     }
     
-    // Create event queue if enabled
-    if (_eventQueueEnabled) {
-        _eventQueue = xQueueCreate(_queueSize, sizeof(KeyEvent));
-        if (_eventQueue == NULL) {
-            if (_debug) Serial.println("ERROR: Failed to create event queue");
-            vSemaphoreDelete(_mutex);
-            vSemaphoreDelete(_readSemaphore);
-            _mutex = NULL;
-            _readSemaphore = NULL;
-            return false;
-        }
-    }
+    // Event ring lives in the object - just size and empty it
+    _events.reset(_queueSize);
+    _coalescedMask = 0;
     
     _rtosEnabled = true;
     _taskRunning = true;
     
     // Create RTOS task if requested
     if (createTask) {
-        BaseType_t result = xTaskCreate(
-            rtosTask,           // Task function
-            "TTP229_Task",      // Task name (max 16 chars)
-            _taskStackDepth,    // Stack size in words
-            this,               // Parameter passed to task
-            _taskPriority,      // Priority (0-24, higher = more priority)
-            &_taskHandle        // Task handle
-        );
+        BaseType_t result;
+        #if TTP229_STATIC_RTOS
+        if (_rtosStorage != NULL) {
+            _taskStackDepth = _rtosStorage->stackDepth;
+            _taskHandle = xTaskCreateStatic(
+                rtosTask,
+                "TTP229_Task",
+                _rtosStorage->stackDepth,
+                this,
+                _taskPriority,
+                _rtosStorage->stack,
+                &_rtosStorage->task
+            );
+            result = (_taskHandle != NULL) ? pdPASS : pdFAIL;
+        } else
+        #endif
+        {
+            result = xTaskCreate(
+                rtosTask,           // Task function
+                "TTP229_Task",      // Task name (max 16 chars)
+                _taskStackDepth,    // Stack size (bytes on ESP32)
+                this,               // Parameter passed to task
+                _taskPriority,      // Priority (0-24, higher = more priority)
+                &_taskHandle        // Task handle
+            );
+        }
         
         if (result != pdPASS) {
-            if (_debug) Serial.println("ERROR: Failed to create RTOS task");
+            TTP229_ERROR("Failed to create RTOS task");
             endRTOS();
             return false;
-        } else if (_debug) {
-            Serial.println("RTOS task created successfully");
         }
+        TTP229_INFO("RTOS task created successfully");
+        
+        #if TTP229_LOG_LEVEL > 0
+        // Scan-path messages are printed by a task below the scan task.
+        // Not with RTOSStorage (no heap) - call printLog() from loop().
+        bool heapTasks = true;
+        #if TTP229_STATIC_RTOS
+        heapTasks = (_rtosStorage == NULL);
+        #endif
+        if (_debug && heapTasks) {
+            xTaskCreate(logTask, "TTP229_Log", TTP229_LOG_TASK_STACK, this, 1, &_logTaskHandle);
+        }
+        #endif
     }
     
+    #if TTP229_LOG_LEVEL >= 3
     if (_debug) {
-        Serial.println("RTOS mode initialized");
-        Serial.print("  Queue size: ");
+        Serial.println(F("RTOS mode initialized"));
+        Serial.print(F("  Queue size: "));
         Serial.println(_queueSize);
-        Serial.print("  Task priority: ");
+        Serial.print(F("  Task priority: "));
         Serial.println(_taskPriority);
-        Serial.print("  Stack depth: ");
+        Serial.print(F("  Stack depth: "));
         Serial.println(_taskStackDepth);
-        Serial.print("  Event queue: ");
-        Serial.println(_eventQueueEnabled ? "Enabled" : "Disabled");
+        Serial.print(F("  Event queue: "));
+        Serial.println(_eventQueueEnabled ? F("Enabled") : F("Disabled"));
     }
+    #endif
     
     return true;
     
     #else
-    // For other RTOS platforms, mark as enabled but don't create tasks
+    // No scan task on other RTOS platforms: read() or service() drive
+    // scanning and the event queue
+    (void)createTask;
+    _events.reset(_queueSize);
+    _coalescedMask = 0;
     _rtosEnabled = true;
     _taskRunning = true;
-    if (_debug) Serial.println("RTOS enabled (limited support on this platform)");
+    TTP229_INFO("RTOS enabled (events driven by read()/service())");
     return true;
     #endif
 }
 
 void TTP229::endRTOS() {
-    #if defined(ESP32)
+    #if TTP229_FREERTOS
     // Signal task to stop
     _taskRunning = false;
     
     // Wait for task to exit if it's still running
     if (_taskHandle != NULL) {
+        xTaskNotifyGive(_taskHandle);  // Wake it if parked in interrupt mode
+        
         // Give task time to exit gracefully
         vTaskDelay(pdMS_TO_TICKS(50));
         
@@ -376,27 +623,32 @@ void TTP229::endRTOS() {
         _taskHandle = NULL;
     }
     
-    if (_eventQueue != NULL) {
-        vQueueDelete(_eventQueue);
-        _eventQueue = NULL;
+    #if TTP229_LOG_LEVEL > 0
+    if (_logTaskHandle != NULL) {
+        xTaskNotifyGive(_logTaskHandle);  // Prints what is left, then exits
+        vTaskDelay(pdMS_TO_TICKS(50));
+        if (eTaskGetState(_logTaskHandle) != eDeleted) {
+            vTaskDelete(_logTaskHandle);
+        }
+        _logTaskHandle = NULL;
     }
+    #endif
     
+    // Release tasks blocked in waitForEvent() - they return false
+    _rtosEnabled = false;
+    releaseSubscribers();
     if (_mutex != NULL) {
         vSemaphoreDelete(_mutex);
         _mutex = NULL;
     }
-    
-    if (_readSemaphore != NULL) {
-        vSemaphoreDelete(_readSemaphore);
-        _readSemaphore = NULL;
-    }
+    #endif
+    #if TTP229_STATIC_RTOS
+    _rtosStorage = NULL;  // The caller may reuse the storage now
     #endif
     
     _rtosEnabled = false;
     
-    if (_debug) {
-        Serial.println("RTOS resources cleaned up");
-    }
+    TTP229_INFO("RTOS resources cleaned up");
 }
 
 void TTP229::stopRTOS() {
@@ -404,7 +656,7 @@ void TTP229::stopRTOS() {
         _taskRunning = false;
         
         // Wait a moment for task to exit
-        #if defined(ESP32)
+        #if TTP229_FREERTOS
         vTaskDelay(pdMS_TO_TICKS(100));
         #endif
         
@@ -420,38 +672,60 @@ void TTP229::stopRTOS() {
 
 uint8_t TTP229::read() {
     #if TTP229_RTOS_SUPPORT
-    if (_rtosEnabled) {
-        #if defined(ESP32)
-        // Thread-safe access using mutex
-        if (takeMutex(10)) {  // 10ms timeout
-            uint8_t key = _lastValidKey;
-            giveMutex();
-            return key;
-        }
-        return KEY_NONE;
-        #else
+    #if TTP229_FREERTOS
+    if (_rtosEnabled && _taskHandle != NULL) {
+        // Latest published state - never waits for the scan task
+        return getKeyState().key;
+    }
+    #endif
+    
+    // Scanned by a TTP229Group task - just report the latest state
+    if (_group != NULL) {
+        return _lastValidKey;
+    }
+    #endif
+    
+    // Scanned by service() (timer ISR) - just report the latest state
+    if (_serviceMode) {
         return _lastValidKey;
-        #endif
     }
+    
+    #if TTP229_LOG_LEVEL > 0
+    // read() is the scan path here, so it is also the log ring's only
+    // consumer: print what the last scans queued, outside scan and mutex.
+    // With a scan task, group or timer, several callers could race for
+    // the ring - the log task or an explicit printLog() owns it then.
+    if (_debug) printLog();
     #endif
     
-    // Non-RTOS reading logic
+    // Polled reading logic (also RTOS mode without a scan task)
     unsigned long now = millis();
     
     // Only read at the specified interval
-    if (timeElapsed(_lastReadTime, _scanInterval)) {
+    bool scanDue = timeElapsed(_lastReadTime, _scanInterval);
+    
+    // In interrupt mode, scan immediately on data-valid and not at all
+    // while idle (nothing touched, nothing left to debounce)
+    if (_interruptMode) {
+        if (_dataReady) {
+            scanDue = true;
+        } else if (isIdle()) {
+            scanDue = false;
+        }
+    }
+    
+    if (scanDue) {
         _lastReadTime = now;
         
         // Save previous state for edge detection
         _lastKey = _lastValidKey;
+        _lastKeyMask = _keyMask;
         
-        // Read the keypad
-        _currentKey = readDebounced();
-        
-        // Update valid key if debounce period has passed
-        if (timeElapsed(_lastDebounceTime, _debounceDelay)) {
-            _lastValidKey = _currentKey;
-        }
+        // Read, debounce and generate events
+        processFrame(readRawMask());
+    } else {
+        // Hold, repeat and gesture deadlines between scans
+        processKeyEvents();
     }
     
     // Allow other tasks to run (important for cooperative multitasking)
@@ -462,6 +736,25 @@ uint8_t TTP229::read() {
     return _lastValidKey;
 }
 
+void TTP229::service() {
+    if (!_initialized || _scanning) return;
+    
+    #if TTP229_FREERTOS
+    if (_rtosEnabled && _taskHandle != NULL) return;  // The task scans
+    #endif
+    
+    // From now on read() only reports what service() found
+    _serviceMode = true;
+    
+    // At the idle rate of a scan policy, skip ticks until the interval is up
+    if (_scanInterval != _activeScanInterval && !timeElapsed(_lastReadTime, _scanInterval)) {
+        processKeyEvents();  // Only if a hold, repeat or gesture timer expired
+        return;
+    }
+    _lastReadTime = millis();
+    processFrame(readRawMask());
+}
+
 uint8_t TTP229::getKey() {
     return _lastValidKey;
 }
@@ -517,7 +810,8 @@ bool TTP229::isPressed() {
 }
 
 bool TTP229::isKeyPressed(uint8_t keyNum) {
-    return (_lastValidKey == keyNum);
+    // Tested against the full mask so chords report every touched key
+    return (getKeyState().mask & keyToMask(keyNum)) != 0;
 }
 
 bool TTP229::wasPressed() {
@@ -530,6 +824,127 @@ bool TTP229::wasReleased() {
     return (_lastValidKey == KEY_NONE && _lastKey != KEY_NONE);
 }
 
+// ==============================================
+// MULTI-TOUCH (BITMASK) METHODS
+// ==============================================
+
+uint16_t TTP229::getKeyMask() {
+    // From the snapshot: a 16-bit load can tear on 8-bit AVR
+    return getKeyState().mask;
+}
+
+uint16_t TTP229::getPressedMask() {
+    return _keyMask & ~_lastKeyMask;
+}
+
+uint16_t TTP229::getReleasedMask() {
+    return _lastKeyMask & ~_keyMask;
+}
+
+TTP229::KeyState TTP229::getKeyState() {
+    // The slot being written is never the one read. A copy is only
+    // retried if the scan path published twice during it, so an ISR that
+    // interrupts the writer always succeeds at once.
+    KeyState state;
+    for (;;) {
+        uint16_t sequence = ttp229AtomicLoad(_stateSequence);
+        state = _states[(sequence >> 1) & 1];
+        ttp229AcquireFence();
+        if ((uint16_t)(ttp229AtomicLoad(_stateSequence) - (sequence & ~1)) < 3) return state;
+    }
+}
+
+void TTP229::publishState(uint16_t previousMask, uint32_t now) {
+    // Only the scan path writes: fill the spare slot, then flip
+    uint16_t sequence = _stateSequence;
+    ttp229AtomicStore(_stateSequence, (uint16_t)(sequence + 1));  // Odd: writing
+    ttp229ReleaseFence();  // Slot writes stay after the odd store
+    KeyState& state = _states[((sequence >> 1) + 1) & 1];
+    state.mask = _keyMask;
+    state.pressed = _keyMask & ~previousMask;
+    state.released = previousMask & ~_keyMask;
+    state.key = _lastValidKey;
+    state.scanSequence = _scanSequence;
+    state.timestamp = now;
+    _maskHistory[((sequence >> 1) + 1) & (TTP229_STATE_HISTORY - 1)] = _keyMask;
+    ttp229AtomicStore(_stateSequence, (uint16_t)(sequence + 2));
+}
+
+// ==============================================
+// READER CURSORS
+// ==============================================
+
+TTP229::Reader TTP229::reader() {
+    return Reader(this);
+}
+
+TTP229::Reader::Reader(TTP229* keypad)
+    : _keypad(keypad), _change(0), _mask(0), _pressed(0), _released(0), _missed(0) {
+    // Start at the latest change without reporting it as an edge
+    for (;;) {
+        uint16_t sequence = ttp229AtomicLoad(keypad->_stateSequence);
+        _change = sequence >> 1;
+        _mask = keypad->_maskHistory[_change & (TTP229_STATE_HISTORY - 1)];
+        ttp229AcquireFence();
+        // Valid unless the writer came round to this slot meanwhile
+        if ((((ttp229AtomicLoad(keypad->_stateSequence) >> 1) - _change) & 0x7FFF) < TTP229_STATE_HISTORY - 1) {
+            return;
+        }
+    }
+}
+
+uint8_t TTP229::Reader::update() {
+    _pressed = 0;
+    _released = 0;
+    if (_keypad == NULL) return KEY_NONE;
+    
+    for (;;) {
+        // Change numbers are the upper 15 bits of the publish sequence
+        uint16_t latest = ttp229AtomicLoad(_keypad->_stateSequence) >> 1;
+        uint16_t behind = (latest - _change) & 0x7FFF;
+        if (behind == 0) break;
+        
+        // Too far behind: jump to the latest change, edges from the masks
+        uint16_t first = _change + 1;
+        if (behind >= TTP229_STATE_HISTORY) {
+            first = latest;
+            behind = 1;
+            _missed++;
+        }
+        
+        uint16_t mask = _mask;
+        uint16_t pressed = 0;
+        uint16_t released = 0;
+        for (uint16_t i = 0; i < behind; i++) {
+            uint16_t next = _keypad->_maskHistory[(first + i) & (TTP229_STATE_HISTORY - 1)];
+            pressed |= next & ~mask;
+            released |= mask & ~next;
+            mask = next;
+        }
+        ttp229AcquireFence();
+        
+        // The writer fills slot (published + 1); retry if it reached ours
+        uint16_t published = ttp229AtomicLoad(_keypad->_stateSequence) >> 1;
+        if (((published - first) & 0x7FFF) >= TTP229_STATE_HISTORY - 1) continue;
+        
+        _pressed |= pressed;
+        _released |= released;
+        _mask = mask;
+        _change = latest;
+        break;
+    }
+    return maskToKey(_mask);
+}
+
+uint16_t TTP229::keyToMask(uint8_t key) {
+    return ttp229KeyToMask(key);
+}
+
+uint8_t TTP229::maskToKey(uint16_t mask) {
+    // Highest touched key wins, matching the legacy single-key readRaw()
+    return ttp229MaskToKey(mask);
+}
+
 // ==============================================
 // CONFIGURATION METHODS
 // ==============================================
@@ -542,26 +957,70 @@ bool TTP229::setMode(bool is16KeyMode) {
 bool TTP229::setDebounce(uint16_t ms) {
     // Validate reasonable debounce range (1-500ms)
     if (ms < 1 || ms > 500) {
-        if (_debug) Serial.println("ERROR: Invalid debounce value (1-500ms)");
+        TTP229_ERROR("Invalid debounce value (1-500ms)");
         return false;
     }
     _debounceDelay = ms;
+    _debounceInScans = false;
+    applyDebounceTime();
+    return true;
+}
+
+bool TTP229::setDebounce(uint8_t pressScans, uint8_t releaseScans) {
+    if (pressScans < 1 || pressScans > TTP229Debouncer::MAX_SCANS ||
+        releaseScans < 1 || releaseScans > TTP229Debouncer::MAX_SCANS) {
+        TTP229_ERROR("Invalid debounce scans (1-7)");
+        return false;
+    }
+    _debouncer.setThresholds(pressScans, releaseScans);
+    _debounceInScans = true;
     return true;
 }
 
+void TTP229::applyDebounceTime() {
+    if (_debounceInScans) return;
+    
+    // A level must be seen on enough scans to span the debounce time
+    // Debouncing happens while touched, i.e. at the active scan rate
+    uint16_t interval = _activeScanInterval;
+    uint16_t scans = (_debounceDelay + interval - 1) / interval + 1;
+    if (scans > TTP229Debouncer::MAX_SCANS) {
+        TTP229_WARNING("Debounce capped at 7 scans - lower the scan interval");
+        scans = TTP229Debouncer::MAX_SCANS;
+    }
+    _debouncer.setThresholds((uint8_t)scans, (uint8_t)scans);
+}
+
 bool TTP229::setScanInterval(uint16_t ms) {
     // Validate reasonable scan interval (1-1000ms)
     if (ms < 1 || ms > 1000) {
-        if (_debug) Serial.println("ERROR: Invalid scan interval (1-1000ms)");
+        TTP229_ERROR("Invalid scan interval (1-1000ms)");
         return false;
     }
     _scanInterval = ms;
+    _idleScanInterval = ms;
+    _activeScanInterval = ms;
+    _quietPeriod = 0;
+    applyDebounceTime();
+    return true;
+}
+
+bool TTP229::setScanPolicy(uint16_t idleMs, uint16_t activeMs, uint16_t quietMs) {
+    if (activeMs < 1 || idleMs > 1000 || activeMs > idleMs) {
+        TTP229_ERROR("Invalid scan policy (1 <= active <= idle <= 1000ms)");
+        return false;
+    }
+    _idleScanInterval = idleMs;
+    _activeScanInterval = activeMs;
+    _quietPeriod = quietMs;
+    _scanInterval = idleMs;
+    applyDebounceTime();
     return true;
 }
 
 bool TTP229::setTiming(uint16_t clkDelay, uint16_t readDelay) {
     if (!validateTiming(clkDelay, readDelay)) {
-        if (_debug) Serial.println("ERROR: Invalid timing values");
+        TTP229_ERROR("Invalid timing values");
         return false;
     }
     _clkDelay = clkDelay;
@@ -571,175 +1030,1282 @@ bool TTP229::setTiming(uint16_t clkDelay, uint16_t readDelay) {
 
 bool TTP229::setHoldThreshold(uint16_t holdMs, uint16_t longPressMs) {
     if (holdMs >= longPressMs) {
-        if (_debug) Serial.println("ERROR: Hold threshold must be less than long press threshold");
+        TTP229_ERROR("Hold threshold must be less than long press threshold");
         return false;
     }
     
     if (holdMs < 100 || longPressMs > 10000) {
-        if (_debug) Serial.println("ERROR: Invalid threshold values");
+        TTP229_ERROR("Invalid threshold values");
         return false;
     }
     
     #if TTP229_RTOS_SUPPORT
     if (takeMutex(10)) {
-        _holdThreshold = holdMs;
+        _eventMachine.holdMs = holdMs;
+        _eventMachine.longPressMs = longPressMs;
         giveMutex();
     }
     #else
-    _holdThreshold = holdMs;
+    _eventMachine.holdMs = holdMs;
+    _eventMachine.longPressMs = longPressMs;
+    #endif
+    
+    return true;
+}
+
+bool TTP229::setAutoRepeat(uint16_t delayMs, uint16_t intervalMs, uint16_t fastestMs, uint16_t keyMask) {
+    if (fastestMs == 0) fastestMs = intervalMs;
+    if (delayMs != 0 && (intervalMs < 10 || intervalMs > 10000 || fastestMs < 10 ||
+                         fastestMs > intervalMs || delayMs > 10000)) {
+        TTP229_ERROR("Invalid auto-repeat timing");
+        return false;
+    }
+    
+    // Keys already held keep their current repeat schedule
+    #if TTP229_RTOS_SUPPORT
+    if (!takeMutex(10)) return false;
+    #endif
+    _eventMachine.repeatDelayMs = delayMs;
+    _eventMachine.repeatMs = intervalMs;
+    _eventMachine.repeatFastestMs = fastestMs;
+    _eventMachine.repeatKeys = keyMask;
+    #if TTP229_RTOS_SUPPORT
+    giveMutex();
     #endif
     
     return true;
 }
 
 // ==============================================
-// INFORMATION METHODS
+// INTERRUPT MODE
 // ==============================================
 
-const char* TTP229::getBoardName() {
-    return _boardName;
+bool TTP229::enableInterruptMode(bool enable) {
+    if (!enable) {
+        if (_isrSlot >= 0) {
+            detachInterrupt(digitalPinToInterrupt(_sdoPin));
+            _isrInstances[_isrSlot] = NULL;
+            _isrSlot = -1;
+        }
+        _interruptMode = false;
+        return true;
+    }
+    
+    if (_isrSlot >= 0) return true;  // Already enabled
+    
+    if (!_initialized) {
+        TTP229_ERROR("Call begin() before enableInterruptMode()");
+        return false;
+    }
+    
+    int irq = digitalPinToInterrupt(_sdoPin);
+    if (irq == NOT_AN_INTERRUPT) {
+        TTP229_ERROR("SDO pin is not interrupt-capable");
+        return false;
+    }
+    
+    // Find a free trampoline slot
+    static void (* const handlers[MAX_INTERRUPT_INSTANCES])() = {
+        isrSlot0, isrSlot1, isrSlot2, isrSlot3
+    };
+    for (uint8_t i = 0; i < MAX_INTERRUPT_INSTANCES; i++) {
+        if (_isrInstances[i] == NULL) {
+            _isrInstances[i] = this;
+            _isrSlot = i;
+            _dataReady = true;  // Take one scan to pick up the current state
+            _interruptMode = true;
+            attachInterrupt(irq, handlers[i], FALLING);
+            return true;
+        }
+    }
+    
+    TTP229_ERROR("Too many keypads in interrupt mode");
+    return false;
 }
 
-uint8_t TTP229::getSCLPin() {
-    return _sclPin;
+bool TTP229::isInterruptMode() {
+    return _interruptMode;
 }
 
-uint8_t TTP229::getSDOPin() {
-    return _sdoPin;
+bool TTP229::isIdle() {
+    // Nothing touched and no frame waiting for debounce
+    return _keyMask == 0 && _currentMask == 0 && !_debouncer.pending();
 }
 
-bool TTP229::is16KeyMode() {
-    return _is16KeyMode;
+void TTP229_ISR_ATTR TTP229::handleDataValid() {
+    if (_scanning) return;
+    _dataReady = true;
+    
+    #if TTP229_FREERTOS
+    if (_taskHandle != NULL) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(_taskHandle, &xHigherPriorityTaskWoken);
+        if (xHigherPriorityTaskWoken) {
+            portYIELD_FROM_ISR();
+        }
+    }
+    #endif
 }
 
-bool TTP229::isInitialized() {
-    return _initialized;
-}
+void TTP229_ISR_ATTR TTP229::isrSlot0() { if (_isrInstances[0]) _isrInstances[0]->handleDataValid(); }
+void TTP229_ISR_ATTR TTP229::isrSlot1() { if (_isrInstances[1]) _isrInstances[1]->handleDataValid(); }
+void TTP229_ISR_ATTR TTP229::isrSlot2() { if (_isrInstances[2]) _isrInstances[2]->handleDataValid(); }
+void TTP229_ISR_ATTR TTP229::isrSlot3() { if (_isrInstances[3]) _isrInstances[3]->handleDataValid(); }
 
 // ==============================================
-// DEBUG METHODS
+// LOW POWER (WAKE ON TOUCH)
 // ==============================================
+// The chip pulls SDO low for ~93us (data valid) when it detects a touch,
+// so SDO doubles as the wake-up line. The frame read right after waking
+// is taken as debounced: the chip has already filtered the touch, and a
+// tap shorter than the debounce time would be gone by the next scan.
+
+#if TTP229_SLEEP_SUPPORT && !defined(TTP229_HOST_SIM) && !defined(ESP32)
+static volatile bool ttp229WakeFlag = false;
+static void TTP229_ISR_ATTR ttp229WakeISR() { ttp229WakeFlag = true; }
+#endif
 
-void TTP229::printDebugInfo() {
+bool TTP229::sleepUntilTouch(SleepMode mode) {
+    if (!_initialized) {
+        TTP229_ERROR("Call begin() before sleepUntilTouch()");
+        return false;
+    }
+    
+    #if TTP229_SLEEP_SUPPORT
+    // A held key keeps the chip busy - sleeping now would wake at once
+    if (!isIdle()) {
+        TTP229_ERROR("Key still touched, not sleeping");
+        return false;
+    }
+    
+    #if TTP229_RTOS_SUPPORT
+    if (_group != NULL) {
+        TTP229_ERROR("Keypad belongs to a TTP229Group");
+        return false;
+    }
+    #endif
+    
+    // The wake-up source takes over the SDO interrupt while asleep
+    bool interruptMode = _interruptMode;
+    if (interruptMode) enableInterruptMode(false);
+    
+    #if TTP229_FREERTOS
+    bool suspended = suspendScanTask();
+    #endif
+    
+    bool woke = enterSleep(mode);
+    uint32_t wakeUs = micros();
+    if (woke) wakeScan(wakeUs);
+    _wokeByTouch = woke;
+    
+    #if TTP229_FREERTOS
+    if (suspended) vTaskResume(_taskHandle);
+    #endif
+    
+    if (interruptMode) enableInterruptMode(true);
+    return woke;
+    #else
+    (void)mode;
+    TTP229_ERROR("Wake on touch not supported on this board");
+    return false;
+    #endif
+}
+
+bool TTP229::wokeByTouch() {
+    return _wokeByTouch;
+}
+
+uint32_t TTP229::getWakeLatency() {
+    return _wakeLatency;
+}
+
+bool TTP229::enterSleep(SleepMode mode) {
+    #if !TTP229_SLEEP_SUPPORT
+    (void)mode;
+    return false;
+    #elif defined(TTP229_HOST_SIM)
+    (void)mode;
+    return ttp229HostSim().sleepUntilDataValid();
+    #elif defined(ESP32)
+    gpio_num_t pin = (gpio_num_t)_sdoPin;
+    if (mode == SLEEP_DEEP) {
+        #if defined(CONFIG_IDF_TARGET_ESP32C3)
+        if (esp_deep_sleep_enable_gpio_wakeup(1ULL << _sdoPin, ESP_GPIO_WAKEUP_GPIO_LOW) != ESP_OK) {
+            TTP229_ERROR("SDO cannot wake from deep sleep");
+            return false;
+        }
+        #else
+        if (!rtc_gpio_is_valid_gpio(pin)) {
+            TTP229_ERROR("SDO must be an RTC GPIO for deep sleep");
+            return false;
+        }
+        rtc_gpio_pullup_en(pin);      // Digital pull-ups are off in deep sleep
+        rtc_gpio_pulldown_dis(pin);
+        esp_sleep_enable_ext0_wakeup(pin, 0);
+        #endif
+        #if TTP229_LOG_LEVEL >= 3
+        if (_debug) {
+            printLog();
+            Serial.println(F("Deep sleep until touch"));
+            Serial.flush();
+        }
+        #endif
+        esp_deep_sleep_start();  // Does not return
+    }
+    
+    gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_light_sleep_start();
+    gpio_wakeup_disable(pin);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+    #elif defined(ARDUINO_ARCH_AVR)
+    // Only level interrupts on INT0/INT1 wake the chip from power-down
+    int irq = digitalPinToInterrupt(_sdoPin);
+    if (irq == NOT_AN_INTERRUPT) {
+        TTP229_ERROR("SDO pin is not interrupt-capable");
+        return false;
+    }
+    set_sleep_mode(mode == SLEEP_DEEP ? SLEEP_MODE_PWR_DOWN : SLEEP_MODE_IDLE);
+    ttp229WakeFlag = false;
+    attachInterrupt(irq, ttp229WakeISR, LOW);
+    while (!ttp229WakeFlag) {
+        // In idle mode the millis() tick wakes us too - go back to sleep
+        noInterrupts();
+        if (ttp229WakeFlag) {
+            interrupts();
+            break;
+        }
+        sleep_enable();
+        interrupts();   // SEI runs the next instruction first: no lost wake-up
+        sleep_cpu();
+        sleep_disable();
+    }
+    detachInterrupt(irq);
+    return true;
+    #elif defined(ARDUINO_ARCH_RP2040)
+    if (mode == SLEEP_DEEP) {
+        #if defined(TTP229_DORMANT_SUPPORT)
+        // Clocks stop completely; USB serial has to reconnect afterwards
+        sleep_run_from_xosc();
+        sleep_goto_dormant_until_pin(_sdoPin, true, false);  // Falling edge
+        clocks_init();
+        return true;
+        #else
+        TTP229_WARNING("Dormant mode needs pico-extras, using light sleep");
+        #endif
+    }
+    ttp229WakeFlag = false;
+    attachInterrupt(digitalPinToInterrupt(_sdoPin), ttp229WakeISR, LOW);
+    while (!ttp229WakeFlag) {
+        __wfe();  // Any exception return sets the event flag - checked again
+    }
+    detachInterrupt(digitalPinToInterrupt(_sdoPin));
+    return true;
+    #endif
+}
+
+uint16_t TTP229::wakeScan(uint32_t wakeUs) {
+    uint16_t frame = readRawMask();
+    
+    _lastKey = _lastValidKey;
+    _lastKeyMask = _keyMask;
+    _lastReadTime = millis();
+    _debouncer.accept(frame);
+    processFrame(frame);
+    
+    _wakeCount++;
+    if (frame != 0) _wakeLatency = micros() - wakeUs;
+    return frame;
+}
+
+#if TTP229_FREERTOS
+bool TTP229::suspendScanTask() {
+    if (_taskHandle == NULL || xTaskGetCurrentTaskHandle() == _taskHandle) return false;
+    
+    // Holding the mutex keeps the task out of event processing, and a
+    // task caught halfway through a frame is let finish it first
+    for (;;) {
+        takeMutex();
+        vTaskSuspend(_taskHandle);
+        giveMutex();
+        if (!_scanning) return true;
+        vTaskResume(_taskHandle);
+        vTaskDelay(1);
+    }
+}
+#endif
+
+// ==============================================
+// INFORMATION METHODS
+// ==============================================
+
+const char* TTP229::getBoardName() {
+    return _boardName;
+}
+
+const char* TTP229::getGpioBackendName() {
+    return _gpio.getBackendName();
+}
+
+TTP229::ReadBackend TTP229::getReadBackend() {
+    return _backend;
+}
+
+uint16_t TTP229::getScanInterval() {
+    return _scanInterval;
+}
+
+uint32_t TTP229::getScanSequence() {
+    return _scanSequence;
+}
+
+uint8_t TTP229::getSCLPin() {
+    return _sclPin;
+}
+
+uint8_t TTP229::getSDOPin() {
+    return _sdoPin;
+}
+
+bool TTP229::is16KeyMode() {
+    return _is16KeyMode;
+}
+
+bool TTP229::isInitialized() {
+    return _initialized;
+}
+
+// ==============================================
+// DEBUG METHODS
+// ==============================================
+
+void TTP229::printDebugInfo() {
+    #if TTP229_LOG_LEVEL >= 3
     if (!_debug) return;
     
-    Serial.println("========================================");
-    Serial.print("TTP229 Library - ");
+    Serial.println(F("========================================"));
+    Serial.print(F("TTP229 Library - "));
     Serial.println(_boardName);
-    Serial.println("========================================");
-    Serial.print("Initialized: ");
+    Serial.println(F("========================================"));
+    Serial.print(F("Initialized: "));
     Serial.println(_initialized ? "Yes" : "No");
-    Serial.print("Mode: ");
+    Serial.print(F("Mode: "));
     Serial.println(_is16KeyMode ? "16-key" : "8-key");
-    Serial.print("SCL Pin: ");
+    Serial.print(F("SCL Pin: "));
     Serial.println(_sclPin);
-    Serial.print("SDO Pin: ");
+    Serial.print(F("SDO Pin: "));
     Serial.println(_sdoPin);
-    Serial.print("Clock Delay: ");
+    Serial.print(F("GPIO: "));
+    Serial.println(_gpio.getBackendName());
+    Serial.print(F("Read Backend: "));
+    Serial.println(_backend == BACKEND_SPI ? "Hardware SPI" :
+                   _backend == BACKEND_REPLAY ? "Replay" : "Bit-bang");
+    Serial.print(F("Clock Delay: "));
     Serial.print(_clkDelay);
-    Serial.println(" µs");
-    Serial.print("Read Delay: ");
+    Serial.println(F(" µs"));
+    Serial.print(F("Read Delay: "));
     Serial.print(_readDelay);
-    Serial.println(" µs");
-    Serial.print("Debounce: ");
+    Serial.println(F(" µs"));
+    Serial.print(F("Debounce: "));
     Serial.print(_debounceDelay);
-    Serial.println(" ms");
-    Serial.print("Scan Interval: ");
+    Serial.println(F(" ms"));
+    Serial.print(F("Scan Interval: "));
     Serial.print(_scanInterval);
-    Serial.println(" ms");
+    Serial.println(F(" ms"));
+    if (_idleScanInterval != _activeScanInterval) {
+        Serial.print(F("Scan Policy: idle "));
+        Serial.print(_idleScanInterval);
+        Serial.print(F(" ms, active "));
+        Serial.print(_activeScanInterval);
+        Serial.print(F(" ms, quiet "));
+        Serial.print(_quietPeriod);
+        Serial.println(F(" ms"));
+    }
     
     #if TTP229_RTOS_SUPPORT
-    Serial.print("RTOS Support: Available");
+    Serial.print(F("RTOS Support: Available"));
     if (_rtosEnabled) {
-        Serial.print(" (Enabled)");
-        Serial.print(" Task Priority: ");
+        Serial.print(F(" (Enabled)"));
+        Serial.print(F(" Task Priority: "));
         Serial.println(_taskPriority);
     } else {
-        Serial.println(" (Disabled)");
+        Serial.println(F(" (Disabled)"));
+    }
+    #else
+    Serial.println(F("RTOS Support: Not available on this board"));
+    #endif
+    
+    Serial.println(F("========================================"));
+    #endif // TTP229_LOG_LEVEL >= 3
+}
+
+void TTP229::printRawReadings() {
+    static uint8_t lastPrintedKey = KEY_NONE;
+    uint8_t currentKey = read();
+    
+    if (currentKey != lastPrintedKey) {
+        if (currentKey > KEY_NONE) {
+            Serial.print("Key: ");
+            Serial.print(currentKey);
+            
+            uint8_t row, col;
+            getPosition(row, col);
+            if (row != POSITION_INVALID && col != POSITION_INVALID) {
+                Serial.print(" (Row ");
+                Serial.print(row);
+                Serial.print(", Col ");
+                Serial.print(col);
+                Serial.print(")");
+            }
+            Serial.println();
+        } else {
+            Serial.println("No key");
+        }
+        lastPrintedKey = currentKey;
+    }
+}
+
+#if TTP229_TRACE_DEPTH > 0
+void TTP229::enableTrace(bool enable) {
+    _traceEnabled = enable;
+}
+
+void TTP229::clearTrace() {
+    bool enabled = _traceEnabled;
+    _traceEnabled = false;
+    _traceTotal = 0;
+    _traceEnabled = enabled;
+}
+
+uint16_t TTP229::getTraceCount() {
+    uint32_t total = _traceTotal;
+    return total < TTP229_TRACE_DEPTH ? (uint16_t)total : TTP229_TRACE_DEPTH;
+}
+#endif
+
+TTP229::MemoryFootprint TTP229::getMemoryFootprint() {
+    MemoryFootprint footprint;
+    memset(&footprint, 0, sizeof(footprint));
+    footprint.object = sizeof(TTP229);
+    footprint.eventRing = sizeof(_events);
+    
+    #if TTP229_FREERTOS
+    // Heap blocks for these are the size of their Static* counterparts;
+    // allocator headers are not counted
+    if (_mutex != NULL) footprint.rtosObjects += sizeof(StaticSemaphore_t);
+    if (_taskHandle != NULL) {
+        footprint.rtosObjects += sizeof(StaticTask_t);
+        footprint.taskStack = _taskStackDepth * sizeof(StackType_t);
+    }
+    if (_logTaskHandle != NULL) {
+        footprint.rtosObjects += sizeof(StaticTask_t);
+        footprint.taskStack += TTP229_LOG_TASK_STACK * sizeof(StackType_t);
+    }
+    footprint.heap = footprint.rtosObjects + footprint.taskStack;
+    #if TTP229_STATIC_RTOS
+    if (_rtosStorage != NULL) footprint.heap = 0;
+    #endif
+    #endif
+    
+    footprint.total = footprint.object + footprint.taskStack + footprint.rtosObjects;
+    return footprint;
+}
+
+// ==============================================
+// LOW-LEVEL READING METHODS
+// ==============================================
+
+uint16_t TTP229::readRawMask() {
+    // The chip shifts key 1 first; active LOW means key is pressed
+    _dataReady = false;
+    _scanning = true;
+    uint16_t mask;
+    if (_backend == BACKEND_SPI) {
+        mask = readFrameSPI();
+    } else if (_backend == BACKEND_REPLAY) {
+        mask = _replay->read();
+    } else {
+        mask = _gpio.readFrame(_is16KeyMode ? 16 : 8, _clkDelay, _readDelay);
+    }
+    _scanning = false;
+    return mask;
+}
+
+// ==============================================
+// HARDWARE SPI BACKEND
+// ==============================================
+// The serial interface is SPI mode 3 (clock idles high, data valid on the
+// rising edge) with only MISO in use. Key 1 comes first, so LSB-first
+// byte order puts key 1 in bit 0. The keypad should own the bus: traffic
+// for other devices also clocks the TTP229.
+
+bool TTP229::beginSPI() {
+    #if TTP229_SPI_SUPPORT
+    #if defined(ESP32)
+        // GPIO matrix routes the peripheral to any pins
+        SPI.begin(_sclPin, _sdoPin, -1, -1);
+        return true;
+    #elif defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)
+        if (!SPI.setSCK(_sclPin) || !SPI.setRX(_sdoPin)) return false;
+        SPI.begin();
+        return true;
+    #elif defined(PIN_SPI_SCK) && defined(PIN_SPI_MISO)
+        // Fixed SPI pins (AVR, SAMD)
+        if (_sclPin != PIN_SPI_SCK || _sdoPin != PIN_SPI_MISO) return false;
+        SPI.begin();
+        return true;
+    #else
+        return false;
+    #endif
+    #else
+    return false;
+    #endif
+}
+
+void TTP229::endSPI() {
+    #if TTP229_SPI_SUPPORT
+    SPI.end();
+    // Take SCL back for bit-banging
+    pinMode(_sclPin, OUTPUT);
+    digitalWrite(_sclPin, HIGH);
+    #endif
+}
+
+uint16_t TTP229::readFrameSPI() {
+    #if TTP229_SPI_SUPPORT
+    uint16_t raw;
+    SPI.beginTransaction(SPISettings(TTP229_SPI_CLOCK_HZ, LSBFIRST, SPI_MODE3));
+    raw = SPI.transfer(0xFF);
+    if (_is16KeyMode) {
+        raw |= (uint16_t)SPI.transfer(0xFF) << 8;
+    } else {
+        raw |= 0xFF00;
+    }
+    SPI.endTransaction();
+    
+    // Active LOW: a touched key reads as 0
+    return (uint16_t)~raw;
+    #else
+    return 0;
+    #endif
+}
+
+uint8_t TTP229::readRaw() {
+    return maskToKey(readRawMask());
+}
+
+// ==============================================
+// EVENT QUEUE
+// ==============================================
+
+void TTP229::addEventToQueue(uint8_t key, uint8_t eventType, uint16_t data) {
+    KeyEvent event;
+    event.key = key;
+    event.eventType = eventType;
+    event.timestamp = millis();
+    getPositionInternal(key, &event.row, &event.col);
+    event.data = data;
+    #if defined(TTP229_EVENT_TIMING)
+    stampEvent(event, true);
+    #endif
+    
+    #if TTP229_FREERTOS
+    notifySubscribers(event);
+    #endif
+    
+    #if !defined(TTP229_NO_KEY_HANDLERS)
+    // Handled right here - nothing left for the queue
+    if (_dispatchMode == DISPATCH_IMMEDIATE && callHandlers(event)) return;
+    #endif
+    
+    #if TTP229_FREERTOS
+    if (_group != NULL) {
+        // Every event goes to the group's merged queue. Our own queue
+        // only carries what dispatchEvents() has handlers for.
+        #if !defined(TTP229_NO_KEY_HANDLERS)
+        if (_dispatchMode == DISPATCH_DEFERRED && hasHandler(event)) queueEvent(event);
+        #endif
+        _group->postEvent(_groupId, event);
+        return;
+    }
+    #endif
+    
+    queueEvent(event);
+}
+
+void TTP229::queueEvent(const KeyEvent& event) {
+    if (!_eventQueueEnabled) return;
+    
+    uint8_t key = event.key;
+    uint8_t eventType = event.eventType;
+    const QueueEntry& entry = toQueueEntry(event);
+    bool dropped = false;
+    switch (_overflowPolicy) {
+        case OVERFLOW_DROP_OLDEST:
+            dropped = _events.pushOverwrite(entry);
+            break;
+            
+        case OVERFLOW_COALESCE:
+            // Older waiting events go first to keep per-key order
+            flushCoalesced();
+            if (eventType > EVENT_REPEAT) {
+                // Gestures are one-off - nothing to merge them into
+                dropped = _coalescedMask != 0 || !_events.push(entry);
+            } else if (_coalescedMask != 0 || !_events.push(entry)) {
+                _coalescedMask |= keyToMask(key);
+                _coalescedType[key - 1] = eventType;
+                dropped = true;
+            }
+            break;
+            
+        default:
+            dropped = !_events.push(entry);
+            break;
+    }
+    
+    // Only the producer writes these counters - no lock needed
+    if (dropped) {
+        _queueOverflows++;
+        TTP229_LOG(1, LOG_QUEUE_FULL, key, eventType);
+    }
+    
+    #if TTP229_RTOS_SUPPORT
+    // _stats is read by getRTOSStats() from other tasks
+    uint32_t queueCount = _events.count();
+    #if TTP229_FREERTOS
+    portENTER_CRITICAL(&_statsMutex);
+    #endif
+    if (dropped) {
+        _stats.queueOverflows++;
+    } else if (queueCount > _stats.maxQueueUsage) {
+        _stats.maxQueueUsage = queueCount;
+    }
+    #if TTP229_FREERTOS
+    portEXIT_CRITICAL(&_statsMutex);
+    #endif
+    #endif
+    
+    #if TTP229_FREERTOS && !defined(TTP229_NO_KEY_HANDLERS)
+    // Wake dispatchEvents() if it waits in another task. The fence pairs
+    // with the one there, so either it sees the event or we see it.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    TaskHandle_t dispatcher = _dispatchTask;
+    if (dispatcher != NULL) xTaskNotifyGive(dispatcher);
+    #endif
+}
+
+bool TTP229::pollEvent(KeyEvent& event, uint32_t timeoutMs, uint16_t eventMask, uint16_t keyMask) {
+    // No scan task: drive read() and take the first matching event from
+    // the event queue. The others stay queued for getKeyEvents().
+    unsigned long startTime = millis();
+    for (;;) {
+        read();
+        if (takeEvent(event, eventMask, keyMask)) return true;
+        if (timeElapsed(startTime, timeoutMs)) return false;
+        delay(1);
+    }
+}
+
+// waitForEvent() filter applied to a queued entry
+struct TTP229EventFilter {
+    uint16_t eventMask;
+    uint16_t keyMask;
+    
+    bool pass(uint8_t type, uint8_t key) const {
+        return (eventMask & (1 << type)) && (keyMask & ttp229KeyToMask(key));
+    }
+    bool operator()(const TTP229PackedEvent& entry) const { return pass(entry.type(), entry.key()); }
+    bool operator()(const TTP229::KeyEvent& entry) const { return pass(entry.eventType, entry.key); }
+};
+
+bool TTP229::takeEvent(KeyEvent& event, uint16_t eventMask, uint16_t keyMask) {
+    TTP229EventFilter filter = { eventMask, keyMask };
+    QueueEntry entry;
+    
+    // Entries move inside the ring: hold the producer off as for
+    // setQueueSize()
+    #if TTP229_FREERTOS
+    if (!takeMutex(10)) return false;
+    #else
+    noInterrupts();
+    #endif
+    
+    bool found = _events.takeFirst(entry, filter);
+    
+    #if TTP229_FREERTOS
+    giveMutex();
+    #else
+    interrupts();
+    #endif
+    
+    if (found) fromQueueEntry(entry, event);
+    return found;
+}
+
+void TTP229::flushCoalesced() {
+    while (_coalescedMask != 0) {
+        uint8_t key = ttp229MaskToKey(_coalescedMask);
+        
+        KeyEvent event;
+        event.key = key;
+        event.eventType = _coalescedType[key - 1];
+        event.timestamp = millis();
+        getPositionInternal(key, &event.row, &event.col);
+        event.data = 0;
+        #if defined(TTP229_EVENT_TIMING)
+        stampEvent(event, false);
+        #endif
+        
+        if (!_events.push(toQueueEntry(event))) return;  // Still full
+        _coalescedMask &= ~keyToMask(key);
+    }
+}
+
+#if defined(TTP229_EVENT_TIMING)
+void TTP229::stampEvent(KeyEvent& event, bool fromScan) {
+    bool edge = event.eventType == EVENT_PRESS || event.eventType == EVENT_RELEASE;
+    if (!fromScan || !edge) {
+        // Timers, gestures and coalesced events: generated right now
+        event.edgeMicros = micros();
+        event.acceptMicros = event.edgeMicros;
+        event.scanSequence = _scanSequence;
+        return;
+    }
+    
+    // Frames older than the history (a long mutex stall) read as the oldest
+    uint8_t lag = (event.eventType == EVENT_PRESS) ? _pressLag : _releaseLag;
+    uint32_t oldest = _scanSequence - (FRAME_HISTORY - 1);
+    uint32_t acceptSequence = _acceptSequence;
+    uint32_t edgeSequence = acceptSequence - lag;
+    if ((int32_t)(acceptSequence - oldest) < 0) acceptSequence = oldest;
+    if ((int32_t)(edgeSequence - oldest) < 0) edgeSequence = oldest;
+    
+    event.scanSequence = _acceptSequence;
+    event.acceptMicros = _frameMicros[acceptSequence & (FRAME_HISTORY - 1)];
+    event.edgeMicros = _frameMicros[edgeSequence & (FRAME_HISTORY - 1)];
+}
+#endif
+
+#if defined(TTP229_PACKED_QUEUE)
+void TTP229::fromQueueEntry(const QueueEntry& entry, KeyEvent& event) {
+    memset(&event, 0, sizeof(event));
+    event.key = entry.key();
+    event.eventType = entry.type();
+    event.timestamp = entry.timeBefore(millis());
+    getPositionInternal(event.key, &event.row, &event.col);
+}
+
+bool TTP229::getKeyEvents(KeyEvent &event) {
+    TTP229PackedEvent entry;
+    if (!_events.pop(entry)) return false;
+    
+    fromQueueEntry(entry, event);
+    return true;
+}
+
+size_t TTP229::getKeyEvents(KeyEvent* events, size_t maxEvents) {
+    size_t count = 0;
+    while (count < maxEvents && getKeyEvents(events[count])) count++;
+    return count;
+}
+#else
+bool TTP229::getKeyEvents(KeyEvent &event) {
+    return _events.pop(event);
+}
+
+size_t TTP229::getKeyEvents(KeyEvent* events, size_t maxEvents) {
+    if (maxEvents > 255) maxEvents = 255;
+    return _events.popBatch(events, (uint8_t)maxEvents);
+}
+#endif
+
+size_t TTP229::encodeEvents(uint8_t* buffer, size_t size) {
+    // Events go straight from the ring into the caller's buffer
+    TTP229BatchWriter batch(buffer, size);
+    KeyEvent event;
+    while (!batch.full() && getKeyEvents(event)) {
+        batch.add(event.key, event.eventType, event.timestamp);
+    }
+    return batch.length();
+}
+
+uint32_t TTP229::getQueueCount() {
+    return _events.count();
+}
+
+uint32_t TTP229::getQueueOverflows() {
+    return _queueOverflows;
+}
+
+uint8_t TTP229::getQueueSize() {
+    return _events.size();
+}
+
+bool TTP229::setQueueSize(uint8_t size) {
+    if (size == 0) {
+        TTP229_ERROR("Queue size must be at least 1");
+        return false;
+    }
+    if (size > TTP229_EVENT_QUEUE_CAPACITY) {
+        TTP229_WARNING("Queue size capped at TTP229_EVENT_QUEUE_CAPACITY");
+    }
+    
+    // Resize in place, keeping queued events. Call from the context that
+    // drains the queue; the producer is held off by the mutex (scan task)
+    // or by masking interrupts (service() from a timer ISR).
+    #if TTP229_FREERTOS
+    if (!takeMutex(10)) {
+        TTP229_ERROR("setQueueSize: mutex timeout");
+        return false;
+    }
+    #else
+    noInterrupts();
+    #endif
+    
+    _queueSize = size;
+    _queueOverflows += _events.resize(size);
+    
+    #if TTP229_FREERTOS
+    giveMutex();
+    #else
+    interrupts();
+    #endif
+    return true;
+}
+
+void TTP229::setOverflowPolicy(OverflowPolicy policy) {
+    _overflowPolicy = policy;
+}
+
+void TTP229::enableEventQueue(bool enable) {
+    _eventQueueEnabled = enable;
+}
+
+void TTP229::processFrame(uint16_t rawMask) {
+    _scanSequence++;
+    
+    #if defined(TTP229_EVENT_TIMING) || TTP229_TRACE_DEPTH > 0
+    // Stamp the frame before any mutex wait in processKeyEvents()
+    uint32_t frameMicros = micros();
+    #endif
+    
+    #if TTP229_TRACE_DEPTH > 0
+    if (_traceEnabled) {
+        uint16_t slot = _traceTotal & (TTP229_TRACE_DEPTH - 1);
+        _traceMicros[slot] = frameMicros;
+        _traceMasks[slot] = rawMask;
+        _traceLastSequence = _scanSequence;
+        _traceTotal = _traceTotal + 1;
+    }
+    #endif
+    
+    #if defined(TTP229_EVENT_TIMING)
+    _frameMicros[_scanSequence & (FRAME_HISTORY - 1)] = frameMicros;
+    uint16_t stableBefore = _debouncer.stable;
+    uint16_t maskBefore = _currentMask;
+    #endif
+    
+    _currentMask = _debouncer.update(rawMask);
+    _currentKey = maskToKey(_currentMask);
+    
+    #if defined(TTP229_EVENT_TIMING)
+    if (_currentMask != maskBefore) {
+        // The debouncer flips a key after its threshold of frames in a
+        // row, so the edge showed up that many frames back. A frame taken
+        // as it is (the wake-up scan) is its own edge.
+        bool counted = _currentMask != stableBefore;
+        _acceptSequence = _scanSequence;
+        _pressLag = counted ? _debouncer.pressScans - 1 : 0;
+        _releaseLag = counted ? _debouncer.releaseScans - 1 : 0;
+    }
+    #endif
+    
+    updateScanRate(rawMask);
+    processKeyEvents();
+}
+
+void TTP229::updateScanRate(uint16_t rawMask) {
+    if (_idleScanInterval == _activeScanInterval) return;  // Fixed rate
+    
+    // Burst on the first touched frame, stay fast while anything is down
+    // or still debouncing, fall back once quiet for the whole period
+    if (rawMask != 0 || _debouncer.pending()) {
+        _lastActiveTime = millis();
+        _scanInterval = _activeScanInterval;
+    } else if (_scanInterval != _idleScanInterval &&
+               timeElapsed(_lastActiveTime, _quietPeriod)) {
+        _scanInterval = _idleScanInterval;
+    }
+}
+
+// ==============================================
+// GESTURES (ALL PLATFORMS)
+// ==============================================
+
+#if !defined(TTP229_NO_GESTURES)
+
+bool TTP229::enableGestures(uint16_t gestures) {
+    if (gestures & ~EVENT_MASK_GESTURES) {
+        TTP229_ERROR("Not a gesture event type");
+        return false;
+    }
+    
+    #if TTP229_RTOS_SUPPORT
+    if (!takeMutex(10)) return false;
+    #endif
+    _gestures.reset();
+    _gestures.enabled = gestures;
+    #if TTP229_RTOS_SUPPORT
+    giveMutex();
+    #endif
+    return true;
+}
+
+bool TTP229::setGestureTiming(uint16_t tapMs, uint16_t multiTapMs,
+                              uint16_t swipeStepMs, uint16_t chordMs) {
+    if (tapMs == 0 || multiTapMs == 0 || swipeStepMs == 0 || chordMs == 0 ||
+        tapMs > 5000 || multiTapMs > 5000 || swipeStepMs > 5000 || chordMs > 5000) {
+        TTP229_ERROR("Gesture windows must be 1-5000ms");
+        return false;
+    }
+    
+    #if TTP229_RTOS_SUPPORT
+    if (!takeMutex(10)) return false;
+    #endif
+    _gestures.tapMs = tapMs;
+    _gestures.multiTapMs = multiTapMs;
+    _gestures.swipeStepMs = swipeStepMs;
+    _gestures.chordMs = chordMs;
+    #if TTP229_RTOS_SUPPORT
+    giveMutex();
+    #endif
+    return true;
+}
+
+bool TTP229::setSwipeLength(uint8_t keys) {
+    if (keys < 2 || keys > 4) {
+        TTP229_ERROR("Swipe length must be 2-4 keys");
+        return false;
+    }
+    _gestures.swipeKeys = keys;
+    return true;
+}
+
+#endif // TTP229_NO_GESTURES
+
+// ==============================================
+// KEY HANDLERS (ALL PLATFORMS)
+// ==============================================
+
+#if !defined(TTP229_NO_KEY_HANDLERS)
+
+bool TTP229::onPress(uint8_t key, KeyHandler handler) {
+    return onEvent(key, EVENT_PRESS, handler);
+}
+
+bool TTP229::onRelease(uint8_t key, KeyHandler handler) {
+    return onEvent(key, EVENT_RELEASE, handler);
+}
+
+bool TTP229::onHold(uint8_t key, KeyHandler handler) {
+    return onEvent(key, EVENT_HOLD, handler);
+}
+
+bool TTP229::onLongPress(uint8_t key, KeyHandler handler) {
+    return onEvent(key, EVENT_LONG_PRESS, handler);
+}
+
+bool TTP229::onRepeat(uint8_t key, KeyHandler handler) {
+    return onEvent(key, EVENT_REPEAT, handler);
+}
+
+bool TTP229::onEvent(uint8_t key, uint8_t eventType, KeyHandler handler) {
+    if (key > KEY_16 || eventType >= HANDLER_EVENT_TYPES) {
+        TTP229_ERROR("Invalid key or event type for handler");
+        return false;
     }
-    #else
-    Serial.println("RTOS Support: Not available on this board");
+    
+    // A pointer store is not atomic on AVR - keep a timer ISR out
+    #if defined(ARDUINO_ARCH_AVR)
+    noInterrupts();
     #endif
+    _handlers[eventType][key] = handler;
+    #if defined(ARDUINO_ARCH_AVR)
+    interrupts();
+    #endif
+    return true;
+}
+
+#if !defined(TTP229_NO_GESTURES)
+bool TTP229::onGesture(uint8_t eventType, KeyHandler handler) {
+    if (eventType < HANDLER_EVENT_TYPES || eventType >= TTP229_EVENT_TYPES) {
+        TTP229_ERROR("Not a gesture event type");
+        return false;
+    }
     
-    Serial.println("========================================");
+    #if defined(ARDUINO_ARCH_AVR)
+    noInterrupts();
+    #endif
+    _gestureHandlers[eventType - HANDLER_EVENT_TYPES] = handler;
+    #if defined(ARDUINO_ARCH_AVR)
+    interrupts();
+    #endif
+    return true;
 }
+#endif
 
-void TTP229::printRawReadings() {
-    static uint8_t lastPrintedKey = KEY_NONE;
-    uint8_t currentKey = read();
+void TTP229::clearHandlers() {
+    #if defined(ARDUINO_ARCH_AVR)
+    noInterrupts();
+    #endif
+    memset(_handlers, 0, sizeof(_handlers));
+    #if !defined(TTP229_NO_GESTURES)
+    memset(_gestureHandlers, 0, sizeof(_gestureHandlers));
+    #endif
+    #if defined(ARDUINO_ARCH_AVR)
+    interrupts();
+    #endif
+}
+
+void TTP229::setDispatchMode(DispatchMode mode) {
+    _dispatchMode = mode;
+}
+
+size_t TTP229::dispatchEvents(uint32_t waitMs) {
+    // Straight from the event queue: no waitForEvent() subscription, so
+    // the calling task's own filter stays as it is and events queued
+    // before the first call are not lost
+    size_t count = 0;
+    unsigned long startTime = millis();
+    KeyEvent event;
     
-    if (currentKey != lastPrintedKey) {
-        if (currentKey > KEY_NONE) {
-            Serial.print("Key: ");
-            Serial.print(currentKey);
-            
-            uint8_t row, col;
-            getPosition(row, col);
-            if (row != POSITION_INVALID && col != POSITION_INVALID) {
-                Serial.print(" (Row ");
-                Serial.print(row);
-                Serial.print(", Col ");
-                Serial.print(col);
-                Serial.print(")");
+    for (;;) {
+        read();  // Scans, unless a task, a group or service() does
+        while (getKeyEvents(event)) {
+            callHandlers(event);
+            count++;
+        }
+        if (count > 0 || timeElapsed(startTime, waitMs)) return count;
+        
+        #if TTP229_FREERTOS
+        if (scannedByTask()) {
+            // queueEvent() wakes us; the fence pairs with the one there
+            _dispatchTask = xTaskGetCurrentTaskHandle();
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (_events.isEmpty()) {
+                uint32_t waited = millis() - startTime;
+                ulTaskNotifyTake(pdTRUE, waitMs == 0xFFFFFFFF ? portMAX_DELAY :
+                                         pdMS_TO_TICKS(waitMs - waited));
             }
-            Serial.println();
-        } else {
-            Serial.println("No key");
+            _dispatchTask = NULL;
+            continue;
         }
-        lastPrintedKey = currentKey;
+        #endif
+        delay(1);
+    }
+}
+
+bool TTP229::callHandlers(const KeyEvent& event) {
+    if (event.key > KEY_16) return false;
+    if (event.eventType >= HANDLER_EVENT_TYPES) {
+        #if !defined(TTP229_NO_GESTURES)
+        if (event.eventType < TTP229_EVENT_TYPES) {
+            KeyHandler handler = _gestureHandlers[event.eventType - HANDLER_EVENT_TYPES];
+            if (handler != NULL) {
+                handler(event);
+                return true;
+            }
+        }
+        #endif
+        return false;
+    }
+    
+    // Two table lookups: the key's own handler, then the any-key one
+    KeyHandler* row = _handlers[event.eventType];
+    bool handled = false;
+    if (row[event.key] != NULL) {
+        row[event.key](event);
+        handled = true;
+    }
+    if (row[KEY_ANY] != NULL) {
+        row[KEY_ANY](event);
+        handled = true;
+    }
+    return handled;
+}
+
+bool TTP229::hasHandler(const KeyEvent& event) {
+    if (event.key > KEY_16) return false;
+    if (event.eventType >= HANDLER_EVENT_TYPES) {
+        #if !defined(TTP229_NO_GESTURES)
+        if (event.eventType < TTP229_EVENT_TYPES) {
+            return _gestureHandlers[event.eventType - HANDLER_EVENT_TYPES] != NULL;
+        }
+        #endif
+        return false;
     }
+    KeyHandler* row = _handlers[event.eventType];
+    return row[event.key] != NULL || row[KEY_ANY] != NULL;
 }
 
+#endif // TTP229_NO_KEY_HANDLERS
+
 // ==============================================
-// LOW-LEVEL READING METHODS
+// KEY EVENT GENERATION (ALL PLATFORMS)
 // ==============================================
 
-uint8_t TTP229::readRaw() {
-    uint8_t keyValue = KEY_NONE;
-    uint8_t maxKeys = _is16KeyMode ? 16 : 8;
+void TTP229::processKeyEvents() {
+    // Fast path: nothing changed, no timer expired, nothing waiting for
+    // queue space - skip the mutex entirely
+    uint32_t now = millis();
+    if (_currentMask == _eventMachine.keyMask && _coalescedMask == 0 && !deadlineDue(now)) {
+        return;
+    }
     
-    // Start with clock high
-    digitalWrite(_sclPin, HIGH);
-    delayMicroseconds(_readDelay);
+    #if TTP229_FREERTOS
+    if (!takeMutex(5)) {  // 5ms timeout
+        TTP229_LOG(2, LOG_MUTEX_TIMEOUT, 0, 0);
+        return;
+    }
+    #endif
     
-    // Read each key position
-    for (uint8_t i = 1; i <= maxKeys; i++) {
-        // Clock pulse low
-        digitalWrite(_sclPin, LOW);
-        delayMicroseconds(_clkDelay);
-        
-        // Read data (active LOW means key is pressed)
-        if (digitalRead(_sdoPin) == LOW) {
-            keyValue = i;  // Store which key is pressed
-        }
-        
-        // Clock pulse high
-        digitalWrite(_sclPin, HIGH);
-        delayMicroseconds(_clkDelay);
+    // Events that were waiting for queue space go out first
+    if (_coalescedMask != 0) flushCoalesced();
+    
+    uint16_t previousMask = _eventMachine.keyMask;
+    uint16_t changed = _eventMachine.update(_currentMask, now, *this);
+    
+    #if !defined(TTP229_NO_GESTURES)
+    if (_gestures.enabled && (changed || _gestures.due(now))) {
+        _gestures.update(changed & _currentMask, changed & previousMask, _currentMask, now, *this);
     }
+    #endif
     
-    // Ensure clock is high at end
-    digitalWrite(_sclPin, HIGH);
+    if (changed) {
+        _lastKeyMask = previousMask;
+        _keyMask = _currentMask;
+        _lastKey = _lastValidKey;
+        _lastValidKey = maskToKey(_keyMask);
+        publishState(previousMask, now);
+        TTP229_LOG(4, LOG_KEY_CHANGE, 0, _keyMask);
+    }
     
-    return keyValue;
+    #if TTP229_FREERTOS
+    giveMutex();
+    #endif
 }
 
-uint8_t TTP229::readDebounced() {
-    uint8_t rawKey = readRaw();
-    unsigned long now = millis();
+bool TTP229::deadlineDue(uint32_t now) {
+    #if !defined(TTP229_NO_GESTURES)
+    if (_gestures.due(now)) return true;
+    #endif
+    return _eventMachine.due(now);
+}
+
+uint32_t TTP229::msUntilDeadline() {
+    bool pending = _eventMachine.timing();
+    uint32_t deadline = _eventMachine.nextDeadline;
+    uint32_t now = millis();
     
-    // If key state changed, reset debounce timer
-    if (rawKey != _lastRawKey) {
-        _lastChangeTime = now;
-        _lastRawKey = rawKey;
+    #if !defined(TTP229_NO_GESTURES)
+    if (_gestures.pending()) {
+        uint32_t gestureDeadline = _gestures.nextDeadline();
+        if (!pending || (int32_t)(gestureDeadline - deadline) < 0) deadline = gestureDeadline;
+        pending = true;
     }
+    #endif
     
-    // Only return stable key if debounce time has passed
-    if (timeElapsed(_lastChangeTime, _debounceDelay)) {
-        _stableKey = rawKey;
+    if (!pending) return 0xFFFFFFFF;
+    return ttp229Due(now, deadline) ? 0 : deadline - now;
+}
+
+void TTP229::emitEvent(uint8_t key, uint8_t eventType, uint16_t data) {
+    TTP229_LOG(4, LOG_EVENT, key, eventType);
+    addEventToQueue(key, eventType, data);
+}
+
+// ==============================================
+// DEFERRED DEBUG OUTPUT
+// ==============================================
+
+#if TTP229_LOG_LEVEL > 0
+void TTP229::logRecord(uint8_t code, uint8_t key, uint16_t value) {
+    LogRecord record;
+    record.micros = micros();
+    record.code = code;
+    record.key = key;
+    record.value = value;
+    if (!_log.push(record)) _logDropped++;
+}
+
+size_t TTP229::drainLog() {
+    static const char* const names[TTP229_EVENT_TYPES] = {
+        "PRESS", "RELEASE", "HOLD", "LONG_PRESS", "REPEAT", "DOUBLE_TAP", "MULTI_TAP",
+        "SWIPE_LEFT", "SWIPE_RIGHT", "SWIPE_UP", "SWIPE_DOWN", "CHORD"
+    };
+    
+    size_t printed = 0;
+    LogRecord record;
+    while (_log.pop(record)) {
+        const char* name = names[record.value < TTP229_EVENT_TYPES ? record.value : 0];
+        Serial.print(record.micros);
+        Serial.print(F(" us: "));
+        switch (record.code) {
+            case LOG_QUEUE_FULL:
+                Serial.print(F("ERROR: Queue is full! Dropped "));
+                Serial.print(name);
+                Serial.print(F(" of key "));
+                Serial.println(record.key);
+                break;
+            case LOG_MUTEX_TIMEOUT:
+                Serial.println(F("WARNING: processKeyEvents: mutex timeout"));
+                break;
+            case LOG_TASK_START:
+                Serial.println(F("Scan task started"));
+                break;
+            case LOG_TASK_STOP:
+                Serial.println(F("Scan task stopped"));
+                break;
+            case LOG_KEY_CHANGE:
+                Serial.print(F("Key change ACCEPTED: mask=0x"));
+                Serial.println(record.value, HEX);
+                break;
+            case LOG_EVENT:
+                Serial.print(F("Adding "));
+                Serial.print(name);
+                Serial.print(F(" event to queue, key "));
+                Serial.println(record.key);
+                break;
+            case LOG_SCAN_KEY:
+                Serial.print(F("Key "));
+                Serial.print(record.key);
+                Serial.print(F(", queue count = "));
+                Serial.println(record.value);
+                break;
+        }
+        printed++;
     }
     
-    return _stableKey;
+    uint16_t dropped = _logDropped;
+    if (dropped != _logDroppedShown) {
+        Serial.print((uint16_t)(dropped - _logDroppedShown));
+        Serial.println(F(" log messages dropped (raise TTP229_LOG_DEPTH)"));
+        _logDroppedShown = dropped;
+    }
+    return printed;
+}
+#endif
+
+size_t TTP229::printLog() {
+    #if TTP229_LOG_LEVEL > 0
+    #if TTP229_FREERTOS
+    if (_logTaskHandle != NULL) return 0;  // Only one consumer of the ring
+    #endif
+    return drainLog();
+    #else
+    return 0;
+    #endif
 }
 
 // ==============================================
@@ -750,10 +2316,11 @@ uint8_t TTP229::readDebounced() {
 
 // RTOS task function (static method)
 void TTP229::rtosTask(void* parameter) {
+    #if TTP229_FREERTOS
     TTP229* keypad = (TTP229*)parameter;
-    if (keypad->_debug) {
-        Serial.println("**************************");
-    }   
+    #if TTP229_LOG_LEVEL >= 3
+    if (keypad->_debug) keypad->logRecord(LOG_TASK_START);
+    #endif
     
     TickType_t lastWakeTime = xTaskGetTickCount();
     uint8_t lastProcessedKey = TTP229::KEY_NONE;
@@ -765,207 +2332,126 @@ void TTP229::rtosTask(void* parameter) {
     while (keypad->_taskRunning) {
         // Measure read time
         uint32_t startTime = micros();
-        uint8_t currentKey = keypad->readDebounced();
+        uint16_t rawMask = keypad->readRawMask();
         uint32_t readTime = micros() - startTime;
         
         // Accumulate for statistics
         totalReadTime += readTime;
         readCount++;
         
-        // Store in member variable
-        keypad->_currentKey = currentKey;
-        
         // *********** FIXED: Always process events, not just on change ***********
         // This ensures hold/long press detection works
-        keypad->processKeyEvents();
+        keypad->processFrame(rawMask);
+        uint8_t currentKey = keypad->_currentKey;
         
         // Only update lastProcessedKey if the key actually changed
         if (currentKey != lastProcessedKey) {
             lastProcessedKey = currentKey;
             
+            #if TTP229_LOG_LEVEL >= 4
             if (keypad->_debug) {
-                Serial.println(currentKey);
-                Serial.print("Queue count = ");
-                Serial.println(keypad->getQueueCount());
+                keypad->logRecord(LOG_SCAN_KEY, currentKey, keypad->_events.count());
             }
+            #endif
         }
         // ***********************************************************************
         
-        // Update statistics every 100 reads
-        if (readCount >= 100) {
+        // Update statistics every 100 reads - every read at the idle rate
+        // of a scan policy, where 100 reads can take many seconds
+        if (readCount >= 100 || keypad->_scanInterval != keypad->_activeScanInterval) {
             uint32_t avgReadTime = totalReadTime / readCount;
             keypad->updateStats(readCount, false);
             totalReadTime = 0;
             readCount = 0;
         }
         
-        vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(keypad->_scanInterval));
-    }
-    
-    #if defined(ESP32)
-    vTaskDelete(NULL);
-    if (keypad->_debug) {
-        Serial.println("###########################");
-    }
-    #endif
-}
-
-void TTP229::processKeyEvents() {
-    #if defined(ESP32)
-    if (!_rtosEnabled || !takeMutex(5)) {  // 5ms timeout
-        if (_debug) Serial.println("processKeyEvents: RTOS not enabled or mutex timeout");
-        return;
-    }
-    
-    uint32_t currentTime = millis();
-    
-    // Check if debounce period has elapsed since last change
-    if (timeElapsed(_lastDebounceTime, _debounceDelay)) {
-        // Debounce period has passed, we can process changes
-        if (_currentKey != _lastValidKey) {
-            uint8_t oldKey = _lastValidKey;
-            _lastValidKey = _currentKey;
-            
-            if (_debug) {
-                Serial.print("Key change ACCEPTED: old=");
-                Serial.print(oldKey);
-                Serial.print(", new=");
-                Serial.println(_lastValidKey);
-            }
+        // Sleep until the next scan. Hold, repeat and gesture deadlines
+        // that fall in between are run on time without a scan.
+        while (keypad->_taskRunning) {
+            uint32_t untilDeadline = keypad->msUntilDeadline();
+            TickType_t deadlineTicks = (untilDeadline == 0xFFFFFFFF) ?
+                                       portMAX_DELAY : pdMS_TO_TICKS(untilDeadline) + 1;
             
-            // Handle key press event
-            if (_lastValidKey != KEY_NONE) {
-                // Key was pressed
-                if (_debug) Serial.println("Adding PRESS event to queue");
-                addEventToQueue(_lastValidKey, EVENT_PRESS);
-                _holdStartTime = currentTime;
-                _lastHoldKey = _lastValidKey;
-                _holdEventSent = false;      // Reset hold flag
-                _longPressEventSent = false; // Reset long press flag
-                
-                // Signal waiting tasks
-                if (_readSemaphore != NULL) {
-                    xSemaphoreGive(_readSemaphore);
+            if (keypad->_interruptMode && keypad->isIdle()) {
+                // Park until the chip signals data valid (or endRTOS wakes us)
+                if (ulTaskNotifyTake(pdTRUE, deadlineTicks) != 0) {
+                    lastWakeTime = xTaskGetTickCount();
+                    break;
                 }
-            } else if (oldKey != KEY_NONE) {
-                // Key was released
-                if (_debug) Serial.println("Adding RELEASE event to queue");
-                addEventToQueue(oldKey, EVENT_RELEASE);
-                _holdStartTime = 0;
-                _lastHoldKey = 0;
-                _holdEventSent = false;
-                _longPressEventSent = false;
+                keypad->processKeyEvents();
+                continue;
             }
             
-            _lastKey = _lastValidKey;
+            // Keys down or debouncing: poll for release/hold timing
+            TickType_t period = pdMS_TO_TICKS(keypad->_scanInterval);
+            TickType_t sinceScan = xTaskGetTickCount() - lastWakeTime;
+            if (sinceScan < period && deadlineTicks < period - sinceScan) {
+                vTaskDelay(deadlineTicks);
+                keypad->processKeyEvents();
+                continue;
+            }
             
-            // Reset debounce timer for next change
-            _lastDebounceTime = currentTime;
-        }
-    }
-    
-    // ******************** HOLD & LONG PRESS DETECTION ********************
-    // Check for hold events continuously
-    if (_lastHoldKey != KEY_NONE && _holdStartTime != 0) {
-        uint32_t holdDuration = currentTime - _holdStartTime;
-        
-        // Debug hold timing (less verbose)
-        if (_debug && holdDuration > 900 && holdDuration < 2100) {
-            Serial.print("Hold duration: ");
-            Serial.print(holdDuration);
-            Serial.print("ms (HOLD@");
-            Serial.print(_holdThreshold);
-            Serial.print("ms, LONG@");
-            Serial.print(DEFAULT_LONG_PRESS_THRESHOLD_MS);
-            Serial.println("ms)");
-        }
-        
-        // Check for long press (2000ms by default) - trigger only once
-        if (!_longPressEventSent && holdDuration >= DEFAULT_LONG_PRESS_THRESHOLD_MS) {
-            if (_debug) Serial.println("*** Adding LONG_PRESS event to queue ***");
-            addEventToQueue(_lastHoldKey, EVENT_LONG_PRESS);
-            _longPressEventSent = true;  // Mark as sent
-        } 
-        // Check for hold (1000ms by default) - trigger only once
-        else if (!_holdEventSent && holdDuration >= _holdThreshold) {
-            if (_debug) Serial.println("*** Adding HOLD event to queue ***");
-            addEventToQueue(_lastHoldKey, EVENT_HOLD);
-            _holdEventSent = true;  // Mark as sent
+            // Drop notifications caused by our own clocking
+            vTaskDelayUntil(&lastWakeTime, period);
+            if (keypad->_interruptMode) {
+                ulTaskNotifyTake(pdTRUE, 0);
+            }
+            break;
         }
     }
-    // ********************************************************************
     
-    giveMutex();
+    #if TTP229_LOG_LEVEL >= 3
+    if (keypad->_debug) keypad->logRecord(LOG_TASK_STOP);
+    #endif
+    vTaskDelete(NULL);
+    #else
+    (void)parameter;  // No scan task on this platform - read() scans
     #endif
 }
 
-void TTP229::addEventToQueue(uint8_t key, uint8_t eventType) {
-    #if defined(ESP32)
-    if (_eventQueue == NULL) {
-        if (_debug) Serial.println("ERROR: Event queue is NULL!");
-        return;
-    }
-    
-    KeyEvent event;
-    event.key = key;
-    event.eventType = eventType;
-    event.timestamp = millis();
-    
-    uint8_t row, col;
-    getPositionInternal(key, &row, &col);
-    event.row = row;
-    event.col = col;
-    
-    if (_debug) {
-        Serial.print("addEventToQueue: key=");
-        Serial.print(key);
-        Serial.print(", type=");
-        Serial.print(eventType);
-        Serial.print(", queueFree=");
-        Serial.println(uxQueueSpacesAvailable(_eventQueue));
-    }
-    
-    // Try to add to queue (non-blocking)
-    if (xQueueSend(_eventQueue, &event, 0) != pdTRUE) {
-        // Queue is full
-        if (_debug) Serial.println("ERROR: Queue is full!");
-        portENTER_CRITICAL(&_statsMutex);
-        _stats.queueOverflows++;
-        portEXIT_CRITICAL(&_statsMutex);
-    } else {
-        // Update max queue usage
-        uint32_t queueCount = uxQueueMessagesWaiting(_eventQueue);
-        portENTER_CRITICAL(&_statsMutex);
-        if (queueCount > _stats.maxQueueUsage) {
-            _stats.maxQueueUsage = queueCount;
-        }
-        portEXIT_CRITICAL(&_statsMutex);
-        
-        if (_debug) {
-            Serial.print("Event added. Queue now has ");
-            Serial.print(queueCount);
-            Serial.println(" events");
-        }
+// Log task (static method): prints the scan task's log records at low
+// priority, so Serial never runs in the scan loop
+void TTP229::logTask(void* parameter) {
+    #if TTP229_FREERTOS && TTP229_LOG_LEVEL > 0
+    TTP229* keypad = (TTP229*)parameter;
+    for (;;) {
+        bool running = keypad->_taskRunning;
+        keypad->drainLog();
+        if (!running) break;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));  // endRTOS() wakes us early
     }
+    vTaskDelete(NULL);
+    #else
+    (void)parameter;
     #endif
 }
 
 bool TTP229::takeMutex(uint32_t timeout) {
-    #if defined(ESP32)
+    #if TTP229_FREERTOS
     if (_mutex == NULL) return true;
     
+    // Try without waiting first so contention can be counted
+    if (xSemaphoreTake(_mutex, 0) == pdTRUE) return true;
+    
     TickType_t timeoutTicks = (timeout == portMAX_DELAY) ? 
                               portMAX_DELAY : 
                               pdMS_TO_TICKS(timeout);
     
-    return (xSemaphoreTake(_mutex, timeoutTicks) == pdTRUE);
+    bool taken = (xSemaphoreTake(_mutex, timeoutTicks) == pdTRUE);
+    
+    portENTER_CRITICAL(&_statsMutex);
+    _stats.mutexContentions++;
+    if (!taken) _stats.mutexTimeouts++;
+    portEXIT_CRITICAL(&_statsMutex);
+    
+    return taken;
     #else
-    return true;  // No mutex on non-ESP32 platforms
+    return true;  // No mutex without FreeRTOS
     #endif
 }
 
 void TTP229::giveMutex() {
-    #if defined(ESP32)
+    #if TTP229_FREERTOS
     if (_mutex != NULL) {
         xSemaphoreGive(_mutex);
     }
@@ -973,64 +2459,144 @@ void TTP229::giveMutex() {
 }
 
 uint8_t TTP229::readFromISR() {
-    #if defined(ESP32)
-    // Use volatile read to ensure we get the latest value
-    uint8_t key = _lastValidKey;
-    
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    // A single byte read is atomic; the scan path only ever stores it
+    return _lastValidKey;
+}
+
+uint8_t TTP229::readWithTimeout(uint32_t timeoutMs) {
+    #if TTP229_FREERTOS
+    if (!_rtosEnabled && _group == NULL) return read();
+    #endif
     
-    // Check if queue has events (from ISR context)
-    if (_eventQueue != NULL && uxQueueMessagesWaitingFromISR(_eventQueue) > 0) {
-        // Signal waiting tasks
-        if (_readSemaphore != NULL) {
-            xSemaphoreGiveFromISR(_readSemaphore, &xHigherPriorityTaskWoken);
+    KeyEvent event;
+    if (waitForEvent(event, timeoutMs, EVENT_MASK_PRESS)) {
+        return event.key;
+    }
+    return KEY_NONE;  // Timeout
+}
+
+bool TTP229::waitForEvent(KeyEvent& event, uint32_t timeoutMs, uint16_t eventMask, uint16_t keyMask) {
+    #if TTP229_FREERTOS
+    if (scannedByTask()) {
+        Subscriber* subscriber = subscribe(eventMask, keyMask);
+        if (subscriber == NULL) return false;
+        
+        TickType_t start = xTaskGetTickCount();
+        TickType_t timeout = (timeoutMs == 0xFFFFFFFF) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+        
+        for (;;) {
+            if (subscriber->events.pop(event)) return true;
+            
+            // The producer pushes before it notifies, so an event that
+            // lands after the pop above still ends the wait
+            TickType_t waited = xTaskGetTickCount() - start;
+            if (timeout != portMAX_DELAY && waited >= timeout) return false;
+            ulTaskNotifyTake(pdTRUE, timeout == portMAX_DELAY ? portMAX_DELAY : timeout - waited);
+            if (!scannedByTask()) return false;  // endRTOS() or TTP229Group::end()
         }
     }
+    #endif
     
-    // Yield if a higher priority task was woken
-    if (xHigherPriorityTaskWoken) {
-        portYIELD_FROM_ISR();
+    return pollEvent(event, timeoutMs, eventMask, keyMask);
+}
+
+void TTP229::unsubscribe() {
+    #if TTP229_FREERTOS
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&_statsMutex);
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (_subscribers[i].task == self) _subscribers[i].task = NULL;
     }
-    
-    return key;
-    #else
-    return _lastValidKey;  // Not safe for ISR on non-ESP32 platforms
+    portEXIT_CRITICAL(&_statsMutex);
     #endif
 }
 
-uint8_t TTP229::readWithTimeout(uint32_t timeoutMs) {
-    #if defined(ESP32)
-    if (!_rtosEnabled) return read();
+#if TTP229_FREERTOS
+bool TTP229::scannedByTask() {
+    return (_rtosEnabled && _taskHandle != NULL) || _group != NULL;
+}
+
+TTP229::Subscriber* TTP229::subscribe(uint16_t eventMask, uint16_t keyMask) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    Subscriber* subscriber = NULL;
+    bool claimed = false;
     
-    TickType_t timeoutTicks = pdMS_TO_TICKS(timeoutMs);
+    portENTER_CRITICAL(&_statsMutex);
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS && subscriber == NULL; i++) {
+        if (_subscribers[i].task == self) subscriber = &_subscribers[i];
+    }
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS && subscriber == NULL; i++) {
+        if (_subscribers[i].task == NULL) {
+            // Matches nothing until the leftovers are drained below
+            subscriber = &_subscribers[i];
+            subscriber->eventMask = 0;
+            subscriber->task = self;
+            claimed = true;
+        }
+    }
+    portEXIT_CRITICAL(&_statsMutex);
     
-    // Wait for semaphore (blocking)
-    if (xSemaphoreTake(_readSemaphore, timeoutTicks) == pdTRUE) {
-        return _lastValidKey;
+    if (subscriber == NULL) {
+        TTP229_ERROR("Too many tasks waiting for events");
+        return NULL;
     }
     
-    return KEY_NONE;  // Timeout
-    #else
-    // Non-RTOS fallback
-    unsigned long startTime = millis();
-    while (timeElapsed(startTime, timeoutMs) == false) {
-        uint8_t key = read();
-        if (key != KEY_NONE) return key;
-        delay(1);
+    // A freed slot may still hold its last owner's events. We are its
+    // consumer now, so popping them is safe while the scan path pushes.
+    if (claimed) {
+        KeyEvent stale;
+        while (subscriber->events.pop(stale)) {}
     }
-    return KEY_NONE;
-    #endif
+    
+    // Filter changes apply from the next event on
+    subscriber->keyMask = keyMask;
+    subscriber->eventMask = eventMask;
+    return subscriber;
 }
 
-bool TTP229::getKeyEvents(KeyEvent &event) {
-    #if defined(ESP32)
-    if (!_rtosEnabled || _eventQueue == NULL) return false;
-    return (xQueueReceive(_eventQueue, &event, 0) == pdTRUE);
-    #else
-    return false;
+void TTP229::releaseSubscribers() {
+    TaskHandle_t waiting[MAX_SUBSCRIBERS + 1];
+    uint8_t count = 0;
+    
+    portENTER_CRITICAL(&_statsMutex);
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (_subscribers[i].task != NULL) {
+            waiting[count++] = _subscribers[i].task;
+            _subscribers[i].task = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&_statsMutex);
+    
+    #if !defined(TTP229_NO_KEY_HANDLERS)
+    if (_dispatchTask != NULL) waiting[count++] = _dispatchTask;
     #endif
+    
+    // No FreeRTOS calls inside a critical section
+    for (uint8_t i = 0; i < count; i++) xTaskNotifyGive(waiting[i]);
 }
 
+void TTP229::notifySubscribers(const KeyEvent& event) {
+    // Called by the scan path: our task with _mutex held, or a group task
+    uint16_t typeBit = 1 << event.eventType;
+    uint16_t keyBit = keyToMask(event.key);
+    
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        Subscriber& subscriber = _subscribers[i];
+        TaskHandle_t task = ttp229AtomicLoad(subscriber.task);  // May be freed meanwhile
+        if (task == NULL) continue;
+        if (!(subscriber.eventMask & typeBit) || !(subscriber.keyMask & keyBit)) continue;
+        
+        if (subscriber.events.push(event)) {
+            xTaskNotifyGive(task);
+        } else {
+            portENTER_CRITICAL(&_statsMutex);
+            _stats.missedEvents++;
+            portEXIT_CRITICAL(&_statsMutex);
+        }
+    }
+}
+#endif
+
 bool TTP229::isPressedFromISR() {
     return (_lastValidKey != KEY_NONE);
 }
@@ -1049,79 +2615,74 @@ bool TTP229::wasPressedFromISR() {
 
 void TTP229::setTaskPriority(uint8_t priority) {
     _taskPriority = priority;
-    #if defined(ESP32)
+    #if TTP229_FREERTOS
     if (_taskHandle != NULL) {
         vTaskPrioritySet(_taskHandle, priority);
     }
     #endif
 }
 
-void TTP229::setStackDepth(uint32_t depth) {
+bool TTP229::setStackDepth(uint32_t depth) {
+    #if TTP229_FREERTOS
+    if (_taskHandle != NULL) {
+        TTP229_ERROR("Stack depth of a running task cannot change - call endRTOS() first");
+        return false;
+    }
+    #endif
     _taskStackDepth = depth;
-    // Note: Cannot change stack depth of running task
-}
-
-void TTP229::setQueueSize(uint8_t size) {
-    _queueSize = size;
-    // Note: Queue would need to be recreated to change size
-}
-
-void TTP229::enableEventQueue(bool enable) {
-    _eventQueueEnabled = enable;
+    return true;
 }
 
 bool TTP229::isRTOSEnabled() {
     return _rtosEnabled;
 }
 
-uint32_t TTP229::getQueueCount() {
-    #if defined(ESP32)
-    if (_eventQueue == NULL) return 0;
-    return uxQueueMessagesWaiting(_eventQueue);
-    #else
-    return 0;
-    #endif
-}
 
 TTP229::RTOSStats TTP229::getRTOSStats() {
     RTOSStats stats;
-    #if defined(ESP32)
+    #if TTP229_FREERTOS
     portENTER_CRITICAL(&_statsMutex);
     memcpy(&stats, &_stats, sizeof(RTOSStats));
     portEXIT_CRITICAL(&_statsMutex);
     #else
     memset(&stats, 0, sizeof(RTOSStats));
     #endif
+    stats.wakeups = _wakeCount;
+    stats.wakeLatencyUs = _wakeLatency;
     return stats;
 }
 
 void TTP229::resetRTOSStats() {
-    #if defined(ESP32)
+    #if TTP229_FREERTOS
     portENTER_CRITICAL(&_statsMutex);
     memset(&_stats, 0, sizeof(_stats));
     _lastStatsReset = millis();
     portEXIT_CRITICAL(&_statsMutex);
     #endif
+    _wakeCount = 0;
+    _wakeLatency = 0;
 }
 
 void TTP229::updateStats(uint32_t reads, bool queueFull) {
-    #if defined(ESP32)
-    static uint32_t lastStatUpdate = 0;
-    static uint32_t readCount = 0;
-    
+    #if TTP229_FREERTOS
     uint32_t currentTime = millis();
-    readCount += reads;
+    _statsReadCount += reads;
     
     // Update statistics every second
-    if (timeElapsed(lastStatUpdate, 1000)) {
+    if (timeElapsed(_lastStatUpdate, 1000)) {
+        // Effective scan rate - the scheduler may have changed it mid-second
+        uint32_t elapsed = currentTime - _lastStatUpdate;
+        
         portENTER_CRITICAL(&_statsMutex);
-        _stats.readsPerSecond = readCount;
+        _stats.readsPerSecond = (_lastStatUpdate == 0 || elapsed == 0) ?
+                                _statsReadCount : (_statsReadCount * 1000UL) / elapsed;
+        _stats.scanIntervalMs = _scanInterval;
         if (queueFull) _stats.queueOverflows++;
         _stats.taskRunTime = currentTime - _lastStatsReset;
         portEXIT_CRITICAL(&_statsMutex);
         
-        readCount = 0;
-        lastStatUpdate = currentTime;
+        _statsReadCount = 0;
+        _lastStatUpdate = currentTime;
     }
     #endif
 }
@@ -1,10 +1,24 @@
 #ifndef TTP229_H
 #define TTP229_H
 
-#include <Arduino.h>
+#if defined(TTP229_HOST_SIM)
+  #include "TTP229HostSim.h"
+#else
+  #include <Arduino.h>
+#endif
+#include "TTP229Core.h"
+#include "TTP229EventRing.h"
+#include "TTP229Packed.h"
+#include "TTP229Trace.h"
+#include "TTP229Replay.h"
+
+#if defined(TTP229_HOST_RTOS) && !defined(TTP229_HOST_SIM)
+  #error "TTP229_HOST_RTOS is part of the host simulation - define TTP229_HOST_SIM too"
+#endif
 
 // RTOS detection - automatically detect supported platforms
-#if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_ARCH_MBED) || defined(ARDUINO_ARCH_RP2040)
+#if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_ARCH_MBED) || defined(ARDUINO_ARCH_RP2040) || \
+    defined(TTP229_HOST_RTOS)
   #define TTP229_RTOS_SUPPORT 1
   #if defined(ESP32)
     #include <freertos/FreeRTOS.h>
@@ -16,6 +30,121 @@
   #define TTP229_RTOS_SUPPORT 0
 #endif
 
+// FreeRTOS scan task, mutex and task notifications: ESP32, and the host
+// simulation's stand-in (TTP229HostRTOS.h)
+#if TTP229_RTOS_SUPPORT && (defined(ESP32) || defined(TTP229_HOST_RTOS))
+  #define TTP229_FREERTOS 1
+#else
+  #define TTP229_FREERTOS 0
+#endif
+
+// Interrupt handlers must live in IRAM on Espressif chips
+#if defined(ESP32) || defined(ESP8266)
+  #define TTP229_ISR_ATTR IRAM_ATTR
+#else
+  #define TTP229_ISR_ATTR
+#endif
+
+// Hardware SPI read backend - needs the core's SPI library.
+// Define TTP229_NO_SPI to leave SPI out of the build.
+#if !defined(TTP229_NO_SPI) && !defined(TTP229_HOST_SIM) && defined(__has_include)
+  #if __has_include(<SPI.h>)
+    #define TTP229_SPI_SUPPORT 1
+  #endif
+#endif
+#ifndef TTP229_SPI_SUPPORT
+  #define TTP229_SPI_SUPPORT 0
+#endif
+
+// Event ring storage per keypad (power of two, max 128).
+// setQueueSize() picks the usable size up to this capacity.
+#ifndef TTP229_EVENT_QUEUE_CAPACITY
+  #if defined(ARDUINO_ARCH_AVR)
+    #define TTP229_EVENT_QUEUE_CAPACITY 8
+  #else
+    #define TTP229_EVENT_QUEUE_CAPACITY 32
+  #endif
+#endif
+
+// Accepted key changes remembered for Reader cursors (power of two).
+// A reader that falls further behind is resynchronized and counts a miss.
+#ifndef TTP229_STATE_HISTORY
+  #define TTP229_STATE_HISTORY 16
+#endif
+
+// Define TTP229_EVENT_TIMING to add edgeMicros, acceptMicros and
+// scanSequence to every KeyEvent (12 bytes more per queued event): when
+// a change was first seen and when debouncing accepted it. Pass it as a
+// compiler flag so the library and the sketch agree.
+
+// Raw frame trace for offline analysis: the last TTP229_TRACE_DEPTH
+// frames (power of two) with micros() stamps, 6 bytes each. 0 = off.
+#ifndef TTP229_TRACE_DEPTH
+  #define TTP229_TRACE_DEPTH 0
+#endif
+
+// Debug output compiled in; begin(true) turns it on at run time.
+//   0  none - no strings, no _debug tests, no log ring
+//   1  errors (default)
+//   2  + warnings
+//   3  + status messages and printDebugInfo()
+//   4  + scan-path trace: accepted key changes, queued events
+// Messages from the scan path are queued as binary records and printed
+// later by printLog(), never inside the scan or under the mutex.
+#ifndef TTP229_LOG_LEVEL
+  #define TTP229_LOG_LEVEL 1
+#endif
+
+// Scan-path log records waiting for printLog() (power of two, max 128).
+// 8 bytes each; when full, new records are counted and dropped.
+#ifndef TTP229_LOG_DEPTH
+  #if defined(ARDUINO_ARCH_AVR)
+    #define TTP229_LOG_DEPTH 8
+  #else
+    #define TTP229_LOG_DEPTH 32
+  #endif
+#endif
+
+// Stack of the ESP32 log task that drains the ring in RTOS debug mode
+#ifndef TTP229_LOG_TASK_STACK
+  #define TTP229_LOG_TASK_STACK 2048
+#endif
+
+// Define TTP229_PACKED_QUEUE to keep queued events as 4-byte
+// TTP229PackedEvent words instead of full KeyEvents. getKeyEvents() then
+// returns key, type, timestamp, row and col; data and the micros()
+// fields read 0.
+
+// Wake-on-touch sleep: ESP32 light/deep sleep, AVR idle/power-down,
+// RP2040 WFE/dormant and the host simulation
+#if defined(TTP229_HOST_SIM) || defined(ESP32) || defined(ARDUINO_ARCH_AVR) || \
+    (defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED))
+  #define TTP229_SLEEP_SUPPORT 1
+#else
+  #define TTP229_SLEEP_SUPPORT 0
+#endif
+
+// Events buffered per waitForEvent() subscriber (power of two)
+#ifndef TTP229_SUBSCRIBER_QUEUE_DEPTH
+  #define TTP229_SUBSCRIBER_QUEUE_DEPTH 4
+#endif
+
+// SPI clock for the SPI backend (TTP229 accepts up to 512kHz)
+#ifndef TTP229_SPI_CLOCK_HZ
+  #define TTP229_SPI_CLOCK_HZ 250000
+#endif
+
+// beginRTOS(storage): task and mutex in caller-owned memory
+#if TTP229_FREERTOS && configSUPPORT_STATIC_ALLOCATION
+  #define TTP229_STATIC_RTOS 1
+#else
+  #define TTP229_STATIC_RTOS 0
+#endif
+
+#if TTP229_RTOS_SUPPORT
+class TTP229Group;
+#endif
+
 class TTP229 {
 public:
     // ==============================================
@@ -45,10 +174,25 @@ public:
     // Timing constants
     static const uint16_t DEFAULT_HOLD_THRESHOLD_MS = 1000;
     static const uint16_t DEFAULT_LONG_PRESS_THRESHOLD_MS = 2000;
+    static const uint16_t DEFAULT_TAP_MS = 250;          // Longest press that counts as a tap
+    static const uint16_t DEFAULT_MULTI_TAP_MS = 300;    // Longest gap between taps
+    static const uint16_t DEFAULT_SWIPE_STEP_MS = 200;   // Longest gap between swipe keys
+    static const uint16_t DEFAULT_CHORD_MS = 80;         // Window to touch all chord keys
+    static const uint8_t DEFAULT_SWIPE_KEYS = 3;
     
     // Position constants
     static const uint8_t POSITION_INVALID = 255;
     
+    // Keypads that can use interrupt mode at the same time
+    static const uint8_t MAX_INTERRUPT_INSTANCES = 4;
+    
+    // How readRawMask() clocks the frame out
+    enum ReadBackend : uint8_t {
+        BACKEND_BITBANG = 0,   // GPIO toggling (any pins)
+        BACKEND_SPI = 1,       // Hardware SPI, mode 3, MISO only
+        BACKEND_REPLAY = 2     // Recorded or synthetic frames, see begin(TTP229ReplaySource&)
+    };
+    
     // Constructors
     TTP229();                                       // Auto-detect, 16-key mode
     TTP229(bool is16KeyMode);                       // Auto-detect with mode
@@ -65,9 +209,33 @@ public:
     // Initialization
     bool begin();                      // Returns true if successful
     bool begin(bool debugMode);        // Returns true if successful
+    bool begin(ReadBackend backend, bool debugMode = false);  // Falls back to bit-bang
+    bool begin(TTP229ReplaySource& source, bool debugMode = false);  // No pins: scans read source
     
     // RTOS Initialization
     #if TTP229_RTOS_SUPPORT
+    #if TTP229_STATIC_RTOS
+    // Memory for beginRTOS() without heap allocation. Must stay valid
+    // until endRTOS(); one per keypad.
+    struct RTOSStorage {
+        StaticTask_t task;
+        StaticSemaphore_t mutex;
+        StackType_t* stack;        // Scan task stack
+        uint32_t stackDepth;       // In StackType_t units (bytes on ESP32)
+    };
+    
+    // RTOSStorage with the stack inside: static TTP229::RTOSBuffers<4096> buffers;
+    template <uint32_t StackDepth>
+    struct RTOSBuffers : RTOSStorage {
+        StackType_t stackBuffer[StackDepth];
+        RTOSBuffers() {
+            stack = stackBuffer;
+            stackDepth = StackDepth;
+        }
+    };
+    
+    bool beginRTOS(RTOSStorage& storage, bool createTask = true);  // No heap use
+    #endif
     bool beginRTOS(bool createTask = true);  // Returns true if successful
     void endRTOS();
     void stopRTOS();                    // Gracefully stop RTOS task
@@ -75,6 +243,7 @@ public:
     
     // Key reading - available on all platforms
     uint8_t read();                    // Read key with debouncing
+    void service();                    // Scan + events only, e.g. from a timer ISR
     uint8_t getKey();                  // Get current key (1-16/1-8)
     uint8_t getKeyNumber();            // Get key number (0-15 for 16-key, 0-7 for 8-key)
     void getPosition(uint8_t &row, uint8_t &col);  // Get row/col (0-based)
@@ -85,49 +254,285 @@ public:
     bool wasPressed();                 // Key just pressed?
     bool wasReleased();                // Key just released?
     
+    // Multi-touch (bitmask) access - bit 0 = key 1 ... bit 15 = key 16
+    uint16_t readRawMask();            // Clock out one raw frame (no debounce)
+    uint16_t getKeyMask();             // Debounced state of all keys
+    uint16_t getPressedMask();         // Keys that went down on the last scan
+    uint16_t getReleasedMask();        // Keys that went up on the last scan
+    static uint16_t keyToMask(uint8_t key);   // Key (1-16) to bit, 0 if invalid
+    static uint8_t maskToKey(uint16_t mask);  // Highest pressed key, KEY_NONE if empty
+    
+    // Snapshot of the debounced state, published by the scan path on
+    // every change. Wait-free to read from any task or ISR: no mutex, and
+    // never a torn or half-updated state.
+    typedef struct {
+        uint16_t mask;          // Keys held (bit 0 = key 1)
+        uint16_t pressed;       // Keys that went down in this change
+        uint16_t released;      // Keys that went up in this change
+        uint8_t key;            // Highest held key, as read() returns
+        uint32_t scanSequence;  // Frame that made the change (see getScanSequence())
+        uint32_t timestamp;     // millis() of the change
+    } KeyState;
+    
+    KeyState getKeyState();
+    
+    // Edge tracking per consumer. Each task, ISR or module takes its own
+    // Reader; update() replays every change since its previous call from
+    // the change history, so no consumer steals another's edges and none
+    // is seen twice. Wait-free, no allocation - copy it freely.
+    class Reader {
+    public:
+        Reader() : _keypad(NULL), _change(0), _mask(0), _pressed(0), _released(0), _missed(0) {}
+        
+        uint8_t update();               // Catch up; returns the current key like read()
+        uint8_t getKey() const { return maskToKey(_mask); }
+        uint16_t getKeyMask() const { return _mask; }
+        uint16_t getPressedMask() const { return _pressed; }    // Went down since the previous update()
+        uint16_t getReleasedMask() const { return _released; }  // Went up since the previous update()
+        bool isKeyPressed(uint8_t key) const { return (_mask & keyToMask(key)) != 0; }
+        bool wasPressed() const { return _pressed != 0; }
+        bool wasReleased() const { return _released != 0; }
+        uint16_t getMissed() const { return _missed; }          // Times it fell behind the history
+        
+    private:
+        friend class TTP229;
+        explicit Reader(TTP229* keypad);
+        
+        TTP229* _keypad;
+        uint16_t _change;    // Last change taken in
+        uint16_t _mask;
+        uint16_t _pressed;
+        uint16_t _released;
+        uint16_t _missed;
+    };
+    
+    Reader reader();                    // Starts at the current state, no edges
+    
     // Configuration - available on all platforms
     bool setMode(bool is16KeyMode);    // Change mode (8/16 key)
     bool setDebounce(uint16_t ms);     // Set debounce time (default: 20-50ms)
+    bool setDebounce(uint8_t pressScans, uint8_t releaseScans);  // Per direction, 1-7 scans
     bool setScanInterval(uint16_t ms); // Set scan interval (default: 10-50ms)
+    bool setScanPolicy(uint16_t idleMs, uint16_t activeMs, uint16_t quietMs);  // Adaptive rate
     bool setTiming(uint16_t clkDelay, uint16_t readDelay); // Advanced timing (microseconds)
 	
 	bool setHoldThreshold(uint16_t holdMs, uint16_t longPressMs = DEFAULT_LONG_PRESS_THRESHOLD_MS);
     
+    // Typematic auto-repeat: EVENT_REPEAT after delayMs, then every
+    // intervalMs, each repeat 1/8 sooner down to fastestMs (0 = no
+    // acceleration). delayMs = 0 turns it off (default).
+    bool setAutoRepeat(uint16_t delayMs, uint16_t intervalMs,
+                       uint16_t fastestMs = 0, uint16_t keyMask = 0xFFFF);
+    
+    // Scan only when the chip pulls SDO low (data valid) instead of every
+    // scan interval. Call after begin(); SDO must be interrupt-capable.
+    bool enableInterruptMode(bool enable = true);
+    
+    // ==============================================
+    // LOW POWER - wake on touch
+    // ==============================================
+    
+    enum SleepMode : uint8_t {
+        SLEEP_LIGHT = 0,   // RAM and peripherals kept, returns on touch
+        SLEEP_DEEP = 1     // Lowest power; ESP32 restarts, begin() picks up the touch
+    };
+    
+    // Sleep until the chip signals a touch on SDO, then scan at once so
+    // the waking touch becomes the first event. Returns false if the board
+    // cannot wake from SDO, a key is still down or something else woke it.
+    bool sleepUntilTouch(SleepMode mode = SLEEP_LIGHT);
+    bool wokeByTouch();                // Last wake (or ESP32 boot) came from the keypad
+    uint32_t getWakeLatency();         // Wake -> first event queued (microseconds)
+    
     // Information - available on all platforms
     const char* getBoardName();
+    const char* getGpioBackendName();  // Pin access method chosen at begin()
+    ReadBackend getReadBackend();      // Backend actually in use
+    uint16_t getScanInterval();        // Interval in use now (follows the scan policy)
+    uint32_t getScanSequence();        // Frames processed so far, +1 per scan
     uint8_t getSCLPin();
     uint8_t getSDOPin();
     bool is16KeyMode();
     bool isInitialized();
+    bool isInterruptMode();
     
     // Debug - available on all platforms
     void printDebugInfo();
     void printRawReadings();
     
+    // Prints the scan-path messages queued since the last call (see
+    // TTP229_LOG_LEVEL). A polling read() calls it before each scan, and
+    // on ESP32 a low-priority log task does when the scan task runs in
+    // debug mode. Otherwise (service(), a TTP229Group, beginRTOS(storage))
+    // call it from one task only, e.g. loop(). Returns the messages
+    // printed; 0 while the log task owns the queue.
+    size_t printLog();
+    
+    // Raw frame trace (TTP229_TRACE_DEPTH > 0). The scan path records
+    // every frame before debouncing; dump it and replay it on a PC with
+    // extras/host/ttp229_trace.cpp.
+    #if TTP229_TRACE_DEPTH > 0
+    void enableTrace(bool enable = true);  // Recording is on by default
+    void clearTrace();
+    uint16_t getTraceCount();              // Frames held, up to TTP229_TRACE_DEPTH
+    
+    // Binary dump (format in TTP229Trace.h), oldest frame first, to
+    // anything with write(buffer, length) - Serial, a File, a socket.
+    // Recording pauses meanwhile. Returns the bytes written.
+    template <typename Output>
+    size_t dumpTrace(Output& out);
+    #endif
+    
+    // RAM used by this keypad, in bytes
+    typedef struct {
+        uint32_t object;           // sizeof(TTP229), event ring included
+        uint32_t eventRing;        // ...of which event ring storage
+        uint32_t taskStack;        // Scan task stack
+        uint32_t rtosObjects;      // Task control block and mutex
+        uint32_t heap;             // Stack + RTOS objects taken from the heap
+        uint32_t total;            // object + taskStack + rtosObjects
+    } MemoryFootprint;
+    
+    MemoryFootprint getMemoryFootprint();
+    
     // ==============================================
-    // RTOS-SPECIFIC METHODS (only on RTOS platforms)
+    // KEY EVENTS - available on all platforms
     // ==============================================
-    #if TTP229_RTOS_SUPPORT
     
-    // Event structure for RTOS queue
+    // Event structure for the event queue
     typedef struct {
         uint8_t key;           // Key number (1-16 or 1-8)
         uint8_t eventType;     // Event type (see constants below)
         uint32_t timestamp;    // Time when event occurred (milliseconds)
         uint8_t row;           // Row (0-based)
         uint8_t col;           // Column (0-based)
+        uint16_t data;         // Gestures: tap count, swipe speed (keys/s), chord key mask
+        #if defined(TTP229_EVENT_TIMING)
+        uint32_t edgeMicros;   // micros() of the first raw frame that showed the change
+        uint32_t acceptMicros; // micros() of the frame that passed debouncing
+        uint32_t scanSequence; // Number of that frame (see getScanSequence())
+        #endif
     } KeyEvent;
     
     // Event type constants
-    static const uint8_t EVENT_PRESS = 0;
-    static const uint8_t EVENT_RELEASE = 1;
-    static const uint8_t EVENT_HOLD = 2;
-    static const uint8_t EVENT_LONG_PRESS = 3;
+    static const uint8_t EVENT_PRESS = TTP229_EVENT_PRESS;
+    static const uint8_t EVENT_RELEASE = TTP229_EVENT_RELEASE;
+    static const uint8_t EVENT_HOLD = TTP229_EVENT_HOLD;
+    static const uint8_t EVENT_LONG_PRESS = TTP229_EVENT_LONG_PRESS;
+    static const uint8_t EVENT_REPEAT = TTP229_EVENT_REPEAT;
+    static const uint8_t EVENT_DOUBLE_TAP = TTP229_EVENT_DOUBLE_TAP;
+    static const uint8_t EVENT_MULTI_TAP = TTP229_EVENT_MULTI_TAP;
+    static const uint8_t EVENT_SWIPE_LEFT = TTP229_EVENT_SWIPE_LEFT;
+    static const uint8_t EVENT_SWIPE_RIGHT = TTP229_EVENT_SWIPE_RIGHT;
+    static const uint8_t EVENT_SWIPE_UP = TTP229_EVENT_SWIPE_UP;
+    static const uint8_t EVENT_SWIPE_DOWN = TTP229_EVENT_SWIPE_DOWN;
+    static const uint8_t EVENT_CHORD = TTP229_EVENT_CHORD;
+    
+    // Event type filters for waitForEvent() and enableGestures()
+    static const uint16_t EVENT_MASK_PRESS = 1 << TTP229_EVENT_PRESS;
+    static const uint16_t EVENT_MASK_RELEASE = 1 << TTP229_EVENT_RELEASE;
+    static const uint16_t EVENT_MASK_HOLD = 1 << TTP229_EVENT_HOLD;
+    static const uint16_t EVENT_MASK_LONG_PRESS = 1 << TTP229_EVENT_LONG_PRESS;
+    static const uint16_t EVENT_MASK_REPEAT = 1 << TTP229_EVENT_REPEAT;
+    static const uint16_t EVENT_MASK_DOUBLE_TAP = 1 << TTP229_EVENT_DOUBLE_TAP;
+    static const uint16_t EVENT_MASK_MULTI_TAP = 1 << TTP229_EVENT_MULTI_TAP;
+    static const uint16_t EVENT_MASK_SWIPE = 0x0F << TTP229_EVENT_SWIPE_LEFT;  // All four directions
+    static const uint16_t EVENT_MASK_CHORD = 1 << TTP229_EVENT_CHORD;
+    static const uint16_t EVENT_MASK_KEYS = 0x001F;       // Press, release, hold, long press, repeat
+    static const uint16_t EVENT_MASK_GESTURES = 0x0FE0;
+    static const uint16_t EVENT_MASK_ALL = 0x0FFF;
+    
+    // What happens to a new event when the queue is full
+    enum OverflowPolicy : uint8_t {
+        OVERFLOW_DROP_NEWEST = 0,   // Keep the queued events (default)
+        OVERFLOW_DROP_OLDEST = 1,   // Replace the oldest queued event
+        OVERFLOW_COALESCE = 2       // Keep only the latest event per key until space frees up
+    };
+    
+    bool getKeyEvents(KeyEvent &event);              // Oldest event (non-blocking)
+    size_t getKeyEvents(KeyEvent* events, size_t maxEvents);  // Batch drain, returns count
+    uint32_t getQueueCount();
+    uint32_t getQueueOverflows();                    // Events dropped or coalesced
+    bool setQueueSize(uint8_t size);                 // Power of two, resizes live
+    uint8_t getQueueSize();                          // Usable size after rounding
+    void setOverflowPolicy(OverflowPolicy policy);
+    void enableEventQueue(bool enable = true);
+    
+    // Drain the queue into a packed batch (see TTP229Packed.h) for a
+    // radio or serial uplink: 6 + 4 bytes per event, up to 255 events.
+    // Returns the bytes written, 0 if no events or the buffer is too small.
+    size_t encodeEvents(uint8_t* buffer, size_t size);
+    
+    // ==============================================
+    // GESTURES - available on all platforms
+    // ==============================================
+    // Define TTP229_NO_GESTURES to leave the recognizer out.
+    #if !defined(TTP229_NO_GESTURES)
+    
+    // Gesture events are off until enabled. Pass the gesture types to
+    // report (EVENT_MASK_DOUBLE_TAP, ... or EVENT_MASK_GESTURES), 0 = off.
+    bool enableGestures(uint16_t gestures = EVENT_MASK_GESTURES);
+    bool setGestureTiming(uint16_t tapMs, uint16_t multiTapMs,
+                          uint16_t swipeStepMs, uint16_t chordMs);
+    bool setSwipeLength(uint8_t keys);   // Keys a swipe must cross, 2-4
+    
+    #endif // TTP229_NO_GESTURES
+    
+    // ==============================================
+    // KEY HANDLERS - available on all platforms
+    // ==============================================
+    // Define TTP229_NO_KEY_HANDLERS to leave the handler table out.
+    #if !defined(TTP229_NO_KEY_HANDLERS)
+    
+    typedef void (*KeyHandler)(const KeyEvent& event);
+    
+    static const uint8_t KEY_ANY = 0;              // Handler for every key
+    static const uint8_t HANDLER_EVENT_TYPES = 5;  // Press, release, hold, long press, repeat
+    
+    // Where handlers run
+    enum DispatchMode : uint8_t {
+        DISPATCH_DEFERRED = 0,   // In dispatchEvents(), e.g. from loop() (default)
+        DISPATCH_IMMEDIATE = 1   // In the scan path (task, read() or timer ISR)
+    };
+    
+    // One handler per key and event type; NULL removes it. The key's own
+    // handler runs first, then the KEY_ANY one.
+    bool onPress(uint8_t key, KeyHandler handler);
+    bool onRelease(uint8_t key, KeyHandler handler);
+    bool onHold(uint8_t key, KeyHandler handler);
+    bool onLongPress(uint8_t key, KeyHandler handler);
+    bool onRepeat(uint8_t key, KeyHandler handler);
+    bool onEvent(uint8_t key, uint8_t eventType, KeyHandler handler);
+    #if !defined(TTP229_NO_GESTURES)
+    bool onGesture(uint8_t eventType, KeyHandler handler);   // Any key, one per gesture type
+    #endif
+    void clearHandlers();
+    
+    // dispatchEvents() takes its events from the event queue, so use it
+    // or getKeyEvents(), not both. It waits up to waitMs for the first one.
+    void setDispatchMode(DispatchMode mode);
+    size_t dispatchEvents(uint32_t waitMs = 0);   // Run handlers for pending events
+    
+    #endif // TTP229_NO_KEY_HANDLERS
+    
+    // ==============================================
+    // RTOS-SPECIFIC METHODS (only on RTOS platforms)
+    // ==============================================
+    #if TTP229_RTOS_SUPPORT
     
     // RTOS-specific reading methods
     uint8_t readFromISR();                    // Safe to call from interrupt context
-    uint8_t readWithTimeout(uint32_t timeoutMs); // Blocking read with timeout
-    bool getKeyEvents(KeyEvent &event);       // Get event from queue (non-blocking)
+    uint8_t readWithTimeout(uint32_t timeoutMs); // Next press (waitForEvent, press only)
+    
+    // Block the calling task until an event passes its filter (event types
+    // and keys, bit 0 = key 1). The first call subscribes the task; from
+    // then on its matching events are buffered for it, so none are lost
+    // between calls. Up to MAX_SUBSCRIBERS tasks, each woken by a
+    // direct-to-task notification with its own copy of the event.
+    static const uint8_t MAX_SUBSCRIBERS = 4;
+    bool waitForEvent(KeyEvent& event, uint32_t timeoutMs,
+                      uint16_t eventMask = EVENT_MASK_ALL, uint16_t keyMask = 0xFFFF);
+    void unsubscribe();                       // Calling task stops receiving events
     
     // RTOS state checking
     bool isPressedFromISR();
@@ -135,21 +540,23 @@ public:
     
     // RTOS configuration
     void setTaskPriority(uint8_t priority);
-    void setStackDepth(uint32_t depth);
-    void setQueueSize(uint8_t size);
-    void enableEventQueue(bool enable = true);
+    bool setStackDepth(uint32_t depth);      // Before beginRTOS() only
     
     // RTOS information
     bool isRTOSEnabled();
-    uint32_t getQueueCount();
     
     // RTOS statistics
     typedef struct {
         uint32_t readsPerSecond;   // Average reads per second
         uint32_t queueOverflows;   // Number of times queue was full
-        uint32_t missedEvents;     // Events that couldn't be queued
+        uint32_t missedEvents;     // Subscriber events dropped (its buffer was full)
         uint32_t taskRunTime;      // How long RTOS task has been running (ms)
         uint32_t maxQueueUsage;    // Maximum number of events in queue
+        uint32_t mutexContentions; // Mutex was held by another task on entry
+        uint32_t mutexTimeouts;    // ...and could not be taken in time
+        uint32_t scanIntervalMs;   // Scan interval in use (idle or active rate)
+        uint32_t wakeups;          // sleepUntilTouch() wake-ups
+        uint32_t wakeLatencyUs;    // Last wake -> first event queued
     } RTOSStats;
     
     RTOSStats getRTOSStats();
@@ -169,35 +576,175 @@ private:
     uint8_t _currentKey;
     uint8_t _lastKey;
     uint8_t _lastValidKey;
-    unsigned long _lastDebounceTime;
     unsigned long _lastReadTime;
     
-    // Debounce state (moved from static to instance)
-    uint8_t _lastRawKey;
-    uint8_t _stableKey;
-    unsigned long _lastChangeTime;
+    // Key bitmask state (bit 0 = key 1)
+    uint16_t _currentMask;   // Latest debounced frame
+    uint16_t _keyMask;       // Accepted key state
+    uint16_t _lastKeyMask;   // Accepted key state before the last scan
+    
+    // Published KeyState, double-buffered. _stateSequence is odd while the
+    // scan path fills the spare slot; readers copy slot (sequence / 2) & 1.
+    KeyState _states[2];
+    volatile uint16_t _stateSequence;
+    
+    // Mask after each published change, by change number
+    // (_stateSequence / 2), for Reader cursors
+    static_assert((TTP229_STATE_HISTORY & (TTP229_STATE_HISTORY - 1)) == 0 &&
+                  TTP229_STATE_HISTORY >= 2 && TTP229_STATE_HISTORY <= 128,
+                  "TTP229_STATE_HISTORY must be a power of two between 2 and 128");
+    volatile uint16_t _maskHistory[TTP229_STATE_HISTORY];
+    
+    // Frame counter and, with TTP229_EVENT_TIMING, when the recent frames
+    // were read.
+    uint32_t _scanSequence;
+    #if defined(TTP229_EVENT_TIMING)
+    static const uint8_t FRAME_HISTORY = 8;   // Power of two, > TTP229Debouncer::MAX_SCANS
+    uint32_t _frameMicros[FRAME_HISTORY];     // By sequence number
+    uint32_t _acceptSequence;  // Frame where the debounced state last changed
+    uint8_t _pressLag;         // Frames from the first touched frame to that one
+    uint8_t _releaseLag;
+    #endif
+    
+    // Raw frame trace, written by the scan path only
+    #if TTP229_TRACE_DEPTH > 0
+    static_assert((TTP229_TRACE_DEPTH & (TTP229_TRACE_DEPTH - 1)) == 0 &&
+                  TTP229_TRACE_DEPTH <= 16384,
+                  "TTP229_TRACE_DEPTH must be a power of two up to 16384");
+    uint32_t _traceMicros[TTP229_TRACE_DEPTH];
+    uint16_t _traceMasks[TTP229_TRACE_DEPTH];
+    volatile uint32_t _traceTotal;       // Frames recorded since clearTrace()
+    uint32_t _traceLastSequence;         // Scan sequence of the newest frame
+    volatile bool _traceEnabled;
+    #endif
+    
+    // Deferred debug output: the scan path queues fixed binary records,
+    // printLog() formats them. Producer = scan path, consumer = printLog().
+    #if TTP229_LOG_LEVEL > 0
+    enum LogCode : uint8_t {
+        LOG_QUEUE_FULL,      // key, event type
+        LOG_MUTEX_TIMEOUT,
+        LOG_TASK_START,
+        LOG_TASK_STOP,
+        LOG_KEY_CHANGE,      // accepted mask
+        LOG_EVENT,           // key, event type
+        LOG_SCAN_KEY         // key, queue count
+    };
+    typedef struct {
+        uint32_t micros;
+        uint8_t code;        // LogCode
+        uint8_t key;
+        uint16_t value;
+    } LogRecord;
+    TTP229EventRing<LogRecord, TTP229_LOG_DEPTH> _log;
+    volatile uint16_t _logDropped;   // Written by the scan path only
+    uint16_t _logDroppedShown;       // Written by printLog() only
+    #endif
+    
+    // Per-key vertical counter debouncer (thresholds in scans)
+    TTP229Debouncer _debouncer;
+    bool _debounceInScans;   // Set by setDebounce(press, release)
     
     // Timing
     uint16_t _debounceDelay;
-    uint16_t _scanInterval;
+    uint16_t _scanInterval;        // Current interval, set by the scan policy
+    
+    // Adaptive scan policy: idle rate until a key is touched, active rate
+    // until the keypad has been quiet for _quietPeriod (equal = fixed rate)
+    uint16_t _idleScanInterval;
+    uint16_t _activeScanInterval;
+    uint16_t _quietPeriod;
+    unsigned long _lastActiveTime;
     uint16_t _clkDelay;     // microseconds
     uint16_t _readDelay;    // microseconds
     
     // Board information
     const char* _boardName;
     
+    // Register-level pin access, resolved in begin()
+    TTP229Gpio _gpio;
+    
+    // Frame read backend
+    ReadBackend _backend;
+    TTP229ReplaySource* _replay;    // BACKEND_REPLAY only
+    
+    // Interrupt-driven scanning (data-valid edge on SDO)
+    bool _interruptMode;
+    int8_t _isrSlot;
+    volatile bool _dataReady;   // Set by ISR, cleared when a scan starts
+    volatile bool _scanning;    // Our own clocking toggles SDO - ignore it
+    static TTP229* _isrInstances[MAX_INTERRUPT_INSTANCES];
+    
+    // Wake on touch
+    bool _wokeByTouch;
+    uint32_t _wakeCount;
+    uint32_t _wakeLatency;      // microseconds
+    
+    // Press/release/hold/repeat event generator, thresholds included
+    TTP229EventMachine _eventMachine;
+    volatile bool _serviceMode;     // service() scans, read() only reports
+    
+    // Event queue: lock-free SPSC ring, producer = scan path
+    #if defined(TTP229_PACKED_QUEUE)
+    typedef TTP229PackedEvent QueueEntry;
+    static QueueEntry toQueueEntry(const KeyEvent& event) {
+        return TTP229PackedEvent::pack(event.key, event.eventType, event.timestamp);
+    }
+    void fromQueueEntry(const QueueEntry& entry, KeyEvent& event);
+    #else
+    typedef KeyEvent QueueEntry;
+    static const KeyEvent& toQueueEntry(const KeyEvent& event) { return event; }
+    static void fromQueueEntry(const KeyEvent& entry, KeyEvent& event) { event = entry; }
+    #endif
+    TTP229EventRing<QueueEntry, TTP229_EVENT_QUEUE_CAPACITY> _events;
+    uint8_t _queueSize;
+    bool _eventQueueEnabled;
+    OverflowPolicy _overflowPolicy;
+    uint16_t _coalescedMask;        // Keys with an event waiting for space
+    uint8_t _coalescedType[16];     // Latest event type per waiting key
+    uint32_t _queueOverflows;       // Events dropped or coalesced
+    
+    // Taps, swipes and chords on top of the event machine
+    #if !defined(TTP229_NO_GESTURES)
+    TTP229GestureRecognizer _gestures;
+    #endif
+    
+    // Handler table, [event type][key], key 0 = any key
+    #if !defined(TTP229_NO_KEY_HANDLERS)
+    KeyHandler _handlers[HANDLER_EVENT_TYPES][17];
+    #if !defined(TTP229_NO_GESTURES)
+    KeyHandler _gestureHandlers[TTP229_EVENT_TYPES - HANDLER_EVENT_TYPES];
+    #endif
+    DispatchMode _dispatchMode;
+    #endif
+    
     // ==============================================
     // RTOS-SPECIFIC PRIVATE MEMBERS
     // ==============================================
     #if TTP229_RTOS_SUPPORT
     
-    // RTOS handles (ESP32/FreeRTOS specific)
-    #if defined(ESP32)
+    // FreeRTOS handles (ESP32, host simulation)
+    #if TTP229_FREERTOS
     TaskHandle_t _taskHandle;
-    QueueHandle_t _eventQueue;
+    TaskHandle_t _logTaskHandle;  // Prints the log ring in debug mode
+    volatile TaskHandle_t _dispatchTask;  // dispatchEvents() waiting for an event
     SemaphoreHandle_t _mutex;
-    SemaphoreHandle_t _readSemaphore;
     portMUX_TYPE _statsMutex;
+    
+    // waitForEvent() subscribers, each with its own SPSC ring:
+    // producer = scan path (our task or a TTP229Group's), consumer = the
+    // subscribed task. Slots are claimed and freed under _statsMutex,
+    // since a grouped keypad has no _mutex.
+    struct Subscriber {
+        TaskHandle_t task;      // NULL: free slot
+        uint16_t eventMask;
+        uint16_t keyMask;
+        TTP229EventRing<KeyEvent, TTP229_SUBSCRIBER_QUEUE_DEPTH> events;
+    };
+    Subscriber _subscribers[MAX_SUBSCRIBERS];
+    #endif
+    #if TTP229_STATIC_RTOS
+    RTOSStorage* _rtosStorage;   // NULL: handles come from the heap
     #endif
     
     // RTOS configuration
@@ -205,15 +752,6 @@ private:
     volatile bool _taskRunning;  // Flag to control RTOS task execution
     uint8_t _taskPriority;
     uint32_t _taskStackDepth;
-    uint8_t _queueSize;
-    bool _eventQueueEnabled;
-    uint32_t _holdThreshold;        // Hold detection threshold (ms)
-    
-    // Hold detection state
-    volatile uint8_t _lastHoldKey;
-    volatile uint32_t _holdStartTime;
-	volatile bool _holdEventSent;      // NEW: Track if HOLD event was sent
-	volatile bool _longPressEventSent; // NEW: Track if LONG_PRESS event was sent
     
     // ISR-safe state tracking
     volatile uint8_t _lastKeyFromISR;
@@ -221,12 +759,25 @@ private:
     // Statistics
     RTOSStats _stats;
     uint32_t _lastStatsReset;
+    uint32_t _lastStatUpdate;     // Per instance - not shared between keypads
+    uint32_t _statsReadCount;
+    
+    // Set when a TTP229Group scans this keypad from its shared task
+    TTP229Group* _group;
+    uint8_t _groupId;
+    friend class TTP229Group;
     
     // RTOS internal methods
+    bool startRTOS(bool createTask);
     static void rtosTask(void* parameter);
-    void processKeyEvents();
-    void addEventToQueue(uint8_t key, uint8_t eventType);
-    bool takeMutex(uint32_t timeout = portMAX_DELAY);
+    static void logTask(void* parameter);
+    bool takeMutex(uint32_t timeout = 0xFFFFFFFF);  // Default: wait forever
+    #if TTP229_FREERTOS
+    Subscriber* subscribe(uint16_t eventMask, uint16_t keyMask);
+    void notifySubscribers(const KeyEvent& event);
+    void releaseSubscribers();   // Waiters return false
+    bool scannedByTask();        // Our scan task or a TTP229Group's
+    #endif
     void giveMutex();
     void updateStats(uint32_t reads, bool queueFull);
     
@@ -234,16 +785,101 @@ private:
     
     // Internal methods (available on all platforms)
     uint8_t readRaw();
-    uint8_t readDebounced();
+    void processFrame(uint16_t rawMask);  // Debounce a frame and emit events
+    void processKeyEvents();
+    void publishState(uint16_t previousMask, uint32_t now);
+    bool deadlineDue(uint32_t now);       // A hold, repeat or gesture timer has expired
+    uint32_t msUntilDeadline();           // 0xFFFFFFFF: none pending
+    void emitEvent(uint8_t key, uint8_t eventType, uint16_t data = 0);  // Event machine sink
+    void addEventToQueue(uint8_t key, uint8_t eventType, uint16_t data = 0);
+    void queueEvent(const KeyEvent& event);
+    void flushCoalesced();
+    #if TTP229_LOG_LEVEL > 0
+    void logRecord(uint8_t code, uint8_t key = 0, uint16_t value = 0);  // Scan path only
+    size_t drainLog();
+    #endif
+    #if defined(TTP229_EVENT_TIMING)
+    void stampEvent(KeyEvent& event, bool fromScan);
+    #endif
+    bool pollEvent(KeyEvent& event, uint32_t timeoutMs, uint16_t eventMask, uint16_t keyMask);
+    bool takeEvent(KeyEvent& event, uint16_t eventMask, uint16_t keyMask);
+    #if !defined(TTP229_NO_KEY_HANDLERS)
+    bool callHandlers(const KeyEvent& event);  // true if any handler ran
+    bool hasHandler(const KeyEvent& event);
+    #endif
     void getPositionInternal(uint8_t key, uint8_t *row, uint8_t *col);
     void detectBoard();
     void setBoardDefaults();
     void initializeState();
+    void applyDebounceTime();  // Debounce ms -> scans at the scan interval
+    void updateScanRate(uint16_t rawMask);  // Pick idle or active interval
+    #if TTP229_RTOS_SUPPORT
+    void initializeRTOSState(uint8_t taskPriority, uint32_t stackDepth);
+    #endif
     bool isValidPin(uint8_t pin);
     bool validateTiming(uint16_t clkDelay, uint16_t readDelay);
     
+    // SPI backend
+    bool beginSPI();
+    void endSPI();
+    uint16_t readFrameSPI();
+    
+    // Interrupt mode helpers
+    void handleDataValid();
+    bool isIdle();
+    static void isrSlot0();
+    static void isrSlot1();
+    static void isrSlot2();
+    static void isrSlot3();
+    
+    // Low power helpers
+    bool enterSleep(SleepMode mode);       // Platform sleep, true if SDO woke us
+    uint16_t wakeScan(uint32_t wakeUs);    // Read the waking frame, returns it
+    #if TTP229_FREERTOS
+    bool suspendScanTask();
+    #endif
+    
     // Timing helper that handles millis() overflow
     bool timeElapsed(uint32_t startTime, uint32_t interval);
+    
+    friend struct TTP229EventMachine;
+    friend struct TTP229GestureRecognizer;
 };
 
+#if TTP229_TRACE_DEPTH > 0
+template <typename Output>
+size_t TTP229::dumpTrace(Output& out) {
+    bool enabled = _traceEnabled;
+    _traceEnabled = false;
+    
+    uint32_t total = _traceTotal;
+    uint16_t count = total < TTP229_TRACE_DEPTH ? (uint16_t)total : TTP229_TRACE_DEPTH;
+    
+    TTP229TraceHeader header;
+    header.pressScans = _debouncer.pressScans;
+    header.releaseScans = _debouncer.releaseScans;
+    header.keys = _is16KeyMode ? 16 : 8;
+    header.scanIntervalMs = _activeScanInterval;
+    header.holdMs = _eventMachine.holdMs;
+    header.longPressMs = _eventMachine.longPressMs;
+    header.frames = count;
+    header.lastSequence = _traceLastSequence;
+    
+    uint8_t bytes[TTP229_TRACE_HEADER_BYTES];
+    ttp229EncodeTraceHeader(bytes, header);
+    size_t written = out.write(bytes, TTP229_TRACE_HEADER_BYTES);
+    
+    for (uint32_t i = total - count; i != total; i++) {
+        TTP229TraceFrame frame;
+        frame.micros = _traceMicros[i & (TTP229_TRACE_DEPTH - 1)];
+        frame.mask = _traceMasks[i & (TTP229_TRACE_DEPTH - 1)];
+        ttp229EncodeTraceFrame(bytes, frame);
+        written += out.write(bytes, TTP229_TRACE_FRAME_BYTES);
+    }
+    
+    _traceEnabled = enabled;
+    return written;
+}
+#endif
+
 #endif // TTP229_H
\ No newline at end of file
@@ -0,0 +1,492 @@
+#ifndef TTP229_CORE_H
+#define TTP229_CORE_H
+
+#if defined(TTP229_HOST_SIM)
+  #include "TTP229HostSim.h"
+#else
+  #include <Arduino.h>
+#endif
+#include "TTP229Gpio.h"
+
+// Keys that can be timed for hold, long press and auto-repeat at once.
+// Further keys still report press and release.
+#ifndef TTP229_TIMED_KEYS
+  #if defined(ARDUINO_ARCH_AVR)
+    #define TTP229_TIMED_KEYS 4
+  #else
+    #define TTP229_TIMED_KEYS 16
+  #endif
+#endif
+
+// ==============================================
+// SHARED SCAN CORE
+// ==============================================
+// Pieces used by both the run-time configured TTP229 class and the
+// compile-time TTP229Static template: key/bitmask helpers, the unrolled
+// frame reader, the frame debouncer and the key event generator.
+
+// Key (1-16) to frame bit, 0 for KEY_NONE or out of range
+inline uint16_t ttp229KeyToMask(uint8_t key) {
+    if (key == 0 || key > 16) return 0;
+    return (uint16_t)(1u << (key - 1));
+}
+
+// Highest touched key in a frame, 0 if the frame is empty
+inline uint8_t ttp229MaskToKey(uint16_t mask) {
+    if (mask == 0) return 0;
+    return (uint8_t)(sizeof(unsigned int) * 8 - __builtin_clz((unsigned int)mask));
+}
+
+// CPU clock for the sub-microsecond spin below. Where the core does not
+// define F_CPU, assume a fast part: a high guess only waits longer.
+#if defined(F_CPU)
+  #define TTP229_CPU_HZ F_CPU
+#else
+  #define TTP229_CPU_HZ 480000000UL
+#endif
+
+// Busy-wait for a compile-time number of nanoseconds
+template <uint32_t Ns>
+inline void ttp229DelayNs() {
+    #if defined(ARDUINO_ARCH_AVR)
+    // Cycle-exact on AVR; GPIO writes already take ~4 cycles each
+    __builtin_avr_delay_cycles((F_CPU / 1000000UL) * Ns / 1000UL);
+    #elif defined(TTP229_HOST_SIM)
+    ttp229HostSim().advanceNs(Ns);
+    #else
+    if (Ns >= 1000) {
+        delayMicroseconds((Ns + 999) / 1000);
+    } else if (Ns > 0) {
+        // One pass per CPU cycle of the period. A pass never takes less
+        // than a cycle, so this is a floor - the chip's minimum clock
+        // width holds on any core clock, at worst a few times over.
+        for (uint32_t n = (uint32_t)((uint64_t)TTP229_CPU_HZ * Ns / 1000000000ULL) + 1; n > 0; n--) {
+            __asm__ __volatile__("nop");
+        }
+    }
+    #endif
+}
+
+// Fully unrolled clock-out of bits [Bit, Bits) - one SCL period per key
+template <uint8_t Bit, uint8_t Bits, uint32_t ClkNs>
+struct TTP229FrameUnroll {
+    static inline uint16_t read(TTP229Gpio& gpio) {
+        gpio.sclLow();
+        ttp229DelayNs<ClkNs>();
+        uint16_t value = gpio.sdoLow() ? (uint16_t)(1u << Bit) : 0;
+        gpio.sclHigh();
+        ttp229DelayNs<ClkNs>();
+        return value | TTP229FrameUnroll<Bit + 1, Bits, ClkNs>::read(gpio);
+    }
+};
+
+template <uint8_t Bits, uint32_t ClkNs>
+struct TTP229FrameUnroll<Bits, Bits, ClkNs> {
+    static inline uint16_t read(TTP229Gpio&) { return 0; }
+};
+
+// Per-key integrating debouncer built from bit-sliced ("vertical")
+// counters: bit n of c0/c1/c2 is the 3-bit scan counter of key n+1, so all
+// 16 keys count in parallel with a few AND/XOR per scan and no timestamps.
+// A key flips once its new level has been seen on pressScans (touch) or
+// releaseScans (release) consecutive scans. A scan back at the old level
+// restarts only that key's count.
+struct TTP229Debouncer {
+    static const uint8_t MAX_SCANS = 7;   // 3-bit counters
+
+    uint16_t stable;        // Debounced state (bit 0 = key 1)
+    uint16_t c0, c1, c2;    // Counter bit planes
+    uint8_t pressScans;
+    uint8_t releaseScans;
+
+    void reset() {
+        stable = 0;
+        c0 = c1 = c2 = 0;
+    }
+
+    // Scans needed to accept a touch / a release (1 = no debounce)
+    void setThresholds(uint8_t press, uint8_t release) {
+        pressScans = press < 1 ? 1 : (press > MAX_SCANS ? MAX_SCANS : press);
+        releaseScans = release < 1 ? 1 : (release > MAX_SCANS ? MAX_SCANS : release);
+    }
+
+    // Take a frame as debounced, e.g. the one read right after a wake-up
+    void accept(uint16_t raw) {
+        stable = raw;
+        c0 = c1 = c2 = 0;
+    }
+
+    // Some key is still counting towards a change
+    bool pending() const { return (c0 | c1 | c2) != 0; }
+
+    uint16_t update(uint16_t raw) {
+        uint16_t delta = raw ^ stable;
+
+        // Count up the keys that differ from the stable state, clear the rest
+        uint16_t t0 = c0;
+        uint16_t t1 = c1;
+        c0 = (uint16_t)(~t0 & delta);
+        c1 = (uint16_t)((t1 ^ t0) & delta);
+        c2 = (uint16_t)((c2 ^ (t1 & t0)) & delta);
+
+        // Keys whose count reached their threshold flip
+        uint16_t flip = delta & ((raw & countIs(pressScans)) |
+                                 ((uint16_t)~raw & countIs(releaseScans)));
+        stable ^= flip;
+        c0 &= ~flip;
+        c1 &= ~flip;
+        c2 &= ~flip;
+        return stable;
+    }
+
+    // Keys whose counter equals n
+    uint16_t countIs(uint8_t n) const {
+        return (uint16_t)((n & 1 ? c0 : ~c0) & (n & 2 ? c1 : ~c1) & (n & 4 ? c2 : ~c2));
+    }
+};
+
+// Event types - TTP229::EVENT_* use the same values
+static const uint8_t TTP229_EVENT_PRESS = 0;
+static const uint8_t TTP229_EVENT_RELEASE = 1;
+static const uint8_t TTP229_EVENT_HOLD = 2;
+static const uint8_t TTP229_EVENT_LONG_PRESS = 3;
+static const uint8_t TTP229_EVENT_REPEAT = 4;       // data = repeats so far
+static const uint8_t TTP229_EVENT_DOUBLE_TAP = 5;   // data = 2
+static const uint8_t TTP229_EVENT_MULTI_TAP = 6;    // data = taps so far (3+)
+static const uint8_t TTP229_EVENT_SWIPE_LEFT = 7;   // data = speed, keys per second
+static const uint8_t TTP229_EVENT_SWIPE_RIGHT = 8;
+static const uint8_t TTP229_EVENT_SWIPE_UP = 9;
+static const uint8_t TTP229_EVENT_SWIPE_DOWN = 10;
+static const uint8_t TTP229_EVENT_CHORD = 11;       // data = mask of the chord keys
+static const uint8_t TTP229_EVENT_TYPES = 12;
+
+// Wrap-safe "deadline has passed"
+inline bool ttp229Due(uint32_t now, uint32_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+}
+
+// Key event generator: turns the accepted key mask into press, release,
+// hold, long-press and auto-repeat events. No platform calls - the owner
+// feeds it the mask and the time (from read(), a task or a timer ISR)
+// and receives events through sink.emitEvent(key, type, data).
+//
+// Every held key gets a slot in a small timer table with its own hold,
+// long-press and repeat deadlines. The earliest deadline of all slots is
+// cached in nextDeadline, so between key changes the owner only needs to
+// call update() once that time has come - and can sleep until then.
+struct TTP229EventMachine {
+    // Timer slot of one held key
+    struct KeyTimer {
+        uint8_t key;           // 0 = free slot
+        uint8_t pending;       // TIMER_* still to fire
+        uint16_t interval;     // Current repeat interval (shrinks with acceleration)
+        uint32_t pressed;      // Press time
+        uint32_t repeatAt;     // Next repeat
+        uint16_t repeats;
+    };
+
+    static const uint8_t TIMER_HOLD = 0x01;
+    static const uint8_t TIMER_LONG_PRESS = 0x02;
+    static const uint8_t TIMER_REPEAT = 0x04;
+
+    uint16_t keyMask;          // Accepted key state
+    uint16_t holdMs;
+    uint16_t longPressMs;
+    uint16_t repeatDelayMs;    // 0 = no auto-repeat
+    uint16_t repeatMs;
+    uint16_t repeatFastestMs;  // Acceleration floor (= repeatMs: constant rate)
+    uint16_t repeatKeys;       // Keys that auto-repeat
+
+    KeyTimer timers[TTP229_TIMED_KEYS];
+    uint32_t nextDeadline;     // Earliest pending deadline, valid while timing()
+    bool armed;
+
+    void reset() {
+        keyMask = 0;
+        for (uint8_t i = 0; i < TTP229_TIMED_KEYS; i++) timers[i].key = 0;
+        armed = false;
+    }
+
+    // Some held key still has a hold, long press or repeat to come
+    bool timing() const { return armed; }
+
+    // A deadline has been reached - update() has events to send
+    bool due(uint32_t now) const { return armed && ttp229Due(now, nextDeadline); }
+
+    // Returns the keys that changed state
+    template <typename Sink>
+    uint16_t update(uint16_t mask, uint32_t now, Sink& sink) {
+        uint16_t changed = mask ^ keyMask;
+        if (changed) {
+            uint16_t released = changed & keyMask;
+            uint16_t pressed = changed & mask;
+            keyMask = mask;
+
+            // One RELEASE per key that went up; its timers stop
+            while (released) {
+                uint8_t key = ttp229MaskToKey(released);
+                released &= ~ttp229KeyToMask(key);
+                sink.emitEvent(key, TTP229_EVENT_RELEASE, 0);
+                for (uint8_t i = 0; i < TTP229_TIMED_KEYS; i++) {
+                    if (timers[i].key == key) timers[i].key = 0;
+                }
+            }
+
+            // One PRESS per key that went down, each timed on its own
+            while (pressed) {
+                uint8_t key = ttp229MaskToKey(pressed);
+                pressed &= ~ttp229KeyToMask(key);
+                sink.emitEvent(key, TTP229_EVENT_PRESS, 0);
+                startTimer(key, now);
+            }
+        } else if (!due(now)) {
+            return 0;
+        }
+
+        runTimers(now, sink);
+        return changed;
+    }
+
+private:
+    void startTimer(uint8_t key, uint32_t now) {
+        for (uint8_t i = 0; i < TTP229_TIMED_KEYS; i++) {
+            KeyTimer& timer = timers[i];
+            if (timer.key != 0) continue;
+            timer.key = key;
+            timer.pending = TIMER_HOLD | TIMER_LONG_PRESS;
+            timer.pressed = now;
+            if (repeatDelayMs != 0 && (repeatKeys & ttp229KeyToMask(key))) {
+                timer.pending |= TIMER_REPEAT;
+                timer.repeatAt = now + repeatDelayMs;
+                timer.interval = repeatMs;
+                timer.repeats = 0;
+            }
+            return;
+        }
+        // Table full: this key reports press and release only
+    }
+
+    // Fire what is due and find the next deadline
+    template <typename Sink>
+    void runTimers(uint32_t now, Sink& sink) {
+        armed = false;
+        for (uint8_t i = 0; i < TTP229_TIMED_KEYS; i++) {
+            KeyTimer& timer = timers[i];
+            if (timer.key == 0 || timer.pending == 0) continue;
+
+            if ((timer.pending & TIMER_HOLD) && ttp229Due(now, timer.pressed + holdMs)) {
+                timer.pending &= ~TIMER_HOLD;
+                sink.emitEvent(timer.key, TTP229_EVENT_HOLD, 0);
+            }
+            if ((timer.pending & TIMER_LONG_PRESS) && ttp229Due(now, timer.pressed + longPressMs)) {
+                timer.pending &= ~TIMER_LONG_PRESS;
+                sink.emitEvent(timer.key, TTP229_EVENT_LONG_PRESS, 0);
+            }
+            if ((timer.pending & TIMER_REPEAT) && ttp229Due(now, timer.repeatAt)) {
+                if (timer.repeats < 0xFFFF) timer.repeats++;
+                sink.emitEvent(timer.key, TTP229_EVENT_REPEAT, timer.repeats);
+
+                // Typematic acceleration: each repeat 1/8 sooner, down to
+                // the fastest rate. A late scan does not cause a burst.
+                timer.repeatAt += timer.interval;
+                if (ttp229Due(now, timer.repeatAt)) timer.repeatAt = now + timer.interval;
+                uint16_t faster = timer.interval - (timer.interval >> 3);
+                timer.interval = faster > repeatFastestMs ? faster : repeatFastestMs;
+            }
+
+            if (timer.pending & TIMER_HOLD) schedule(timer.pressed + holdMs, now);
+            if (timer.pending & TIMER_LONG_PRESS) schedule(timer.pressed + longPressMs, now);
+            if (timer.pending & TIMER_REPEAT) schedule(timer.repeatAt, now);
+        }
+    }
+
+    void schedule(uint32_t deadline, uint32_t now) {
+        if (!armed || (int32_t)(deadline - now) < (int32_t)(nextDeadline - now)) {
+            nextDeadline = deadline;
+            armed = true;
+        }
+    }
+};
+
+// Gesture recognizer: runs after the event machine on the same accepted
+// key mask and turns the pressed/released keys of a scan into taps,
+// swipes and chords. One gesture of each kind is tracked at a time, so
+// a scan costs a fixed amount of work plus one step per changed key.
+// Results go to sink.emitEvent(key, type, data).
+//
+//   Tap     press + release within tapMs; taps on the same key less than
+//           multiTapMs apart count up (2 = DOUBLE_TAP, 3+ = MULTI_TAP)
+//   Swipe   at least swipeKeys neighbouring keys in one row or column,
+//           each touched within swipeStepMs of the previous one (lifting
+//           between keys is fine); sent once no key has followed for
+//           swipeStepMs and all keys are up
+//   Chord   two or more keys touched within chordMs of the first one
+//           and all held for chordMs after the last of them joined (a
+//           swipe's brief overlap of neighbouring keys does not count)
+struct TTP229GestureRecognizer {
+    uint16_t enabled;        // Bit per event type (1 << TTP229_EVENT_*)
+    uint16_t tapMs;
+    uint16_t multiTapMs;
+    uint16_t swipeStepMs;
+    uint16_t chordMs;
+    uint8_t swipeKeys;
+
+    uint8_t tapKey;          // Key being tapped, 0 = none
+    uint8_t tapCount;        // Completed taps on tapKey
+    uint32_t tapDown;        // Last press of tapKey
+    uint32_t tapUp;          // Last completed tap
+
+    uint8_t slideKey;        // Last key of the current slide
+    uint8_t slideType;       // Swipe event type, 0 until the second key
+    uint8_t slideCount;      // Keys in the slide
+    uint32_t slideStart;
+    uint32_t slideLast;
+
+    uint16_t chordMask;      // Keys touched inside the chord window
+    uint32_t chordStart;     // First key
+    uint32_t chordLast;      // Latest key to join
+    bool chordOpen;
+
+    void reset() {
+        tapKey = 0;
+        tapCount = 0;
+        tapDown = 0;
+        tapUp = 0;
+        slideKey = 0;
+        slideType = 0;
+        slideCount = 0;
+        slideStart = 0;
+        slideLast = 0;
+        chordMask = 0;
+        chordStart = 0;
+        chordLast = 0;
+        chordOpen = false;
+    }
+
+    // A chord window is open or a swipe may still end
+    bool pending() const { return chordOpen || slideCount >= 2; }
+
+    // When update() next has something to decide, valid while pending()
+    uint32_t nextDeadline() const {
+        uint32_t chordAt = chordLast + chordMs;
+        if ((int32_t)(chordAt - chordStart) <= (int32_t)chordMs) chordAt = chordStart + chordMs + 1;
+        uint32_t slideAt = slideLast + swipeStepMs + 1;
+        if (!chordOpen) return slideAt;
+        if (slideCount < 2) return chordAt;
+        return (int32_t)(chordAt - slideAt) < 0 ? chordAt : slideAt;
+    }
+
+    bool due(uint32_t now) const { return pending() && ttp229Due(now, nextDeadline()); }
+
+    template <typename Sink>
+    void update(uint16_t pressed, uint16_t released, uint16_t mask, uint32_t now, Sink& sink) {
+        if (pressed) {
+            // First key after all were up opens the chord window
+            if ((mask & ~pressed) == 0) {
+                chordMask = 0;
+                chordStart = now;
+                chordOpen = true;
+            }
+            if (chordOpen && now - chordStart <= chordMs) {
+                chordMask |= pressed;
+                chordLast = now;
+            }
+
+            uint16_t keys = pressed;
+            while (keys) {
+                uint8_t key = ttp229MaskToKey(keys);
+                keys &= ~ttp229KeyToMask(key);
+                pressTap(key, now);
+                stepSlide(key, now, sink);
+            }
+        }
+
+        uint16_t keys = released;
+        while (keys) {
+            uint8_t key = ttp229MaskToKey(keys);
+            keys &= ~ttp229KeyToMask(key);
+            releaseTap(key, now, sink);
+        }
+
+        if (chordOpen) {
+            if ((chordMask & mask) != chordMask) {
+                chordOpen = false;  // A chord key lifted early
+            } else if (now - chordStart > chordMs && now - chordLast >= chordMs) {
+                chordOpen = false;
+                if ((enabled & (1u << TTP229_EVENT_CHORD)) && (chordMask & (chordMask - 1))) {
+                    sink.emitEvent(ttp229MaskToKey(chordMask), TTP229_EVENT_CHORD, chordMask);
+                }
+            }
+        }
+
+        if (slideCount > 0 && mask == 0 && now - slideLast > swipeStepMs) endSlide(sink);
+    }
+
+private:
+    void pressTap(uint8_t key, uint32_t now) {
+        if (key != tapKey || now - tapUp > multiTapMs) tapCount = 0;
+        tapKey = key;
+        tapDown = now;
+    }
+
+    template <typename Sink>
+    void releaseTap(uint8_t key, uint32_t now, Sink& sink) {
+        if (key != tapKey) return;
+        if (now - tapDown > tapMs) {  // Held too long - not a tap
+            tapKey = 0;
+            tapCount = 0;
+            return;
+        }
+        if (tapCount < 255) tapCount++;
+        tapUp = now;
+
+        uint8_t type = (tapCount == 2) ? TTP229_EVENT_DOUBLE_TAP : TTP229_EVENT_MULTI_TAP;
+        if (tapCount >= 2 && (enabled & (1u << type))) sink.emitEvent(key, type, tapCount);
+    }
+
+    template <typename Sink>
+    void stepSlide(uint8_t key, uint32_t now, Sink& sink) {
+        // Swipe type by row/column step, [rowStep + 1][colStep + 1]
+        static const uint8_t directions[3][3] = {
+            { 0, TTP229_EVENT_SWIPE_UP, 0 },
+            { TTP229_EVENT_SWIPE_LEFT, 0, TTP229_EVENT_SWIPE_RIGHT },
+            { 0, TTP229_EVENT_SWIPE_DOWN, 0 }
+        };
+
+        if (slideCount > 0 && now - slideLast <= swipeStepMs) {
+            int8_t rowStep = (int8_t)((key - 1) >> 2) - (int8_t)((slideKey - 1) >> 2);
+            int8_t colStep = (int8_t)((key - 1) & 3) - (int8_t)((slideKey - 1) & 3);
+            if (rowStep >= -1 && rowStep <= 1 && colStep >= -1 && colStep <= 1) {
+                uint8_t type = directions[rowStep + 1][colStep + 1];
+                if (type != 0 && (slideType == 0 || slideType == type)) {
+                    slideType = type;
+                    slideKey = key;
+                    slideLast = now;
+                    if (slideCount < 255) slideCount++;
+                    return;
+                }
+            }
+        }
+
+        // Not a continuation - finish the old slide, a new one may start here
+        endSlide(sink);
+        slideKey = key;
+        slideType = 0;
+        slideCount = 1;
+        slideStart = now;
+        slideLast = now;
+    }
+
+    template <typename Sink>
+    void endSlide(Sink& sink) {
+        if (slideType != 0 && slideCount >= swipeKeys && (enabled & (1u << slideType))) {
+            uint32_t duration = slideLast - slideStart;
+            uint32_t speed = duration ? (uint32_t)(slideCount - 1) * 1000UL / duration : 0xFFFF;
+            sink.emitEvent(slideKey, slideType, (uint16_t)(speed > 0xFFFF ? 0xFFFF : speed));
+        }
+        slideCount = 0;
+        slideType = 0;
+    }
+};
+
+#endif // TTP229_CORE_H
@@ -0,0 +1,225 @@
+#ifndef TTP229_EVENT_RING_H
+#define TTP229_EVENT_RING_H
+
+#if defined(TTP229_HOST_SIM)
+  #include "TTP229HostSim.h"
+#else
+  #include <Arduino.h>
+#endif
+
+// ==============================================
+// LOCK-FREE SINGLE-PRODUCER / SINGLE-CONSUMER RING
+// ==============================================
+// One context pushes (the scan task, read() or a timer ISR), one context
+// pops. No mutex, no critical section on the fast path: the producer owns
+// _head, the consumer owns _tail, and each side only reads the other's
+// index. Storage lives inside the object - nothing is allocated.
+//
+// pushOverwrite() lets the producer drop the oldest entry when full. It
+// bumps _overwriteSeq around the write (odd while writing) so a consumer
+// copying the same slot notices and retries instead of returning a torn
+// entry.
+
+// Index loads/stores - 16-bit indices need interrupts masked on 8-bit AVR
+template <typename T>
+inline T ttp229AtomicLoad(const volatile T& value) {
+    #if defined(ARDUINO_ARCH_AVR)
+    uint8_t oldSREG = SREG;
+    cli();
+    T result = value;
+    SREG = oldSREG;
+    return result;
+    #else
+    return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+    #endif
+}
+
+template <typename T>
+inline void ttp229AtomicStore(volatile T& target, T value) {
+    #if defined(ARDUINO_ARCH_AVR)
+    uint8_t oldSREG = SREG;
+    cli();
+    target = value;
+    SREG = oldSREG;
+    #else
+    __atomic_store_n(&target, value, __ATOMIC_RELEASE);
+    #endif
+}
+
+inline void ttp229AcquireFence() {
+    #if defined(ARDUINO_ARCH_AVR)
+    __asm__ __volatile__("" ::: "memory");
+    #else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    #endif
+}
+
+inline void ttp229ReleaseFence() {
+    #if defined(ARDUINO_ARCH_AVR)
+    __asm__ __volatile__("" ::: "memory");
+    #else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    #endif
+}
+
+template <typename T, uint8_t Capacity>
+class TTP229EventRing {
+    static_assert(Capacity >= 2 && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0,
+                  "Event ring capacity must be a power of two between 2 and 128");
+
+public:
+    TTP229EventRing() { reset(Capacity); }
+
+    // Set the usable size (rounded up to a power of two, at most Capacity)
+    // and empty the ring. Not safe while producer or consumer are active.
+    void reset(uint8_t size) {
+        _size = roundSize(size);
+        _mask = _size - 1;
+        _head = 0;
+        _tail = 0;
+        _overwriteSeq = 0;
+    }
+
+    // Change the usable size but keep the queued entries, oldest first.
+    // Entries that no longer fit are dropped from the old end; returns how
+    // many. Producer and consumer must both be held off meanwhile.
+    uint8_t resize(uint8_t size) {
+        uint16_t head = _head;
+        uint16_t tail = _tail;
+        uint16_t used = (uint16_t)(head - tail);
+        if (used > _size) {  // Lapped by pushOverwrite()
+            tail = head - _size;
+            used = _size;
+        }
+
+        // Rotate the old storage so the oldest entry sits in slot 0
+        uint8_t start = tail & _mask;
+        reverse(0, start);
+        reverse(start, _size);
+        reverse(0, _size);
+
+        uint8_t newSize = roundSize(size);
+        uint8_t dropped = 0;
+        if (used > newSize) {
+            dropped = (uint8_t)(used - newSize);
+            for (uint8_t i = 0; i < newSize; i++) _slots[i] = _slots[i + dropped];
+            used = newSize;
+        }
+
+        _size = newSize;
+        _mask = newSize - 1;
+        _tail = 0;
+        _head = used;
+        return dropped;
+    }
+
+    uint8_t size() const { return _size; }
+    static uint8_t capacity() { return Capacity; }
+
+    // Usable size that reset() / resize() give for a requested size
+    static uint8_t roundSize(uint8_t size) {
+        uint8_t rounded = 2;
+        while (rounded < size && rounded < Capacity) rounded <<= 1;
+        return rounded;
+    }
+
+    uint8_t count() const {
+        uint16_t used = (uint16_t)(ttp229AtomicLoad(_head) - ttp229AtomicLoad(_tail));
+        return used > _size ? _size : (uint8_t)used;
+    }
+
+    bool isEmpty() const { return ttp229AtomicLoad(_head) == ttp229AtomicLoad(_tail); }
+    bool isFull() const { return count() >= _size; }
+
+    // Producer: append, fail if full (drop newest)
+    bool push(const T& item) {
+        uint16_t head = _head;
+        if ((uint16_t)(head - ttp229AtomicLoad(_tail)) >= _size) return false;
+        _slots[head & _mask] = item;
+        ttp229AtomicStore(_head, (uint16_t)(head + 1));
+        return true;
+    }
+
+    // Producer: append, replacing the oldest entry if full.
+    // Returns true if an entry was dropped.
+    bool pushOverwrite(const T& item) {
+        uint16_t head = _head;
+        if ((uint16_t)(head - ttp229AtomicLoad(_tail)) < _size) {
+            _slots[head & _mask] = item;
+            ttp229AtomicStore(_head, (uint16_t)(head + 1));
+            return false;
+        }
+
+        uint16_t seq = _overwriteSeq;
+        ttp229AtomicStore(_overwriteSeq, (uint16_t)(seq + 1));  // Odd: writing
+        _slots[head & _mask] = item;
+        ttp229AtomicStore(_head, (uint16_t)(head + 1));
+        ttp229AtomicStore(_overwriteSeq, (uint16_t)(seq + 2));
+        return true;
+    }
+
+    // Consumer: remove the oldest entry
+    bool pop(T& item) {
+        for (;;) {
+            uint16_t seq = ttp229AtomicLoad(_overwriteSeq);
+            uint16_t head = ttp229AtomicLoad(_head);
+            uint16_t tail = _tail;
+            if (head == tail) return false;
+
+            // Producer lapped us (drop-oldest): skip the overwritten entries
+            if ((uint16_t)(head - tail) > _size) tail = head - _size;
+
+            item = _slots[tail & _mask];
+            ttp229AcquireFence();
+            if ((seq & 1) || ttp229AtomicLoad(_overwriteSeq) != seq) continue;
+
+            ttp229AtomicStore(_tail, (uint16_t)(tail + 1));
+            return true;
+        }
+    }
+
+    // Consumer: remove up to max entries, oldest first
+    uint8_t popBatch(T* items, uint8_t max) {
+        uint8_t n = 0;
+        while (n < max && pop(items[n])) n++;
+        return n;
+    }
+
+    // Consumer: remove the oldest entry for which match(entry) is true and
+    // leave the others queued in order (the older ones move up a slot).
+    // Returns false if none matches. Hold the producer off meanwhile, as
+    // for resize().
+    template <typename Match>
+    bool takeFirst(T& item, const Match& match) {
+        uint16_t head = _head;
+        uint16_t tail = _tail;
+        if ((uint16_t)(head - tail) > _size) tail = head - _size;
+
+        for (uint16_t i = tail; i != head; i++) {
+            if (!match(_slots[i & _mask])) continue;
+            item = _slots[i & _mask];
+            for (; i != tail; i--) _slots[i & _mask] = _slots[(uint16_t)(i - 1) & _mask];
+            ttp229AtomicStore(_tail, (uint16_t)(tail + 1));
+            return true;
+        }
+        return false;
+    }
+
+private:
+    void reverse(uint8_t first, uint8_t last) {
+        while (first + 1 < last) {
+            T item = _slots[first];
+            _slots[first++] = _slots[--last];
+            _slots[last] = item;
+        }
+    }
+
+    T _slots[Capacity];
+    volatile uint16_t _head;          // Written by producer only
+    volatile uint16_t _tail;          // Written by consumer only
+    volatile uint16_t _overwriteSeq;  // Written by producer only
+    uint8_t _size;
+    uint8_t _mask;
+};
+
+#endif // TTP229_EVENT_RING_H
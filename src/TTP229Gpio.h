@@ -0,0 +1,215 @@
+#ifndef TTP229_GPIO_H
+#define TTP229_GPIO_H
+
+#if defined(TTP229_HOST_SIM)
+  #include "TTP229HostSim.h"
+#else
+  #include <Arduino.h>
+#endif
+
+// ==============================================
+// FAST GPIO BACKEND SELECTION
+// ==============================================
+// The serial read toggles SCL 32 times and samples SDO 16 times per frame.
+// digitalWrite()/digitalRead() go through pin lookup tables on every call,
+// so the pins are resolved to port registers once in attach() instead.
+//
+// Define TTP229_GPIO_PORTABLE to force digitalWrite()/digitalRead().
+
+#if defined(TTP229_GPIO_PORTABLE)
+  #define TTP229_GPIO_BACKEND_NAME "digitalWrite"
+#elif defined(ARDUINO_ARCH_AVR)
+  #define TTP229_GPIO_AVR 1
+  #define TTP229_GPIO_BACKEND_NAME "AVR port registers"
+#elif defined(ESP32)
+  #include <soc/gpio_reg.h>
+  #define TTP229_GPIO_ESP32 1
+  #define TTP229_GPIO_BACKEND_NAME "ESP32 W1TS/W1TC registers"
+#elif defined(ESP8266)
+  #include <esp8266_peri.h>
+  #define TTP229_GPIO_ESP8266 1
+  #define TTP229_GPIO_BACKEND_NAME "ESP8266 GPOS/GPOC registers"
+#elif defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)
+  #include <hardware/structs/sio.h>
+  #define TTP229_GPIO_RP2040 1
+  #define TTP229_GPIO_BACKEND_NAME "RP2040 SIO"
+#else
+  #define TTP229_GPIO_BACKEND_NAME "digitalWrite"
+#endif
+
+class TTP229Gpio {
+public:
+    TTP229Gpio() : _sclPin(0), _sdoPin(0), _fast(false) {}
+
+    // Resolve pin numbers to registers (pins must already be configured)
+    void attach(uint8_t sclPin, uint8_t sdoPin) {
+        _sclPin = sclPin;
+        _sdoPin = sdoPin;
+        _fast = false;
+
+        #if defined(TTP229_GPIO_AVR)
+        uint8_t sclPort = digitalPinToPort(sclPin);
+        uint8_t sdoPort = digitalPinToPort(sdoPin);
+        if (sclPort != NOT_A_PIN && sdoPort != NOT_A_PIN) {
+            _sclOut = portOutputRegister(sclPort);
+            _sclMask = digitalPinToBitMask(sclPin);
+            _sdoIn = portInputRegister(sdoPort);
+            _sdoMask = digitalPinToBitMask(sdoPin);
+            _fast = true;
+        }
+        #elif defined(TTP229_GPIO_ESP32)
+        if (sclPin < 32) {
+            _sclSetReg = GPIO_OUT_W1TS_REG;
+            _sclClrReg = GPIO_OUT_W1TC_REG;
+            _sclMask = 1UL << sclPin;
+        }
+        #if defined(GPIO_OUT1_W1TS_REG)
+        else {
+            _sclSetReg = GPIO_OUT1_W1TS_REG;
+            _sclClrReg = GPIO_OUT1_W1TC_REG;
+            _sclMask = 1UL << (sclPin - 32);
+        }
+        #endif
+        if (sdoPin < 32) {
+            _sdoInReg = GPIO_IN_REG;
+            _sdoMask = 1UL << sdoPin;
+        }
+        #if defined(GPIO_IN1_REG)
+        else {
+            _sdoInReg = GPIO_IN1_REG;
+            _sdoMask = 1UL << (sdoPin - 32);
+        }
+        #endif
+        #if defined(GPIO_OUT1_W1TS_REG)
+        _fast = true;
+        #else
+        _fast = (sclPin < 32 && sdoPin < 32);
+        #endif
+        #elif defined(TTP229_GPIO_ESP8266)
+        // GPIO16 lives in the RTC block and is not covered by GPOS/GPOC
+        if (sclPin < 16 && sdoPin < 16) {
+            _sclMask = 1UL << sclPin;
+            _sdoMask = 1UL << sdoPin;
+            _fast = true;
+        }
+        #elif defined(TTP229_GPIO_RP2040)
+        if (sclPin < 30 && sdoPin < 30) {
+            _sclMask = 1UL << sclPin;
+            _sdoMask = 1UL << sdoPin;
+            _fast = true;
+        }
+        #endif
+    }
+
+    bool isFast() const { return _fast; }
+
+    const char* getBackendName() const {
+        return _fast ? TTP229_GPIO_BACKEND_NAME : "digitalWrite";
+    }
+
+    inline void sclHigh() {
+        if (!_fast) {
+            digitalWrite(_sclPin, HIGH);
+            return;
+        }
+        #if defined(TTP229_GPIO_AVR)
+        uint8_t oldSREG = SREG;  // Port may be shared with ISR-driven pins
+        cli();
+        *_sclOut |= _sclMask;
+        SREG = oldSREG;
+        #elif defined(TTP229_GPIO_ESP32)
+        REG_WRITE(_sclSetReg, _sclMask);
+        #elif defined(TTP229_GPIO_ESP8266)
+        GPOS = _sclMask;
+        #elif defined(TTP229_GPIO_RP2040)
+        sio_hw->gpio_set = _sclMask;
+        #endif
+    }
+
+    inline void sclLow() {
+        if (!_fast) {
+            digitalWrite(_sclPin, LOW);
+            return;
+        }
+        #if defined(TTP229_GPIO_AVR)
+        uint8_t oldSREG = SREG;
+        cli();
+        *_sclOut &= ~_sclMask;
+        SREG = oldSREG;
+        #elif defined(TTP229_GPIO_ESP32)
+        REG_WRITE(_sclClrReg, _sclMask);
+        #elif defined(TTP229_GPIO_ESP8266)
+        GPOC = _sclMask;
+        #elif defined(TTP229_GPIO_RP2040)
+        sio_hw->gpio_clr = _sclMask;
+        #endif
+    }
+
+    // True when SDO is LOW (key touched / data valid)
+    inline bool sdoLow() {
+        if (!_fast) {
+            return digitalRead(_sdoPin) == LOW;
+        }
+        #if defined(TTP229_GPIO_AVR)
+        return (*_sdoIn & _sdoMask) == 0;
+        #elif defined(TTP229_GPIO_ESP32)
+        return (REG_READ(_sdoInReg) & _sdoMask) == 0;
+        #elif defined(TTP229_GPIO_ESP8266)
+        return (GPI & _sdoMask) == 0;
+        #elif defined(TTP229_GPIO_RP2040)
+        return (sio_hw->gpio_in & _sdoMask) == 0;
+        #else
+        return digitalRead(_sdoPin) == LOW;
+        #endif
+    }
+
+    // One SCL period: the falling edge shifts the next key onto SDO.
+    // Returns true if that key is touched.
+    inline bool clockBit(uint16_t clkDelayUs) {
+        sclLow();
+        delayMicroseconds(clkDelayUs);
+        bool touched = sdoLow();
+        sclHigh();
+        delayMicroseconds(clkDelayUs);
+        return touched;
+    }
+
+    // Clock out a full frame (bit 0 = key 1) with run-time timing
+    uint16_t readFrame(uint8_t bits, uint16_t clkDelayUs, uint16_t readDelayUs) {
+        uint16_t mask = 0;
+        uint16_t bit = 1;
+
+        // Start with clock high
+        sclHigh();
+        delayMicroseconds(readDelayUs);
+
+        for (uint8_t i = 0; i < bits; i++) {
+            if (clockBit(clkDelayUs)) mask |= bit;
+            bit <<= 1;
+        }
+        return mask;
+    }
+
+private:
+    uint8_t _sclPin;
+    uint8_t _sdoPin;
+    bool _fast;
+
+    #if defined(TTP229_GPIO_AVR)
+    volatile uint8_t* _sclOut;
+    volatile uint8_t* _sdoIn;
+    uint8_t _sclMask;
+    uint8_t _sdoMask;
+    #elif defined(TTP229_GPIO_ESP32)
+    uint32_t _sclSetReg;
+    uint32_t _sclClrReg;
+    uint32_t _sdoInReg;
+    uint32_t _sclMask;
+    uint32_t _sdoMask;
+    #elif defined(TTP229_GPIO_ESP8266) || defined(TTP229_GPIO_RP2040)
+    uint32_t _sclMask;
+    uint32_t _sdoMask;
+    #endif
+};
+
+#endif // TTP229_GPIO_H
@@ -0,0 +1,354 @@
+#include "TTP229Group.h"
+
+#if TTP229_FREERTOS
+
+// ==============================================
+// CONSTRUCTOR / DESTRUCTOR
+// ==============================================
+
+TTP229Group::TTP229Group(uint8_t taskPriority, uint32_t stackDepth) {
+    memset(_devices, 0, sizeof(_devices));
+    memset(_stats, 0, sizeof(_stats));
+    _count = 0;
+
+    _taskHandle = NULL;
+    _statsMutex = portMUX_INITIALIZER_UNLOCKED;
+    _taskRunning = false;
+    _taskPriority = taskPriority;
+    _taskStackDepth = stackDepth;
+    _queueSize = TTP229_GROUP_QUEUE_CAPACITY;
+    _resizeTo = 0;
+    _scanInterval = 10;
+    #if TTP229_STATIC_RTOS
+    _storage = NULL;
+    #endif
+}
+
+TTP229Group::~TTP229Group() {
+    end();
+}
+
+// ==============================================
+// SETUP
+// ==============================================
+
+uint8_t TTP229Group::addDevice(TTP229& device) {
+    if (_count >= MAX_DEVICES || _taskRunning) return DEVICE_INVALID;
+
+    // A keypad with its own task would be scanned twice
+    if (device.isRTOSEnabled() || device._group != NULL) return DEVICE_INVALID;
+
+    uint8_t id = _count++;
+    _devices[id] = &device;
+    device._group = this;
+    device._groupId = id;
+    return id;
+}
+
+bool TTP229Group::begin(uint16_t scanIntervalMs, bool createTask) {
+    #if TTP229_STATIC_RTOS
+    _storage = NULL;
+    #endif
+    return start(scanIntervalMs, createTask);
+}
+
+#if TTP229_STATIC_RTOS
+bool TTP229Group::begin(TTP229::RTOSStorage& storage, uint16_t scanIntervalMs) {
+    if (storage.stack == NULL || storage.stackDepth == 0) return false;
+    _storage = &storage;
+    return start(scanIntervalMs, true);
+}
+#endif
+
+bool TTP229Group::start(uint16_t scanIntervalMs, bool createTask) {
+    if (_count == 0) return false;
+    if (scanIntervalMs < 1 || scanIntervalMs > 1000) return false;
+    _scanInterval = scanIntervalMs;
+
+    // The ring lives in the object - just size and empty it
+    _events.reset(_queueSize);
+    _resizeTo = 0;
+    _taskRunning = true;
+
+    if (createTask) {
+        BaseType_t result;
+        #if TTP229_STATIC_RTOS
+        if (_storage != NULL) {
+            _taskStackDepth = _storage->stackDepth;
+            _taskHandle = xTaskCreateStatic(
+                groupTask,
+                "TTP229_Group",
+                _storage->stackDepth,
+                this,
+                _taskPriority,
+                _storage->stack,
+                &_storage->task
+            );
+            result = (_taskHandle != NULL) ? pdPASS : pdFAIL;
+        } else
+        #endif
+        {
+            result = xTaskCreate(
+                groupTask,          // Task function
+                "TTP229_Group",     // Task name (max 16 chars)
+                _taskStackDepth,    // Stack size
+                this,               // Parameter passed to task
+                _taskPriority,      // Priority
+                &_taskHandle        // Task handle
+            );
+        }
+
+        if (result != pdPASS) {
+            end();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void TTP229Group::end() {
+    _taskRunning = false;
+
+    if (_taskHandle != NULL) {
+        // Give task time to exit gracefully
+        vTaskDelay(pdMS_TO_TICKS(50));
+
+        if (eTaskGetState(_taskHandle) != eDeleted) {
+            vTaskDelete(_taskHandle);
+        }
+        _taskHandle = NULL;
+    }
+
+    // Hand the keypads back to standalone use. Tasks waiting on them in
+    // waitForEvent() return false.
+    for (uint8_t i = 0; i < _count; i++) {
+        _devices[i]->_group = NULL;
+        _devices[i]->releaseSubscribers();
+    }
+    _count = 0;
+    #if TTP229_STATIC_RTOS
+    _storage = NULL;  // The caller may reuse the storage now
+    #endif
+}
+
+// ==============================================
+// SCANNING
+// ==============================================
+
+void TTP229Group::groupTask(void* parameter) {
+    TTP229Group* group = (TTP229Group*)parameter;
+    TickType_t lastWakeTime = xTaskGetTickCount();
+
+    while (group->_taskRunning) {
+        group->update();
+        vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(group->_scanInterval));
+    }
+
+    vTaskDelete(NULL);
+}
+
+bool TTP229Group::canShareClock(TTP229* a, TTP229* b) {
+    return a->_sclPin == b->_sclPin &&
+           a->_backend == TTP229::BACKEND_BITBANG &&
+           b->_backend == TTP229::BACKEND_BITBANG;
+}
+
+void TTP229Group::update() {
+    // setQueueSize() from the consumer task waits while we resize
+    uint8_t resizeTo = ttp229AtomicLoad(_resizeTo);
+    if (resizeTo != 0) {
+        resizeQueue(resizeTo);
+        ttp229AtomicStore(_resizeTo, (uint8_t)0);
+    }
+
+    bool done[MAX_DEVICES] = { false };
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (done[i]) continue;
+        scanShared(i, done);
+    }
+}
+
+void TTP229Group::scanShared(uint8_t first, bool* done) {
+    TTP229* leader = _devices[first];
+    uint8_t members[MAX_DEVICES];
+    uint16_t frames[MAX_DEVICES];
+    uint8_t memberCount = 0;
+    uint8_t bits = 8;
+
+    // Collect every keypad clocked by the leader's SCL line
+    for (uint8_t i = first; i < _count; i++) {
+        if (done[i]) continue;
+        if (i != first && !canShareClock(leader, _devices[i])) continue;
+        members[memberCount] = i;
+        frames[memberCount] = 0;
+        memberCount++;
+        done[i] = true;
+        if (_devices[i]->_is16KeyMode) bits = 16;
+        if (i == first && leader->_backend != TTP229::BACKEND_BITBANG) break;
+    }
+
+    uint32_t startTime = micros();
+
+    if (memberCount == 1) {
+        frames[0] = leader->readRawMask();
+    } else {
+        // One clock train, every SDO sampled on each edge
+        for (uint8_t m = 0; m < memberCount; m++) {
+            _devices[members[m]]->_dataReady = false;
+            _devices[members[m]]->_scanning = true;
+        }
+
+        TTP229Gpio& clock = leader->_gpio;
+        uint16_t bit = 1;
+        clock.sclHigh();
+        delayMicroseconds(leader->_readDelay);
+        for (uint8_t b = 0; b < bits; b++) {
+            clock.sclLow();
+            delayMicroseconds(leader->_clkDelay);
+            for (uint8_t m = 0; m < memberCount; m++) {
+                if (_devices[members[m]]->_gpio.sdoLow()) frames[m] |= bit;
+            }
+            clock.sclHigh();
+            delayMicroseconds(leader->_clkDelay);
+            bit <<= 1;
+        }
+
+        for (uint8_t m = 0; m < memberCount; m++) {
+            _devices[members[m]]->_scanning = false;
+        }
+    }
+
+    uint32_t scanTime = (micros() - startTime) / memberCount;
+
+    for (uint8_t m = 0; m < memberCount; m++) {
+        TTP229* device = _devices[members[m]];
+        uint16_t frame = device->_is16KeyMode ? frames[m] : (frames[m] & 0x00FF);
+
+        portENTER_CRITICAL(&_statsMutex);
+        DeviceStats& stats = _stats[members[m]];
+        stats.scans++;
+        stats.lastScanTime = scanTime;
+        if (scanTime > stats.maxScanTime) stats.maxScanTime = scanTime;
+        portEXIT_CRITICAL(&_statsMutex);
+
+        device->processFrame(frame);
+    }
+}
+
+// ==============================================
+// EVENTS
+// ==============================================
+
+void TTP229Group::postEvent(uint8_t deviceId, const TTP229::KeyEvent& event) {
+    GroupEvent groupEvent;
+    groupEvent.deviceId = deviceId;
+    groupEvent.event = event;
+
+    // Only the group task (or the update() caller) pushes - no lock
+    bool queued = _events.push(groupEvent);
+
+    portENTER_CRITICAL(&_statsMutex);
+    if (queued) {
+        _stats[deviceId].events++;
+    } else {
+        _stats[deviceId].queueOverflows++;
+    }
+    portEXIT_CRITICAL(&_statsMutex);
+}
+
+bool TTP229Group::getEvent(GroupEvent& event) {
+    return _events.pop(event);
+}
+
+uint32_t TTP229Group::getQueueCount() {
+    return _events.count();
+}
+
+bool TTP229Group::setQueueSize(uint8_t size) {
+    if (size == 0) return false;
+    _queueSize = size;
+    if (!_taskRunning) return true;  // Applied by begin()
+
+    // The resize needs producer and consumer both held off. Without a
+    // task (or from the group task) this context is the producer.
+    if (_taskHandle == NULL || xTaskGetCurrentTaskHandle() == _taskHandle) {
+        resizeQueue(size);
+        return true;
+    }
+
+    // Otherwise we are the consumer: hand it to the group task and wait
+    // for its next pass
+    ttp229AtomicStore(_resizeTo, size);
+    while (ttp229AtomicLoad(_resizeTo) != 0 && _taskRunning) {
+        vTaskDelay(1);
+    }
+    return ttp229AtomicLoad(_resizeTo) == 0;
+}
+
+void TTP229Group::resizeQueue(uint8_t size) {
+    // The oldest events that no longer fit are dropped, and counted
+    // against the keypad they came from
+    uint8_t newSize = _events.roundSize(size);
+    GroupEvent oldest;
+    while (_events.count() > newSize && _events.pop(oldest)) {
+        portENTER_CRITICAL(&_statsMutex);
+        _stats[oldest.deviceId].queueOverflows++;
+        portEXIT_CRITICAL(&_statsMutex);
+    }
+    _events.resize(size);
+}
+
+// ==============================================
+// INFORMATION
+// ==============================================
+
+uint8_t TTP229Group::getDeviceCount() {
+    return _count;
+}
+
+TTP229* TTP229Group::getDevice(uint8_t deviceId) {
+    if (deviceId >= _count) return NULL;
+    return _devices[deviceId];
+}
+
+TTP229Group::DeviceStats TTP229Group::getDeviceStats(uint8_t deviceId) {
+    DeviceStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (deviceId >= _count) return stats;
+
+    portENTER_CRITICAL(&_statsMutex);
+    memcpy(&stats, &_stats[deviceId], sizeof(DeviceStats));
+    portEXIT_CRITICAL(&_statsMutex);
+    return stats;
+}
+
+void TTP229Group::resetStats() {
+    portENTER_CRITICAL(&_statsMutex);
+    memset(_stats, 0, sizeof(_stats));
+    portEXIT_CRITICAL(&_statsMutex);
+}
+
+TTP229::MemoryFootprint TTP229Group::getMemoryFootprint() {
+    TTP229::MemoryFootprint footprint;
+    memset(&footprint, 0, sizeof(footprint));
+    footprint.object = sizeof(TTP229Group);
+    footprint.eventRing = sizeof(_events);
+
+    // As for a keypad: heap blocks are the size of their Static*
+    // counterparts, allocator headers not counted
+    if (_taskHandle != NULL) {
+        footprint.rtosObjects = sizeof(StaticTask_t);
+        footprint.taskStack = _taskStackDepth * sizeof(StackType_t);
+        footprint.heap = footprint.rtosObjects + footprint.taskStack;
+        #if TTP229_STATIC_RTOS
+        if (_storage != NULL) footprint.heap = 0;
+        #endif
+    }
+
+    footprint.total = footprint.object + footprint.taskStack + footprint.rtosObjects;
+    return footprint;
+}
+
+#endif // TTP229_FREERTOS
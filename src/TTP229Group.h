@@ -0,0 +1,131 @@
+#ifndef TTP229_GROUP_H
+#define TTP229_GROUP_H
+
+#include "TTP229.h"
+
+#if TTP229_FREERTOS
+
+// Merged event queue capacity (power of two, 2..128)
+#ifndef TTP229_GROUP_QUEUE_CAPACITY
+  #define TTP229_GROUP_QUEUE_CAPACITY 32
+#endif
+
+// ==============================================
+// MULTI-KEYPAD MANAGER
+// ==============================================
+// Scans several TTP229 modules from ONE task into ONE merged event queue.
+// RAM and task overhead stay flat as keypads are added: the keypads
+// themselves never call beginRTOS().
+//
+// The merged queue is a lock-free ring inside the object: the group task
+// pushes, one consumer task calls getEvent(). Nothing is locked or
+// allocated per event.
+//
+// Keypads wired to the same SCL pin are clocked together: a single clock
+// train is sent and every SDO line is sampled on each edge. (Clocking them
+// one after another would shift the other modules' frames.)
+//
+//   TTP229 pad1(18, 19), pad2(18, 21);   // Shared SCL
+//   TTP229Group keypads;
+//
+//   pad1.begin(); pad2.begin();
+//   keypads.addDevice(pad1);             // id 0
+//   keypads.addDevice(pad2);             // id 1
+//   keypads.begin();
+//
+//   TTP229Group::GroupEvent e;
+//   while (keypads.getEvent(e)) { ... e.deviceId, e.event.key ... }
+//
+// A keypad's waitForEvent() subscribers are served from the group task.
+// Its handlers (onPress() etc.) run there too with DISPATCH_IMMEDIATE;
+// with DISPATCH_DEFERRED the events they handle are also queued on the
+// keypad for its dispatchEvents().
+
+class TTP229Group {
+public:
+    static const uint8_t MAX_DEVICES = 8;
+    static const uint8_t DEVICE_INVALID = 255;
+
+    // Event tagged with the keypad it came from
+    typedef struct {
+        uint8_t deviceId;          // Id returned by addDevice()
+        TTP229::KeyEvent event;
+    } GroupEvent;
+
+    // Per-keypad statistics
+    typedef struct {
+        uint32_t scans;            // Frames read
+        uint32_t events;           // Events queued
+        uint32_t queueOverflows;   // Events dropped because the queue was full (newest dropped)
+        uint32_t lastScanTime;     // Duration of the last frame read (µs)
+        uint32_t maxScanTime;      // Longest frame read (µs)
+    } DeviceStats;
+
+    TTP229Group(uint8_t taskPriority = 1, uint32_t stackDepth = 4096);
+    ~TTP229Group();
+
+    // Register a keypad (after its begin(), before group begin()).
+    // Returns the device id or DEVICE_INVALID.
+    uint8_t addDevice(TTP229& device);
+
+    bool begin(uint16_t scanIntervalMs = 10, bool createTask = true);
+    #if TTP229_STATIC_RTOS
+    // Group task in caller-owned memory (storage.mutex is not used)
+    bool begin(TTP229::RTOSStorage& storage, uint16_t scanIntervalMs = 10);  // No heap use
+    #endif
+    void end();
+
+    // One pass over all keypads - called by the task, or from loop()
+    // when begin(..., false) was used
+    void update();
+
+    // Events
+    bool getEvent(GroupEvent& event);   // Non-blocking, one consumer task
+    uint32_t getQueueCount();
+
+    // Rounded up to a power of two, at most TTP229_GROUP_QUEUE_CAPACITY.
+    // While running, call it from the task that calls getEvent(): the
+    // group task resizes at its next pass, keeping the newest events.
+    bool setQueueSize(uint8_t size);
+
+    // Information
+    uint8_t getDeviceCount();
+    TTP229* getDevice(uint8_t deviceId);
+    DeviceStats getDeviceStats(uint8_t deviceId);
+    void resetStats();
+
+    // RAM used by the group itself, in bytes (object = sizeof(TTP229Group),
+    // merged ring included; each keypad reports its own)
+    TTP229::MemoryFootprint getMemoryFootprint();
+
+private:
+    TTP229* _devices[MAX_DEVICES];
+    DeviceStats _stats[MAX_DEVICES];
+    uint8_t _count;
+
+    TaskHandle_t _taskHandle;
+    TTP229EventRing<GroupEvent, TTP229_GROUP_QUEUE_CAPACITY> _events;
+    portMUX_TYPE _statsMutex;
+    volatile bool _taskRunning;
+    uint8_t _taskPriority;
+    uint32_t _taskStackDepth;
+    uint8_t _queueSize;
+    volatile uint8_t _resizeTo;    // setQueueSize() waiting for the group task, 0: none
+    uint16_t _scanInterval;
+    #if TTP229_STATIC_RTOS
+    TTP229::RTOSStorage* _storage; // NULL: task from the heap
+    #endif
+
+    bool start(uint16_t scanIntervalMs, bool createTask);
+    void resizeQueue(uint8_t size);
+    static void groupTask(void* parameter);
+    void scanShared(uint8_t first, bool* done);
+    void postEvent(uint8_t deviceId, const TTP229::KeyEvent& event);
+    bool canShareClock(TTP229* a, TTP229* b);
+
+    friend class TTP229;
+};
+
+#endif // TTP229_FREERTOS
+
+#endif // TTP229_GROUP_H
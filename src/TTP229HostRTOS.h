@@ -0,0 +1,553 @@
+// The simulated board comes first; it includes this file in turn
+#include "TTP229HostSim.h"
+
+#ifndef TTP229_HOST_RTOS_H
+#define TTP229_HOST_RTOS_H
+
+// ==============================================
+// FREERTOS STAND-IN FOR THE HOST SIMULATION
+// ==============================================
+// With TTP229_HOST_RTOS (and TTP229_HOST_SIM) the simulated board also
+// runs the part of FreeRTOS the library uses on ESP32: tasks, delays,
+// task notifications, mutexes and queues. The scan task, waitForEvent()
+// and TTP229Group then run on a PC.
+//
+// Scheduling is deterministic, one core. Every task is a thread, but only
+// the one holding the CPU runs. It keeps it until it blocks (vTaskDelay(),
+// delay(), a notification, mutex or queue wait) or wakes a task of higher
+// priority. The highest-priority ready task runs next, equal priorities
+// in turn. When every task is blocked the virtual clock jumps to the
+// next timeout, script step or timer tick. main() is the first task
+// ("loopTask", priority 1) like loop() on ESP32.
+//
+// Interrupts do not preempt: a task woken from an ISR runs at the next
+// scheduling point. Critical sections are no-ops, since nothing else
+// runs while a task holds the CPU. One tick is one millisecond.
+
+#if defined(TTP229_HOST_SIM) && defined(TTP229_HOST_RTOS)
+
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;           // Stack depth is in bytes, as on ESP32
+typedef void (*TaskFunction_t)(void*);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configSUPPORT_STATIC_ALLOCATION 1
+
+typedef enum { eRunning = 0, eReady, eBlocked, eSuspended, eDeleted, eInvalid } eTaskState;
+
+// Placeholders for caller-owned task and mutex memory
+typedef struct { uint8_t reserved[352]; } StaticTask_t;
+typedef struct { uint8_t reserved[80]; } StaticSemaphore_t;
+
+typedef struct { uint32_t owner; uint32_t count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+#define portYIELD_FROM_ISR(...) ((void)0)
+
+struct TTP229SimTask {
+    enum State : uint8_t { FREE, READY, BLOCKED, SUSPENDED, DELETED };
+
+    State state;
+    bool killed;                // vTaskDelete() from another task
+    bool resumed;               // vTaskResume() ended its wait
+    const char* name;
+    UBaseType_t priority;
+    TaskFunction_t function;
+    void* parameter;
+    uint32_t readyOrder;        // Turn among equal priorities
+    uint32_t notifyValue;
+    const void* waitObject;     // What a blocked task waits for, NULL = time
+    uint64_t wakeNs;            // Timeout, UINT64_MAX = none
+    std::thread thread;
+    std::condition_variable cv;
+};
+
+struct TTP229SimMutex {
+    bool used;
+    TTP229SimTask* owner;
+};
+
+struct TTP229SimQueue {
+    uint8_t* items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+typedef TTP229SimTask* TaskHandle_t;
+typedef TTP229SimMutex* SemaphoreHandle_t;
+typedef TTP229SimQueue* QueueHandle_t;
+
+// Thrown into a deleted task's thread to unwind it
+struct TTP229SimTaskExit {};
+
+class TTP229SimRTOS {
+public:
+    static const uint8_t MAX_TASKS = 16;
+    static const uint8_t MAX_MUTEXES = 16;
+
+    uint32_t contextSwitches;   // Times the CPU went to another task
+
+    TTP229SimRTOS() : contextSwitches(0), _order(0) {
+        for (uint8_t i = 0; i < MAX_TASKS; i++) _tasks[i].state = TTP229SimTask::FREE;
+        for (uint8_t i = 0; i < MAX_MUTEXES; i++) _mutexes[i].used = false;
+        TTP229SimTask& loop = _tasks[0];
+        initTask(loop, "loopTask", 1, NULL, NULL);
+        _current = &loop;
+    }
+
+    ~TTP229SimRTOS() { reset(); }
+
+    // Delete every task but main(), free mutexes; called by sim.reset()
+    void reset() {
+        for (uint8_t i = 1; i < MAX_TASKS; i++) {
+            TTP229SimTask& task = _tasks[i];
+            if (task.state != TTP229SimTask::FREE && task.state != TTP229SimTask::DELETED) kill(task);
+            if (task.thread.joinable()) task.thread.join();
+            task.state = TTP229SimTask::FREE;
+        }
+        for (uint8_t i = 0; i < MAX_MUTEXES; i++) _mutexes[i].used = false;
+        _tasks[0].notifyValue = 0;
+        _tasks[0].priority = 1;
+        _current = &_tasks[0];
+        contextSwitches = 0;
+    }
+
+    TaskHandle_t current() { return _current; }
+
+    uint8_t taskCount() {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < MAX_TASKS; i++) {
+            if (_tasks[i].state != TTP229SimTask::FREE && _tasks[i].state != TTP229SimTask::DELETED) n++;
+        }
+        return n;
+    }
+
+    // ---- Tasks ----
+
+    TaskHandle_t create(TaskFunction_t function, const char* name, UBaseType_t priority, void* parameter) {
+        TTP229SimTask* task = NULL;
+        for (uint8_t i = 1; i < MAX_TASKS && task == NULL; i++) {
+            TTP229SimTask::State state = _tasks[i].state;
+            if (state == TTP229SimTask::FREE || state == TTP229SimTask::DELETED) task = &_tasks[i];
+        }
+        if (task == NULL) return NULL;
+        if (task->thread.joinable()) task->thread.join();
+
+        initTask(*task, name, priority, function, parameter);
+        task->thread = std::thread(run, this, task);
+        preempt();
+        return task;
+    }
+
+    void remove(TaskHandle_t task) {
+        if (task == NULL) task = _current;
+        if (task->state == TTP229SimTask::DELETED || task->state == TTP229SimTask::FREE) return;
+        if (task == _current) {
+            if (task == &_tasks[0]) {
+                fprintf(stderr, "TTP229 host RTOS: main() cannot delete itself\n");
+                abort();
+            }
+            task->state = TTP229SimTask::DELETED;
+            schedule();             // Hands the CPU on and returns at once
+            throw TTP229SimTaskExit();
+        }
+        kill(*task);
+        task->thread.join();
+    }
+
+    void suspend(TaskHandle_t task) {
+        if (task == NULL) task = _current;
+        if (task->state == TTP229SimTask::DELETED) return;
+        task->state = TTP229SimTask::SUSPENDED;
+        if (task == _current) schedule();
+    }
+
+    void resume(TaskHandle_t task) {
+        if (task->state != TTP229SimTask::SUSPENDED) return;
+        makeReady(*task);
+        task->resumed = true;
+        preempt();
+    }
+
+    void setPriority(TaskHandle_t task, UBaseType_t priority) {
+        if (task == NULL) task = _current;
+        task->priority = priority;
+        preempt();
+    }
+
+    eTaskState state(TaskHandle_t task) {
+        if (task == _current) return eRunning;
+        switch (task->state) {
+            case TTP229SimTask::READY: return eReady;
+            case TTP229SimTask::BLOCKED: return eBlocked;
+            case TTP229SimTask::SUSPENDED: return eSuspended;
+            case TTP229SimTask::DELETED: return eDeleted;
+            default: return eInvalid;
+        }
+    }
+
+    // ---- Time ----
+
+    void delayNs(uint64_t ns) {
+        if (ns == 0) {
+            yield();
+            return;
+        }
+        wait(NULL, ttp229HostSim().nowNs + ns);
+    }
+
+    // Block until tick count `tick` (a millis() value)
+    void delayUntilTick(TickType_t tick) {
+        uint64_t now = ttp229HostSim().nowNs;
+        int32_t ticks = (int32_t)(tick - (TickType_t)(now / 1000000ULL));
+        if (ticks <= 0) return;
+        wait(NULL, now - now % 1000000ULL + (uint64_t)ticks * 1000000ULL);
+    }
+
+    void yield() {
+        _current->readyOrder = ++_order;
+        schedule();
+    }
+
+    // ---- Notifications ----
+
+    void notifyGive(TaskHandle_t task, bool fromISR, BaseType_t* woken) {
+        task->notifyValue++;
+        wake(&task->notifyValue);
+        if (woken != NULL && task->state == TTP229SimTask::READY &&
+            task->priority > _current->priority) {
+            *woken = pdTRUE;
+        }
+        if (!fromISR) preempt();
+    }
+
+    uint32_t notifyTake(bool clear, TickType_t ticks) {
+        TTP229SimTask* self = _current;
+        uint64_t deadline = deadlineNs(ticks);
+        while (self->notifyValue == 0) {
+            if (ttp229HostSim().nowNs >= deadline) return 0;
+            if (!wait(&self->notifyValue, deadline)) return 0;   // Resumed
+        }
+        uint32_t value = self->notifyValue;
+        self->notifyValue = clear ? 0 : value - 1;
+        return value;
+    }
+
+    // ---- Mutexes ----
+
+    SemaphoreHandle_t createMutex() {
+        for (uint8_t i = 0; i < MAX_MUTEXES; i++) {
+            if (!_mutexes[i].used) {
+                _mutexes[i].used = true;
+                _mutexes[i].owner = NULL;
+                return &_mutexes[i];
+            }
+        }
+        return NULL;
+    }
+
+    void deleteMutex(SemaphoreHandle_t mutex) { mutex->used = false; }
+
+    bool take(SemaphoreHandle_t mutex, TickType_t ticks) {
+        uint64_t deadline = deadlineNs(ticks);
+        while (mutex->owner != NULL) {
+            if (ttp229HostSim().nowNs >= deadline) return false;
+            wait(mutex, deadline);
+        }
+        mutex->owner = _current;
+        return true;
+    }
+
+    bool give(SemaphoreHandle_t mutex) {
+        if (mutex->owner != _current) return false;
+        mutex->owner = NULL;
+        wake(mutex);
+        preempt();
+        return true;
+    }
+
+    // ---- Queues ----
+
+    QueueHandle_t createQueue(UBaseType_t length, UBaseType_t itemSize) {
+        TTP229SimQueue* queue = new TTP229SimQueue;
+        queue->items = new uint8_t[length * itemSize];
+        queue->length = length;
+        queue->itemSize = itemSize;
+        queue->head = 0;
+        queue->count = 0;
+        return queue;
+    }
+
+    void deleteQueue(QueueHandle_t queue) {
+        delete[] queue->items;
+        delete queue;
+    }
+
+    bool send(QueueHandle_t queue, const void* item, TickType_t ticks) {
+        uint64_t deadline = deadlineNs(ticks);
+        while (queue->count == queue->length) {
+            if (ttp229HostSim().nowNs >= deadline) return false;
+            wait(queue, deadline);
+        }
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + tail * queue->itemSize, item, queue->itemSize);
+        queue->count++;
+        wake(queue);
+        preempt();
+        return true;
+    }
+
+    bool receive(QueueHandle_t queue, void* item, TickType_t ticks) {
+        uint64_t deadline = deadlineNs(ticks);
+        while (queue->count == 0) {
+            if (ttp229HostSim().nowNs >= deadline) return false;
+            wait(queue, deadline);
+        }
+        memcpy(item, queue->items + queue->head * queue->itemSize, queue->itemSize);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        wake(queue);
+        preempt();
+        return true;
+    }
+
+private:
+    TTP229SimTask _tasks[MAX_TASKS];
+    TTP229SimMutex _mutexes[MAX_MUTEXES];
+    TTP229SimTask* _current;
+    uint32_t _order;
+    std::mutex _lock;
+
+    void initTask(TTP229SimTask& task, const char* name, UBaseType_t priority,
+                  TaskFunction_t function, void* parameter) {
+        task.state = TTP229SimTask::READY;
+        task.killed = false;
+        task.resumed = false;
+        task.name = name;
+        task.priority = priority;
+        task.function = function;
+        task.parameter = parameter;
+        task.readyOrder = ++_order;
+        task.notifyValue = 0;
+        task.waitObject = NULL;
+        task.wakeNs = UINT64_MAX;
+    }
+
+    static void run(TTP229SimRTOS* rtos, TTP229SimTask* task) {
+        {
+            std::unique_lock<std::mutex> lock(rtos->_lock);
+            task->cv.wait(lock, [&] { return rtos->_current == task || task->killed; });
+            if (task->killed) return;
+        }
+        try {
+            task->function(task->parameter);
+            rtos->remove(NULL);     // Returning from a task deletes it
+        } catch (const TTP229SimTaskExit&) {
+        }
+    }
+
+    uint64_t deadlineNs(TickType_t ticks) {
+        if (ticks == portMAX_DELAY) return UINT64_MAX;
+        return ttp229HostSim().nowNs + (uint64_t)ticks * 1000000ULL;
+    }
+
+    void makeReady(TTP229SimTask& task) {
+        task.state = TTP229SimTask::READY;
+        task.waitObject = NULL;
+        task.wakeNs = UINT64_MAX;
+        task.readyOrder = ++_order;
+    }
+
+    // Block the running task; false if it was suspended and resumed
+    // rather than woken or timed out
+    bool wait(const void* object, uint64_t wakeNs) {
+        TTP229SimTask* self = _current;
+        self->state = TTP229SimTask::BLOCKED;
+        self->waitObject = object;
+        self->wakeNs = wakeNs;
+        self->resumed = false;
+        schedule();
+        return !self->resumed;
+    }
+
+    void wake(const void* object) {
+        for (uint8_t i = 0; i < MAX_TASKS; i++) {
+            TTP229SimTask& task = _tasks[i];
+            if (task.state == TTP229SimTask::BLOCKED && task.waitObject == object) makeReady(task);
+        }
+    }
+
+    TTP229SimTask* highestReady() {
+        TTP229SimTask* best = NULL;
+        for (uint8_t i = 0; i < MAX_TASKS; i++) {
+            TTP229SimTask& task = _tasks[i];
+            if (task.state != TTP229SimTask::READY) continue;
+            if (best == NULL || task.priority > best->priority ||
+                (task.priority == best->priority && (int32_t)(task.readyOrder - best->readyOrder) < 0)) {
+                best = &task;
+            }
+        }
+        return best;
+    }
+
+    // A task of higher priority than the running one became ready
+    void preempt() {
+        TTP229SimTask* best = highestReady();
+        if (best != NULL && best != _current && best->priority > _current->priority) {
+            _current->readyOrder = ++_order;
+            switchTo(best);
+        }
+    }
+
+    // Pick the next task, idling the clock forward while none is ready
+    void schedule() {
+        TTP229HostSim& sim = ttp229HostSim();
+        for (;;) {
+            uint64_t nextWake = UINT64_MAX;
+            for (uint8_t i = 0; i < MAX_TASKS; i++) {
+                TTP229SimTask& task = _tasks[i];
+                if (task.state != TTP229SimTask::BLOCKED) continue;
+                if (task.wakeNs <= sim.nowNs) makeReady(task);
+                else if (task.wakeNs < nextWake) nextWake = task.wakeNs;
+            }
+
+            TTP229SimTask* next = highestReady();
+            if (next != NULL) {
+                switchTo(next);
+                return;
+            }
+
+            uint64_t until = sim.nextEventNs();
+            if (nextWake < until) until = nextWake;
+            if (until == UINT64_MAX) {
+                fprintf(stderr, "TTP229 host RTOS: every task waits forever\n");
+                abort();
+            }
+            sim.advanceNs(until - sim.nowNs);
+        }
+    }
+
+    void switchTo(TTP229SimTask* next) {
+        TTP229SimTask* self = _current;
+        if (next == self) return;
+        contextSwitches++;
+
+        std::unique_lock<std::mutex> lock(_lock);
+        _current = next;
+        next->cv.notify_one();
+        if (self->state == TTP229SimTask::DELETED) return;
+        self->cv.wait(lock, [&] { return _current == self || self->killed; });
+        if (self->killed) throw TTP229SimTaskExit();
+    }
+
+    void kill(TTP229SimTask& task) {
+        std::unique_lock<std::mutex> lock(_lock);
+        task.state = TTP229SimTask::DELETED;
+        task.killed = true;
+        task.cv.notify_one();
+    }
+};
+
+inline TTP229SimRTOS& ttp229SimRTOS() {
+    static TTP229SimRTOS rtos;
+    return rtos;
+}
+
+inline void ttp229SimRTOSReset() { ttp229SimRTOS().reset(); }
+
+// ==============================================
+// FREERTOS API
+// ==============================================
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                              void* parameter, UBaseType_t priority, TaskHandle_t* handle) {
+    (void)stackDepth;
+    TaskHandle_t task = ttp229SimRTOS().create(function, name, priority, parameter);
+    if (handle != NULL) *handle = task;
+    return task != NULL ? pdPASS : pdFAIL;
+}
+
+inline TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                      void* parameter, UBaseType_t priority,
+                                      StackType_t* stack, StaticTask_t* buffer) {
+    (void)stackDepth;
+    (void)stack;
+    (void)buffer;
+    return ttp229SimRTOS().create(function, name, priority, parameter);
+}
+
+inline void vTaskDelete(TaskHandle_t task) { ttp229SimRTOS().remove(task); }
+inline void vTaskSuspend(TaskHandle_t task) { ttp229SimRTOS().suspend(task); }
+inline void vTaskResume(TaskHandle_t task) { ttp229SimRTOS().resume(task); }
+inline void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+    ttp229SimRTOS().setPriority(task, priority);
+}
+inline eTaskState eTaskGetState(TaskHandle_t task) { return ttp229SimRTOS().state(task); }
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return ttp229SimRTOS().current(); }
+
+inline TickType_t xTaskGetTickCount() { return (TickType_t)(ttp229HostSim().nowNs / 1000000ULL); }
+inline void vTaskDelay(TickType_t ticks) { ttp229SimRTOS().delayNs((uint64_t)ticks * 1000000ULL); }
+inline void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment) {
+    *previousWake += increment;
+    ttp229SimRTOS().delayUntilTick(*previousWake);
+}
+#define taskYIELD() ttp229SimRTOS().yield()
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    ttp229SimRTOS().notifyGive(task, false, NULL);
+    return pdPASS;
+}
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    ttp229SimRTOS().notifyGive(task, true, higherPriorityTaskWoken);
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    return ttp229SimRTOS().notifyTake(clearOnExit != pdFALSE, ticks);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return ttp229SimRTOS().createMutex(); }
+inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer) {
+    (void)buffer;
+    return ttp229SimRTOS().createMutex();
+}
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+    return ttp229SimRTOS().take(mutex, ticks) ? pdTRUE : pdFALSE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    return ttp229SimRTOS().give(mutex) ? pdTRUE : pdFALSE;
+}
+inline void vSemaphoreDelete(SemaphoreHandle_t mutex) { ttp229SimRTOS().deleteMutex(mutex); }
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return ttp229SimRTOS().createQueue(length, itemSize);
+}
+inline void vQueueDelete(QueueHandle_t queue) { ttp229SimRTOS().deleteQueue(queue); }
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return ttp229SimRTOS().send(queue, item, ticks) ? pdTRUE : pdFALSE;
+}
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    return ttp229SimRTOS().receive(queue, item, ticks) ? pdTRUE : pdFALSE;
+}
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) { return queue->count; }
+
+#endif // TTP229_HOST_SIM && TTP229_HOST_RTOS
+
+#endif // TTP229_HOST_RTOS_H
@@ -0,0 +1,464 @@
+#ifndef TTP229_HOST_SIM_H
+#define TTP229_HOST_SIM_H
+
+// ==============================================
+// HOST SIMULATION LAYER
+// ==============================================
+// Define TTP229_HOST_SIM to build the library on a PC instead of a board.
+// This header then stands in for <Arduino.h>: pins, millis()/micros(),
+// delay(), interrupts and Serial are backed by one simulated board with
+// a virtual clock, and a model of the TTP229 serial interface sits on the
+// SCL/SDO pins.
+//
+// Time only moves when the code under test waits (delay(),
+// delayMicroseconds()) or pays for a pin access (ioCostNs), so runs are
+// deterministic and the latency of every event can be measured exactly.
+//
+//   g++ -std=gnu++11 -DTTP229_HOST_SIM -Isrc src/TTP229.cpp my_sim.cpp
+//
+//   TTP229HostSim& sim = ttp229HostSim();
+//   TTP229 keypad(2, 3, true);
+//   sim.attachChip(2, 3);
+//   keypad.begin();
+//
+//   const TTP229SimStep touch[] = { {0, 0x0001}, {15, 0x0000}, {40, 0x0001}, {300, 0} };
+//   sim.playScript(touch, 4);                 // Bouncy press, then release
+//   while (millis() < 400) { keypad.read(); delay(1); }
+//
+// The board has no RTOS: the polled read() / service() paths are what
+// runs, and they share the event generator with the ESP32 task. Define
+// TTP229_HOST_RTOS as well for a FreeRTOS stand-in (TTP229HostRTOS.h)
+// that runs the scan task, waitForEvent() and TTP229Group.
+
+#if defined(TTP229_HOST_SIM)
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define NOT_A_PIN 0
+#define NOT_AN_INTERRUPT -1
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define F(string_literal) (string_literal)
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// Serial port that prints to stdout when echo is on, and collects the
+// output in a caller's buffer while capture() is set (tests)
+class TTP229SimSerial {
+public:
+    bool echo;
+
+    TTP229SimSerial() : echo(false), _capture(NULL), _captureSize(0), _captured(0) {}
+
+    // Append everything printed to buffer, NUL-terminated and cut off when
+    // full. NULL stops capturing.
+    void capture(char* buffer, size_t size) {
+        _capture = size != 0 ? buffer : NULL;
+        _captureSize = size;
+        _captured = 0;
+        if (_capture != NULL) _capture[0] = '\0';
+    }
+    size_t captured() const { return _captured; }
+
+    void begin(unsigned long) {}
+    void flush() { if (echo) fflush(stdout); }
+    operator bool() const { return true; }
+
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(char c) { return out("%c", c); }
+    size_t print(double value, int digits = 2) { return out("%.*f", digits, value); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(signed char value, int base = DEC) { return print((long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC) {
+        if (base == DEC) return out("%ld", value);
+        return print((unsigned long)value, base);
+    }
+    size_t print(unsigned long value, int base = DEC) {
+        if (base == HEX) return out("%lX", value);
+        if (base != BIN) return out("%lu", value);
+        char bits[33];
+        int n = 0;
+        do { bits[n++] = (char)('0' + (value & 1)); value >>= 1; } while (value);
+        for (int i = 0; i < n / 2; i++) { char t = bits[i]; bits[i] = bits[n - 1 - i]; bits[n - 1 - i] = t; }
+        bits[n] = '\0';
+        return out("%s", bits);
+    }
+
+    size_t write(uint8_t byte) { return write(&byte, 1); }
+    size_t write(const uint8_t* buffer, size_t size) {
+        if (_capture != NULL) append((const char*)buffer, size);
+        if (echo) return fwrite(buffer, 1, size, stdout);
+        return _capture != NULL ? size : 0;
+    }
+
+    size_t println() { return out("\n"); }
+    template <typename T> size_t println(T value) { return print(value) + println(); }
+    template <typename T> size_t println(T value, int format) { return print(value, format) + println(); }
+
+private:
+    char* _capture;
+    size_t _captureSize;
+    size_t _captured;
+
+    size_t out(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    void append(const char* text, size_t length) {
+        size_t room = _captureSize - 1 - _captured;
+        if (length > room) length = room;
+        memcpy(_capture + _captured, text, length);
+        _captured += length;
+        _capture[_captured] = '\0';
+    }
+};
+
+inline size_t TTP229SimSerial::out(const char* format, ...) {
+    if (!echo && _capture == NULL) return 0;
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (n <= 0) return 0;
+    size_t length = (size_t)n < sizeof(text) ? (size_t)n : sizeof(text) - 1;
+    if (_capture != NULL) append(text, length);
+    if (echo) fwrite(text, 1, length, stdout);
+    return length;
+}
+
+#if defined(TTP229_HOST_RTOS)
+inline void ttp229SimRTOSReset();
+#endif
+
+// One touch state change in a script: from atMs (relative to
+// playScript()) the keys in mask are touched
+typedef struct {
+    uint32_t atMs;
+    uint16_t mask;
+} TTP229SimStep;
+
+class TTP229HostSim {
+public:
+    static const uint8_t MAX_PINS = 64;
+    static const uint16_t DATA_VALID_US = 93;    // DV pulse width
+    static const uint16_t FRAME_TIMEOUT_US = 2000; // SCL idle time that restarts a frame
+
+    // Virtual clock
+    uint64_t nowNs;
+    uint32_t ioCostNs;          // Added to the clock for every pin access
+
+    // Counters for throughput / cost measurements
+    uint32_t sclEdges;          // Falling SCL edges seen by the chip model
+    uint32_t sdoReads;          // digitalRead() calls on SDO
+    uint32_t frames;            // Frames clocked out completely
+    uint32_t dataValidPulses;   // DV pulses generated by touch changes
+    uint32_t touchChanges;      // Touch state changes applied
+    uint64_t lastChangeUs;      // Time of the most recent touch change
+    uint64_t sleepNs;           // Time spent in sleepUntilDataValid()
+
+    TTP229SimSerial serial;
+
+    TTP229HostSim() { reset(); }
+
+    // Back to t=0 with nothing touched and nothing attached
+    void reset() {
+        nowNs = 0;
+        ioCostNs = 0;
+        sclEdges = 0;
+        sdoReads = 0;
+        frames = 0;
+        dataValidPulses = 0;
+        touchChanges = 0;
+        lastChangeUs = 0;
+        sleepNs = 0;
+        memset(_pinLevel, HIGH, sizeof(_pinLevel));
+        memset(_isr, 0, sizeof(_isr));
+        memset(_isrMode, 0, sizeof(_isrMode));
+        _interruptsOn = true;
+        _inIsr = false;
+        _timerIsr = NULL;
+        _timerPeriodUs = 0;
+        _timerNextUs = 0;
+        _sclPin = 0xFF;
+        _sdoPin = 0xFF;
+        _bits = 16;
+        _touched = 0;
+        _script = NULL;
+        _scriptLen = 0;
+        _scriptPos = 0;
+        _scriptStartUs = 0;
+        _bitIndex = 0;
+        _lastSclUs = 0;
+        _dvUntilUs = 0;
+        serial.capture(NULL, 0);
+        #if defined(TTP229_HOST_RTOS)
+        ttp229SimRTOSReset();
+        #endif
+    }
+
+    // Put the chip model on these pins (8 or 16 key frames)
+    void attachChip(uint8_t sclPin, uint8_t sdoPin, uint8_t bits = 16) {
+        _sclPin = sclPin;
+        _sdoPin = sdoPin;
+        _bits = bits;
+        _bitIndex = 0;
+    }
+
+    // Touch state, applied now
+    void setTouched(uint16_t mask) {
+        _script = NULL;
+        applyTouch(mask);
+    }
+    uint16_t getTouched() const { return _touched; }
+
+    // Replay touch changes relative to the current time. The array must
+    // outlive the script.
+    void playScript(const TTP229SimStep* steps, size_t count) {
+        _script = steps;
+        _scriptLen = count;
+        _scriptPos = 0;
+        _scriptStartUs = nowUs();
+        advanceNs(0);
+    }
+    bool scriptDone() const { return _script == NULL || _scriptPos >= _scriptLen; }
+
+    // Periodic interrupt, e.g. a timer calling TTP229::service().
+    // A period of 0 stops the timer.
+    void setTimer(uint32_t periodUs, void (*isr)()) {
+        _timerIsr = periodUs != 0 ? isr : NULL;
+        _timerPeriodUs = periodUs;
+        _timerNextUs = nowUs() + periodUs;
+    }
+
+    uint64_t nowUs() const { return nowNs / 1000; }
+
+    // Time of the next script step or timer tick, UINT64_MAX if none
+    uint64_t nextEventNs() const {
+        uint64_t next = nextScriptNs();
+        if (_timerIsr != NULL && _timerNextUs * 1000 < next) next = _timerNextUs * 1000;
+        return next;
+    }
+
+    // Low-power sleep woken by SDO: jump to the next data-valid pulse. The
+    // CPU is stopped, so the timer does not fire meanwhile. Returns false
+    // (at the end of the script) if no touch is left to wake on.
+    bool sleepUntilDataValid() {
+        uint64_t start = nowNs;
+        bool woke = false;
+        while (!scriptDone()) {
+            nowNs = nextScriptNs();
+            while (!scriptDone() && scriptStepUs(_scriptPos) * 1000 <= nowNs) {
+                applyTouch(_script[_scriptPos++].mask);
+            }
+            if (nowUs() < _dvUntilUs) {
+                woke = true;
+                break;
+            }
+        }
+        sleepNs += nowNs - start;
+        if (_timerIsr != NULL) _timerNextUs = nowUs() + _timerPeriodUs;
+        return woke;
+    }
+
+    // Move the clock; applies the script and fires due interrupts
+    void advanceNs(uint64_t ns) {
+        uint64_t target = nowNs + ns;
+        for (;;) {
+            // Everything due at the current time happens first
+            while (!scriptDone() && scriptStepUs(_scriptPos) * 1000 <= nowNs) {
+                applyTouch(_script[_scriptPos++].mask);
+            }
+            if (_timerIsr != NULL && _timerNextUs * 1000 <= nowNs) {
+                _timerNextUs += _timerPeriodUs;
+                runIsr(_timerIsr);
+                continue;
+            }
+
+            // Then jump to the next script step, timer tick or the target
+            uint64_t next = target;
+            if (nextScriptNs() < next) next = nextScriptNs();
+            if (_timerIsr != NULL && _timerNextUs * 1000 < next) next = _timerNextUs * 1000;
+            if (next <= nowNs) break;
+            nowNs = next;
+        }
+    }
+
+    // Pin layer
+    void pinMode(uint8_t pin, uint8_t mode) {
+        if (pin >= MAX_PINS) return;
+        if (mode == INPUT_PULLUP) _pinLevel[pin] = HIGH;
+    }
+
+    void digitalWrite(uint8_t pin, uint8_t level) {
+        advanceNs(ioCostNs);
+        if (pin >= MAX_PINS) return;
+        uint8_t old = _pinLevel[pin];
+        _pinLevel[pin] = level ? HIGH : LOW;
+        if (pin == _sclPin && old == HIGH && level == LOW) sclFalling();
+    }
+
+    int digitalRead(uint8_t pin) {
+        advanceNs(ioCostNs);
+        if (pin == _sdoPin) {
+            sdoReads++;
+            return sdoLevel();
+        }
+        return pin < MAX_PINS ? _pinLevel[pin] : LOW;
+    }
+
+    // Interrupts
+    void attachInterrupt(uint8_t irq, void (*isr)(), int mode) {
+        if (irq >= MAX_PINS) return;
+        _isr[irq] = isr;
+        _isrMode[irq] = (uint8_t)mode;
+    }
+    void detachInterrupt(uint8_t irq) {
+        if (irq < MAX_PINS) _isr[irq] = NULL;
+    }
+    void noInterrupts() { _interruptsOn = false; }
+    void interrupts() { _interruptsOn = true; }
+
+private:
+    uint8_t _pinLevel[MAX_PINS];
+    void (*_isr[MAX_PINS])();
+    uint8_t _isrMode[MAX_PINS];
+    bool _interruptsOn;
+    bool _inIsr;
+
+    void (*_timerIsr)();
+    uint32_t _timerPeriodUs;
+    uint64_t _timerNextUs;
+
+    // Chip model
+    uint8_t _sclPin;
+    uint8_t _sdoPin;
+    uint8_t _bits;
+    uint16_t _touched;
+    const TTP229SimStep* _script;
+    size_t _scriptLen;
+    size_t _scriptPos;
+    uint64_t _scriptStartUs;
+    uint8_t _bitIndex;          // Next bit to shift out (0 = idle)
+    uint64_t _lastSclUs;
+    uint64_t _dvUntilUs;        // SDO held low for data valid until then
+
+    uint64_t scriptStepUs(size_t i) const {
+        return _scriptStartUs + (uint64_t)_script[i].atMs * 1000;
+    }
+
+    uint64_t nextScriptNs() const {
+        if (scriptDone()) return UINT64_MAX;
+        return scriptStepUs(_scriptPos) * 1000;
+    }
+
+    void applyTouch(uint16_t mask) {
+        if (_bits == 8) mask &= 0x00FF;
+        if (mask == _touched) return;
+        _touched = mask;
+        touchChanges++;
+        lastChangeUs = nowUs();
+
+        // The chip announces new data with a low pulse on SDO while idle
+        if (_bitIndex != 0 && nowUs() - _lastSclUs > FRAME_TIMEOUT_US) _bitIndex = 0;
+        if (mask != 0 && _bitIndex == 0) {
+            _dvUntilUs = nowUs() + DATA_VALID_US;
+            dataValidPulses++;
+            if (_sdoPin < MAX_PINS && _isr[_sdoPin] != NULL &&
+                (_isrMode[_sdoPin] == FALLING || _isrMode[_sdoPin] == CHANGE)) {
+                runIsr(_isr[_sdoPin]);
+            }
+        }
+    }
+
+    void sclFalling() {
+        uint64_t now = nowUs();
+        if (_bitIndex != 0 && now - _lastSclUs > FRAME_TIMEOUT_US) _bitIndex = 0;
+        _lastSclUs = now;
+        sclEdges++;
+        _dvUntilUs = 0;
+        if (++_bitIndex > _bits) _bitIndex = 1;  // Chip restarts after a full frame
+        if (_bitIndex == _bits) frames++;
+    }
+
+    int sdoLevel() {
+        uint64_t now = nowUs();
+        if (now < _dvUntilUs) return LOW;
+        if (_bitIndex == 0) return HIGH;
+        if (now - _lastSclUs > FRAME_TIMEOUT_US) {
+            _bitIndex = 0;
+            return HIGH;
+        }
+        // Active LOW: touched key pulls SDO down while its bit is out
+        return (_touched & (1u << (_bitIndex - 1))) ? LOW : HIGH;
+    }
+
+    void runIsr(void (*isr)()) {
+        if (!_interruptsOn || _inIsr) return;  // ISRs do not nest
+        _inIsr = true;
+        isr();
+        _inIsr = false;
+    }
+};
+
+inline TTP229HostSim& ttp229HostSim() {
+    static TTP229HostSim sim;
+    return sim;
+}
+
+#if defined(TTP229_HOST_RTOS)
+#include "TTP229HostRTOS.h"
+#endif
+
+// ==============================================
+// ARDUINO API ON TOP OF THE SIMULATED BOARD
+// ==============================================
+
+#define Serial (ttp229HostSim().serial)
+
+inline unsigned long millis() { return (unsigned long)(ttp229HostSim().nowUs() / 1000); }
+inline unsigned long micros() { return (unsigned long)ttp229HostSim().nowUs(); }
+#if defined(TTP229_HOST_RTOS)
+// As on ESP32: delay() blocks the task, delayMicroseconds() busy-waits
+inline void delay(unsigned long ms) { ttp229SimRTOS().delayNs((uint64_t)ms * 1000000ULL); }
+inline void yield() { ttp229SimRTOS().yield(); }
+#else
+inline void delay(unsigned long ms) { ttp229HostSim().advanceNs((uint64_t)ms * 1000000ULL); }
+inline void yield() {}
+#endif
+inline void delayMicroseconds(unsigned int us) { ttp229HostSim().advanceNs((uint64_t)us * 1000ULL); }
+
+inline void pinMode(uint8_t pin, uint8_t mode) { ttp229HostSim().pinMode(pin, mode); }
+inline void digitalWrite(uint8_t pin, uint8_t level) { ttp229HostSim().digitalWrite(pin, level); }
+inline int digitalRead(uint8_t pin) { return ttp229HostSim().digitalRead(pin); }
+
+inline int digitalPinToInterrupt(uint8_t pin) {
+    return pin < TTP229HostSim::MAX_PINS ? (int)pin : NOT_AN_INTERRUPT;
+}
+inline void attachInterrupt(uint8_t irq, void (*isr)(), int mode) {
+    ttp229HostSim().attachInterrupt(irq, isr, mode);
+}
+inline void detachInterrupt(uint8_t irq) { ttp229HostSim().detachInterrupt(irq); }
+inline void noInterrupts() { ttp229HostSim().noInterrupts(); }
+inline void interrupts() { ttp229HostSim().interrupts(); }
+
+#endif // TTP229_HOST_SIM
+
+#endif // TTP229_HOST_SIM_H
@@ -0,0 +1,161 @@
+#ifndef TTP229_PACKED_H
+#define TTP229_PACKED_H
+
+// Plain C headers only - this file also builds into host-side decoders
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ==============================================
+// PACKED 4-BYTE EVENTS AND UPLINK BATCHES
+// ==============================================
+// A key event in one 32-bit word:
+//
+//   bits  0-4   key (0-16)
+//   bits  5-8   event type (TTP229_EVENT_*)
+//   bits  9-31  time, milliseconds (23 bits)
+//
+// Row and column are not stored - they follow from the key. Inside the
+// event queue (TTP229_PACKED_QUEUE) the time field holds the low 23 bits
+// of millis(); in a batch it is the delta to the previous event.
+//
+// Batch layout, little-endian, no padding:
+//
+//   byte 0      TTP229_BATCH_VERSION
+//   byte 1      event count
+//   bytes 2-5   time of the first event (ms)
+//   bytes 6-    count x packed event
+
+static const uint8_t TTP229_BATCH_VERSION = 1;
+static const uint8_t TTP229_BATCH_HEADER_BYTES = 6;
+static const uint32_t TTP229_PACKED_TIME_MASK = 0x7FFFFF;  // 23 bits, ~2.3 hours
+
+struct TTP229PackedEvent {
+    uint32_t bits;
+
+    static TTP229PackedEvent pack(uint8_t key, uint8_t type, uint32_t time) {
+        TTP229PackedEvent event;
+        event.bits = (uint32_t)(key & 0x1F) | ((uint32_t)(type & 0x0F) << 5) |
+                     ((time & TTP229_PACKED_TIME_MASK) << 9);
+        return event;
+    }
+
+    uint8_t key() const { return (uint8_t)(bits & 0x1F); }
+    uint8_t type() const { return (uint8_t)((bits >> 5) & 0x0F); }
+    uint32_t time() const { return bits >> 9; }
+
+    // Full millis() time of a queued event, given a later millis() value.
+    // Right as long as the event is read within ~2.3 hours.
+    uint32_t timeBefore(uint32_t now) const {
+        return now - ((now - time()) & TTP229_PACKED_TIME_MASK);
+    }
+};
+
+// Little-endian word access, independent of the CPU's byte order
+inline void ttp229PutLE32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+inline uint32_t ttp229GetLE32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Writes a batch straight into the caller's buffer, one event at a time
+// as the queue is drained - no event array in between.
+class TTP229BatchWriter {
+public:
+    TTP229BatchWriter(uint8_t* buffer, size_t size)
+        : _buffer(buffer), _size(size), _count(0), _lastTime(0) {}
+
+    // Room for one more event?
+    bool full() const {
+        return _count == 255 || bytes() + 4 > _size || _size < TTP229_BATCH_HEADER_BYTES;
+    }
+
+    bool add(uint8_t key, uint8_t type, uint32_t timestamp) {
+        if (full()) return false;
+        if (_count == 0) {
+            _buffer[0] = TTP229_BATCH_VERSION;
+            ttp229PutLE32(_buffer + 2, timestamp);
+            _lastTime = timestamp;
+        }
+
+        // Deltas past 23 bits are clamped; time runs forward in a batch
+        uint32_t delta = timestamp - _lastTime;
+        if (delta > TTP229_PACKED_TIME_MASK) delta = TTP229_PACKED_TIME_MASK;
+        ttp229PutLE32(_buffer + bytes(), TTP229PackedEvent::pack(key, type, delta).bits);
+        _lastTime = timestamp;
+        _count++;
+        _buffer[1] = _count;
+        return true;
+    }
+
+    uint8_t count() const { return _count; }
+
+    // Bytes to send, 0 while empty
+    size_t length() const { return _count ? bytes() : 0; }
+
+private:
+    size_t bytes() const { return TTP229_BATCH_HEADER_BYTES + (size_t)_count * 4; }
+
+    uint8_t* _buffer;
+    size_t _size;
+    uint8_t _count;
+    uint32_t _lastTime;
+};
+
+// Walks a received batch in place. Event is any struct with key,
+// eventType, timestamp, row and col (TTP229::KeyEvent); other fields
+// are zeroed.
+class TTP229BatchReader {
+public:
+    TTP229BatchReader(const uint8_t* buffer, size_t length)
+        : _buffer(buffer), _count(0), _index(0), _time(0) {
+        if (length >= TTP229_BATCH_HEADER_BYTES && buffer[0] == TTP229_BATCH_VERSION &&
+            length >= TTP229_BATCH_HEADER_BYTES + (size_t)buffer[1] * 4) {
+            _count = buffer[1];
+            _time = ttp229GetLE32(buffer + 2);
+        }
+    }
+
+    bool valid() const { return _count != 0; }
+    uint8_t count() const { return _count; }
+
+    bool next(uint8_t& key, uint8_t& type, uint32_t& timestamp) {
+        if (_index >= _count) return false;
+        TTP229PackedEvent event;
+        event.bits = ttp229GetLE32(_buffer + TTP229_BATCH_HEADER_BYTES + (size_t)_index * 4);
+        _index++;
+        _time += event.time();
+        key = event.key();
+        type = event.type();
+        timestamp = _time;
+        return true;
+    }
+
+    template <typename Event>
+    bool next(Event& event) {
+        uint8_t key, type;
+        uint32_t timestamp;
+        if (!next(key, type, timestamp)) return false;
+        memset(&event, 0, sizeof(event));
+        event.key = key;
+        event.eventType = type;
+        event.timestamp = timestamp;
+        event.row = key ? (uint8_t)((key - 1) / 4) : 255;
+        event.col = key ? (uint8_t)((key - 1) % 4) : 255;
+        return true;
+    }
+
+private:
+    const uint8_t* _buffer;
+    uint8_t _count;
+    uint8_t _index;
+    uint32_t _time;
+};
+
+#endif // TTP229_PACKED_H
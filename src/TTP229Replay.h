@@ -0,0 +1,67 @@
+#ifndef TTP229_REPLAY_H
+#define TTP229_REPLAY_H
+
+// Plain C headers only - used by host-side replay tools as well
+#include <stdint.h>
+#include <stddef.h>
+#include "TTP229Trace.h"
+
+// ==============================================
+// REPLAY FRAME SOURCE
+// ==============================================
+// Recorded or synthetic frames for begin(TTP229ReplaySource&): every
+// scan takes the next frame instead of clocking the chip. Frames are
+// { uint32_t micros, uint16_t mask } records in the TTP229Trace.h layout,
+// read in place - point it at a trace dump, a memory-mapped file or a
+// generated buffer.
+//
+// The source does not keep time. On the host simulation the driver sets
+// the virtual clock to frame.micros before each scan (see
+// extras/host/ttp229_replay.cpp); on a board each scan simply takes the
+// next frame.
+
+class TTP229ReplaySource {
+public:
+    TTP229ReplaySource() : _records(NULL), _count(0), _position(0), _lastMask(0) {}
+
+    // Bare records, count x TTP229_TRACE_FRAME_BYTES
+    TTP229ReplaySource(const uint8_t* records, size_t count)
+        : _records(records), _count(count), _position(0), _lastMask(0) {}
+
+    // A dumpTrace() block (found anywhere in data), else bare records
+    static TTP229ReplaySource fromDump(const uint8_t* data, size_t length) {
+        TTP229TraceReader trace(data, length);
+        if (!trace.valid()) return TTP229ReplaySource(data, length / TTP229_TRACE_FRAME_BYTES);
+        return TTP229ReplaySource(trace.frames(), trace.header().frames);
+    }
+
+    size_t count() const { return _count; }
+    size_t position() const { return _position; }
+    bool done() const { return _position >= _count; }
+    void rewind() { _position = 0; _lastMask = 0; }
+
+    // Next frame without taking it
+    bool peek(TTP229TraceFrame& frame) const {
+        if (done()) return false;
+        const uint8_t* in = _records + _position * TTP229_TRACE_FRAME_BYTES;
+        frame.micros = ttp229GetLE32(in);
+        frame.mask = ttp229GetLE16(in + 4);
+        return true;
+    }
+
+    // One scan. Past the end the last frame repeats.
+    uint16_t read() {
+        if (done()) return _lastMask;
+        _lastMask = ttp229GetLE16(_records + _position * TTP229_TRACE_FRAME_BYTES + 4);
+        _position++;
+        return _lastMask;
+    }
+
+private:
+    const uint8_t* _records;
+    size_t _count;
+    size_t _position;
+    uint16_t _lastMask;
+};
+
+#endif // TTP229_REPLAY_H
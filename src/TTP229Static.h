@@ -0,0 +1,90 @@
+#ifndef TTP229_STATIC_H
+#define TTP229_STATIC_H
+
+#include "TTP229Core.h"
+
+// ==============================================
+// COMPILE-TIME CONFIGURED TTP229
+// ==============================================
+// Header-only variant of TTP229 for fixed wiring:
+//
+//   TTP229Static<2, 3> keypad;              // SCL=2, SDO=3, 16 keys, 2µs clock
+//   TTP229Static<18, 19, 8, 500> keypad8;   // 8-key mode, 500ns half period
+//
+// Key count, pins and clock timing are template parameters, so the scan
+// loop is fully unrolled with constant delays and the object only holds
+// the resolved pin registers and the key state. No board detection, no
+// RTOS task - call read() from loop() or your own task at a steady rate;
+// debouncing counts those calls (default 3 scans each way).
+//
+// Shares the GPIO backend, frame bit order and debouncer with TTP229.
+
+template <uint8_t SCL, uint8_t SDO, uint8_t KEYS = 16, uint32_t ClkNs = 2000,
+          uint32_t ReadNs = 2000>
+class TTP229Static {
+    static_assert(KEYS == 8 || KEYS == 16, "TTP229 supports 8 or 16 keys");
+    static_assert(SCL != SDO, "SCL and SDO must be different pins");
+
+public:
+    static const uint8_t KEY_NONE = 0;
+    static const uint8_t NUM_KEYS = KEYS;
+    static const uint16_t ALL_KEYS = (uint16_t)((1UL << KEYS) - 1);
+
+    TTP229Static() : _keyMask(0), _lastKeyMask(0) {
+        _debouncer.reset();
+        _debouncer.setThresholds(3, 3);
+    }
+
+    void begin() {
+        pinMode(SCL, OUTPUT);
+        #if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_RASPBERRY_PI_PICO)
+        pinMode(SDO, INPUT_PULLUP);
+        #else
+        pinMode(SDO, INPUT);
+        #endif
+        digitalWrite(SCL, HIGH);
+        delay(10);  // Let module stabilize
+        _gpio.attach(SCL, SDO);
+    }
+
+    // One raw frame, unrolled at compile time (bit 0 = key 1)
+    uint16_t readRawMask() {
+        _gpio.sclHigh();
+        ttp229DelayNs<ReadNs>();
+        return TTP229FrameUnroll<0, KEYS, ClkNs>::read(_gpio);
+    }
+
+    // Scan, debounce and update edges. Returns the highest touched key.
+    uint8_t read() {
+        _lastKeyMask = _keyMask;
+        _keyMask = _debouncer.update(readRawMask());
+        return ttp229MaskToKey(_keyMask);
+    }
+
+    // Scans a touch / release must persist (1-7, 1 = no debounce)
+    void setDebounce(uint8_t pressScans, uint8_t releaseScans) {
+        _debouncer.setThresholds(pressScans, releaseScans);
+    }
+
+    uint8_t getKey() const { return ttp229MaskToKey(_keyMask); }
+    uint16_t getKeyMask() const { return _keyMask; }
+    uint16_t getPressedMask() const { return _keyMask & ~_lastKeyMask; }
+    uint16_t getReleasedMask() const { return _lastKeyMask & ~_keyMask; }
+
+    bool isPressed() const { return _keyMask != 0; }
+    bool isKeyPressed(uint8_t key) const { return (_keyMask & ttp229KeyToMask(key)) != 0; }
+    bool wasPressed() const { return _keyMask != 0 && _lastKeyMask == 0; }
+    bool wasReleased() const { return _keyMask == 0 && _lastKeyMask != 0; }
+
+    static uint8_t getSCLPin() { return SCL; }
+    static uint8_t getSDOPin() { return SDO; }
+    static bool is16KeyMode() { return KEYS == 16; }
+
+private:
+    TTP229Gpio _gpio;
+    TTP229Debouncer _debouncer;
+    uint16_t _keyMask;
+    uint16_t _lastKeyMask;
+};
+
+#endif // TTP229_STATIC_H
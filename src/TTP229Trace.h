@@ -0,0 +1,133 @@
+#ifndef TTP229_TRACE_H
+#define TTP229_TRACE_H
+
+// Plain C headers only - host-side decoders and replayers include this too
+#include <stdint.h>
+#include <stddef.h>
+#include "TTP229Packed.h"
+
+// ==============================================
+// RAW FRAME TRACE FORMAT
+// ==============================================
+// TTP229::dumpTrace() writes the frame ring as one binary block, oldest
+// frame first. Everything is little-endian:
+//
+//   bytes 0-3    "T229"
+//   byte 4       TTP229_TRACE_VERSION
+//   byte 5       press debounce threshold (scans)
+//   byte 6       release debounce threshold (scans)
+//   byte 7       keys (8 or 16)
+//   bytes 8-9    scan interval (ms)
+//   bytes 10-11  hold threshold (ms)
+//   bytes 12-13  long press threshold (ms)
+//   bytes 14-15  frame count
+//   bytes 16-19  scan sequence of the newest frame
+//   bytes 20-    count x { uint32_t micros, uint16_t raw mask }
+//
+// The settings let a replay start from the configuration the unit ran
+// with. The block may sit in the middle of other serial output - readers
+// look for the magic.
+
+static const uint8_t TTP229_TRACE_VERSION = 1;
+static const uint8_t TTP229_TRACE_HEADER_BYTES = 20;
+static const uint8_t TTP229_TRACE_FRAME_BYTES = 6;
+
+typedef struct {
+    uint8_t pressScans;
+    uint8_t releaseScans;
+    uint8_t keys;
+    uint16_t scanIntervalMs;
+    uint16_t holdMs;
+    uint16_t longPressMs;
+    uint16_t frames;
+    uint32_t lastSequence;     // Sequence number of the newest frame
+} TTP229TraceHeader;
+
+typedef struct {
+    uint32_t micros;
+    uint16_t mask;             // Raw frame, bit 0 = key 1
+} TTP229TraceFrame;
+
+inline void ttp229PutLE16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+inline uint16_t ttp229GetLE16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+inline void ttp229EncodeTraceHeader(uint8_t* out, const TTP229TraceHeader& header) {
+    out[0] = 'T';
+    out[1] = '2';
+    out[2] = '2';
+    out[3] = '9';
+    out[4] = TTP229_TRACE_VERSION;
+    out[5] = header.pressScans;
+    out[6] = header.releaseScans;
+    out[7] = header.keys;
+    ttp229PutLE16(out + 8, header.scanIntervalMs);
+    ttp229PutLE16(out + 10, header.holdMs);
+    ttp229PutLE16(out + 12, header.longPressMs);
+    ttp229PutLE16(out + 14, header.frames);
+    ttp229PutLE32(out + 16, header.lastSequence);
+}
+
+inline void ttp229EncodeTraceFrame(uint8_t* out, const TTP229TraceFrame& frame) {
+    ttp229PutLE32(out, frame.micros);
+    ttp229PutLE16(out + 4, frame.mask);
+}
+
+// Walks a dump in place. Skips anything before the first "T229" block;
+// valid() is false if none is found or the frames are cut short.
+class TTP229TraceReader {
+public:
+    TTP229TraceReader(const uint8_t* data, size_t length)
+        : _frames(NULL), _index(0) {
+        memset(&_header, 0, sizeof(_header));
+        for (size_t i = 0; i + TTP229_TRACE_HEADER_BYTES <= length; i++) {
+            const uint8_t* block = data + i;
+            if (block[0] != 'T' || block[1] != '2' || block[2] != '2' || block[3] != '9' ||
+                block[4] != TTP229_TRACE_VERSION) {
+                continue;
+            }
+
+            uint16_t frames = ttp229GetLE16(block + 14);
+            if (length - i < TTP229_TRACE_HEADER_BYTES + (size_t)frames * TTP229_TRACE_FRAME_BYTES) {
+                return;  // Truncated
+            }
+            _header.pressScans = block[5];
+            _header.releaseScans = block[6];
+            _header.keys = block[7];
+            _header.scanIntervalMs = ttp229GetLE16(block + 8);
+            _header.holdMs = ttp229GetLE16(block + 10);
+            _header.longPressMs = ttp229GetLE16(block + 12);
+            _header.frames = frames;
+            _header.lastSequence = ttp229GetLE32(block + 16);
+            _frames = block + TTP229_TRACE_HEADER_BYTES;
+            return;
+        }
+    }
+
+    bool valid() const { return _frames != NULL; }
+    const TTP229TraceHeader& header() const { return _header; }
+    const uint8_t* frames() const { return _frames; }  // First frame record
+
+    bool next(TTP229TraceFrame& frame) {
+        if (_frames == NULL || _index >= _header.frames) return false;
+        const uint8_t* in = _frames + (size_t)_index * TTP229_TRACE_FRAME_BYTES;
+        frame.micros = ttp229GetLE32(in);
+        frame.mask = ttp229GetLE16(in + 4);
+        _index++;
+        return true;
+    }
+
+    void rewind() { _index = 0; }
+
+private:
+    TTP229TraceHeader _header;
+    const uint8_t* _frames;
+    uint16_t _index;
+};
+
+#endif // TTP229_TRACE_H